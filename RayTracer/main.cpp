@@ -12,6 +12,9 @@
 #include <Utilities.h>
 
 #include <PresetScenes.h>
+#include <BVH.h>
+#include <Benchmark.h>
+#include <TriangleArray.h>
 #include "TinyOBJLoader.h"
 
 using RayTracer::IScene;
@@ -22,6 +25,12 @@ using RayTracer::GPURenderer;
 using RayTracer::ImageResolution;
 using RayTracer::IImage;
 using RayTracer::Color;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVHBuilder;
+using RayTracer::AccelerationStructureType;
+using RayTracer::TileOrder;
+using RayTracer::Benchmark;
+using RayTracer::TriangleArray;
 
 class InputParser 
 {
@@ -62,28 +71,46 @@ struct CommandLineArguments
         RenderGPU = true;
         GPUDebugEnabled = false;
         TracePerformance = false;
+        RunBenchmark = false;
+        PacketTracing = true;
+        Wavefront = false;
+        WatertightTriangles = false;
         Samples = 1;
         MaxBounces = 4;
         ResolutionX = 1920;
         ResolutionY = 1080;
         MaxThreads = 0;
+        TileSize = 16;
+        TileOrdering = TileOrder::Scanline;
+        Builder = BVHBuilder::BinnedSAH;
+        AccelerationStructure = AccelerationStructureType::Automatic;
         ShowHelp = false;
         output_file_path = "";
         input_file_path = "";
+        cache_file_path = "";
     }
 
     bool RenderCPU;
     bool RenderGPU;
     bool GPUDebugEnabled;
     bool TracePerformance;
+    bool RunBenchmark;
+    bool PacketTracing;
+    bool Wavefront;
+    bool WatertightTriangles;
     unsigned int Samples;
     size_t MaxBounces;
     size_t ResolutionX;
     size_t ResolutionY;
     size_t MaxThreads;
+    size_t TileSize;
+    TileOrder TileOrdering;
+    BVHBuilder Builder;
+    AccelerationStructureType AccelerationStructure;
     bool ShowHelp;
     std::string output_file_path;
     std::string input_file_path;
+    std::string cache_file_path;
 };
 
 static void parse_command_line_arguments(int argc, char** argv, CommandLineArguments& arguments)
@@ -125,6 +152,71 @@ static void parse_command_line_arguments(int argc, char** argv, CommandLineArgum
         arguments.MaxThreads = max_threads;
     }
 
+    const std::string tile_size_string = parser.GetCommandOption("-tile");
+    if (0 != tile_size_string.compare(""))
+    {
+        size_t tile_size = (size_t)std::stoul(tile_size_string);
+        arguments.TileSize = tile_size > 0 ? tile_size : 1;
+    }
+
+    const std::string tile_order_string = parser.GetCommandOption("-order");
+    if (0 == tile_order_string.compare("scanline"))
+    {
+        arguments.TileOrdering = TileOrder::Scanline;
+    }
+    else if (0 == tile_order_string.compare("spiral"))
+    {
+        arguments.TileOrdering = TileOrder::Spiral;
+    }
+    else if (0 == tile_order_string.compare("hilbert"))
+    {
+        arguments.TileOrdering = TileOrder::Hilbert;
+    }
+    else if (0 != tile_order_string.compare(""))
+    {
+        std::cout << "Unknown tile order \"" << tile_order_string << "\", using scanline" << std::endl;
+    }
+
+    const std::string bvh_builder_string = parser.GetCommandOption("-bvh");
+    if (0 == bvh_builder_string.compare("sah"))
+    {
+        arguments.Builder = BVHBuilder::BinnedSAH;
+    }
+    else if (0 == bvh_builder_string.compare("sbvh"))
+    {
+        arguments.Builder = BVHBuilder::SBVH;
+    }
+    else if (0 == bvh_builder_string.compare("sweep"))
+    {
+        arguments.Builder = BVHBuilder::SweepSAH;
+    }
+    else if (0 == bvh_builder_string.compare("lbvh"))
+    {
+        arguments.Builder = BVHBuilder::LBVH;
+    }
+    else if (0 != bvh_builder_string.compare(""))
+    {
+        std::cout << "Unknown BVH builder \"" << bvh_builder_string << "\", using sah" << std::endl;
+    }
+
+    const std::string acceleration_structure_string = parser.GetCommandOption("-accel");
+    if (0 == acceleration_structure_string.compare("auto"))
+    {
+        arguments.AccelerationStructure = AccelerationStructureType::Automatic;
+    }
+    else if (0 == acceleration_structure_string.compare("bvh"))
+    {
+        arguments.AccelerationStructure = AccelerationStructureType::BVH;
+    }
+    else if (0 == acceleration_structure_string.compare("grid"))
+    {
+        arguments.AccelerationStructure = AccelerationStructureType::Grid;
+    }
+    else if (0 != acceleration_structure_string.compare(""))
+    {
+        std::cout << "Unknown acceleration structure \"" << acceleration_structure_string << "\", using auto" << std::endl;
+    }
+
     const std::string output_file_path_string = parser.GetCommandOption("-o");
     if (0 != output_file_path_string.compare(""))
     {
@@ -137,6 +229,12 @@ static void parse_command_line_arguments(int argc, char** argv, CommandLineArgum
         arguments.input_file_path = input_file_path_string;
     }
 
+    const std::string cache_file_path_string = parser.GetCommandOption("-cache");
+    if (0 != cache_file_path_string.compare(""))
+    {
+        arguments.cache_file_path = cache_file_path_string;
+    }
+
     bool render_cpu = parser.CommandOptionExists("-c");
     arguments.RenderCPU = render_cpu;
 
@@ -149,6 +247,18 @@ static void parse_command_line_arguments(int argc, char** argv, CommandLineArgum
     bool trace_performance = parser.CommandOptionExists("-t");
     arguments.TracePerformance = trace_performance;
 
+    bool run_benchmark = parser.CommandOptionExists("-bench");
+    arguments.RunBenchmark = run_benchmark;
+
+    bool no_packets = parser.CommandOptionExists("-nopackets");
+    arguments.PacketTracing = !no_packets;
+
+    bool wavefront = parser.CommandOptionExists("-wavefront");
+    arguments.Wavefront = wavefront;
+
+    bool watertight = parser.CommandOptionExists("-watertight");
+    arguments.WatertightTriangles = watertight;
+
     bool show_help = parser.CommandOptionExists("-h");
     arguments.ShowHelp = show_help;
 }
@@ -162,13 +272,22 @@ static void help()
         << "\t\t-g : render on GPU\n"
         << "\t\t-dg : enable GPU debug messages\n"
         << "\t\t-t : enable performance tracing\n"
+        << "\t\t-nopackets : trace cpu camera rays one pixel at a time instead of as packets of 8x8 pixel blocks\n"
+        << "\t\t-wavefront : trace cpu rays breadth-first, one bounce of a batch of tiles at a time\n"
+        << "\t\t-watertight : intersect mesh triangles with the watertight test, so no rays leak through shared edges\n"
+        << "\t\t-bench : measure build time, node memory and ray throughput of each cpu BVH layout, builder and triangle test, then exit\n"
         << "\t\t-o <path> : output file path\n"
         << "\t\t-i <path> : input file path\n"
+        << "\t\t-cache <path> : load the input's meshes and BVHs from this cache file, or write it if it is missing or stale\n"
         << "\t\t-s <samples> : set sample count [ default 1 ]\n"
         << "\t\t-b <bounces> : set max bounces [ default 4 ]\n"
         << "\t\t-x <x resolution> : set image width (pixels) [ default 1920 ]\n"
         << "\t\t-y <y resolution> : set image height (pixels) [ default 1080 ]\n"
-        << "\t\t-m <max threads> : set the max number of threads the cpu renderer can use [ default inf ]\n";
+        << "\t\t-m <max threads> : set the max number of threads the cpu renderer can use [ default inf ]\n"
+        << "\t\t-tile <size> : set the width and height of the pixel tiles the cpu renderer hands to each thread [ default 16 ]\n"
+        << "\t\t-order <scanline|spiral|hilbert> : set the order the cpu renderer renders its tiles in, spiral starts at the center, hilbert keeps consecutive tiles adjacent [ default scanline ]\n"
+        << "\t\t-bvh <sah|sbvh|sweep|lbvh> : set the cpu BVH builder, sbvh splits long thin triangles, lbvh builds fastest for previews [ default sah ]\n"
+        << "\t\t-accel <auto|bvh|grid> : set the cpu structure over the scene objects, auto picks the grid for dense arrays of similar objects [ default auto ]\n";
 }
 
 static bool write_png_file(const std::string &file_name, const std::vector<std::vector<png_byte>> &color_values)
@@ -311,7 +430,7 @@ int main(int argc, char **argv)
     CommandLineArguments arguments;
     parse_command_line_arguments(argc, argv, arguments);
 
-    if (arguments.ShowHelp || arguments.output_file_path == "")
+    if (arguments.ShowHelp || (arguments.output_file_path == "" && !arguments.RunBenchmark))
     {
         help();
         exit(0);
@@ -321,6 +440,15 @@ int main(int argc, char **argv)
 
     ImageResolution resolution(arguments.ResolutionX, arguments.ResolutionY);
 
+    BVHBuildOptions bvh_build_options;
+    bvh_build_options.Builder = arguments.Builder;
+
+    // Mesh leaves are intersected as one TriangleArray batch, so larger leaves cost little more than small ones
+    BVHBuildOptions mesh_build_options = bvh_build_options;
+    mesh_build_options.MaxLeafSize = TriangleArray::BatchWidth;
+    mesh_build_options.IntersectionCost = 0.3f;
+    mesh_build_options.WatertightTriangles = arguments.WatertightTriangles;
+
     // Build a scene to render
     IScene *scene = nullptr;
     Camera *camera = nullptr;
@@ -332,7 +460,19 @@ int main(int argc, char **argv)
     }
     else
     {
-        RayTracer::CreateSceneFromOBJFile(arguments.input_file_path, resolution, camera, scene);
+        auto load_start = std::chrono::high_resolution_clock::now();
+        RayTracer::CreateSceneFromOBJFile(arguments.input_file_path, resolution, camera, scene, mesh_build_options, arguments.cache_file_path);
+        std::chrono::duration<double, std::milli> load_time = std::chrono::high_resolution_clock::now() - load_start;
+        std::cout << "Scene Load Time (ms): " << load_time.count() << std::endl;
+    }
+
+    if (arguments.RunBenchmark)
+    {
+        Benchmark benchmark(*scene, *camera);
+        benchmark.PrintResults(benchmark.MeasureHierarchyLayouts(), std::cout);
+        benchmark.PrintResults(benchmark.MeasureBuilders(), std::cout);
+        benchmark.PrintResults(benchmark.MeasureTriangleTests(), std::cout);
+        return 0;
     }
 
     // Provide an output pointer for the image
@@ -342,8 +482,18 @@ int main(int argc, char **argv)
     if (arguments.RenderCPU)
     {
         std::cout << std::endl << "Rendering on CPU" << std::endl;
+        CPURenderer::CPURendererParameters render_params(*camera, *scene);
+        render_params.samples = arguments.Samples;
+        render_params.max_threads = arguments.MaxThreads;
+        render_params.trace_performance = arguments.TracePerformance;
+        render_params.bvh_build_options = bvh_build_options;
+        render_params.acceleration_structure = arguments.AccelerationStructure;
+        render_params.packet_tracing = arguments.PacketTracing;
+        render_params.wavefront = arguments.Wavefront;
+        render_params.tile_size = arguments.TileSize;
+        render_params.tile_order = arguments.TileOrdering;
         CPURenderer cpu_renderer;
-        cpu_renderer.Render(arguments.MaxThreads, *camera, arguments.Samples, *scene, out_image);
+        cpu_renderer.Render(render_params, out_image);
     }
 
     if (arguments.RenderGPU)
@@ -353,6 +503,7 @@ int main(int argc, char **argv)
         init_params.samples = arguments.Samples;
         init_params.max_bounces = arguments.MaxBounces;
         init_params.trace_performance = arguments.TracePerformance;
+        init_params.watertight_triangles = arguments.WatertightTriangles;
         GPURenderer gpu_renderer(init_params);
         gpu_renderer.Render(out_image);
     }
@@ -0,0 +1,405 @@
+#include "AccelerationStructureCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <type_traits>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using RayTracer::AccelerationStructureCache;
+using RayTracer::BVH;
+using RayTracer::BVHBuildOptions;
+using RayTracer::MeshGeometry;
+using RayTracer::Vector3;
+
+static_assert(std::is_trivially_copyable_v<BVH::Node>, "BVH nodes are copied straight out of the cache file");
+
+static const char cache_magic[8] = { 'R', 'T', 'B', 'V', 'H', 'C', 'A', 'C' };
+
+// Every section of the file starts on this alignment so arrays can be viewed in place in the mapping
+static const size_t section_alignment = 8;
+
+struct CacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t mesh_count;
+	uint64_t source_hash;
+	uint64_t options_hash;
+};
+
+// Followed by the vertices as float triples, the faces as uint64_t triples, the BVH nodes and the
+// BVH primitive slots, each padded to section_alignment
+struct CacheMeshHeader
+{
+	uint64_t vertex_count;
+	uint64_t face_count;
+	uint64_t node_count;
+	uint64_t slot_count;
+};
+
+static const uint64_t fnv_offset_basis = 14695981039346656037ull;
+static const uint64_t fnv_prime = 1099511628211ull;
+
+static uint64_t HashBytes(const void *data, size_t size, uint64_t hash = fnv_offset_basis)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * fnv_prime;
+	}
+
+	return hash;
+}
+
+template <class T>
+static uint64_t HashValue(const T &value, uint64_t hash)
+{
+	return HashBytes(&value, sizeof(value), hash);
+}
+
+// Only the options that shape the binary tree, the traversal layout is collapsed again on load
+static uint64_t HashBuildOptions(const BVHBuildOptions &options)
+{
+	uint64_t hash = fnv_offset_basis;
+	hash = HashValue(static_cast<uint32_t>(options.Builder), hash);
+	hash = HashValue(options.MaxLeafSize, hash);
+	hash = HashValue(options.TraversalCost, hash);
+	hash = HashValue(options.IntersectionCost, hash);
+	hash = HashValue(options.BinCount, hash);
+	hash = HashValue(options.MortonCodeBits, hash);
+	hash = HashValue(options.SpatialSplitBudget, hash);
+	hash = HashValue(options.SpatialSplitOverlap, hash);
+	return hash;
+}
+
+// Read-only view of a whole file mapped into memory
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string &file_path)
+	{
+#if defined(_WIN32)
+		file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER file_size;
+		if (INVALID_HANDLE_VALUE == file || !GetFileSizeEx(file, &file_size))
+		{
+			return;
+		}
+
+		opened = true;
+		size = static_cast<size_t>(file_size.QuadPart);
+		if (0 == size)
+		{
+			return;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (nullptr != mapping)
+		{
+			data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+#else
+		file = open(file_path.c_str(), O_RDONLY);
+		struct stat file_status;
+		if (-1 == file || 0 != fstat(file, &file_status))
+		{
+			return;
+		}
+
+		opened = true;
+		size = static_cast<size_t>(file_status.st_size);
+		if (0 == size)
+		{
+			return;
+		}
+
+		void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		data = MAP_FAILED == view ? nullptr : static_cast<const std::byte *>(view);
+#endif
+
+		if (nullptr == data)
+		{
+			opened = false;
+			size = 0;
+		}
+	}
+
+	~MappedFile()
+	{
+#if defined(_WIN32)
+		if (nullptr != data)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		if (nullptr != mapping)
+		{
+			CloseHandle(mapping);
+		}
+
+		if (INVALID_HANDLE_VALUE != file)
+		{
+			CloseHandle(file);
+		}
+#else
+		if (nullptr != data)
+		{
+			munmap(const_cast<std::byte *>(data), size);
+		}
+
+		if (-1 != file)
+		{
+			close(file);
+		}
+#endif
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool IsOpen() const
+	{
+		return opened;
+	}
+
+	std::span<const std::byte> Data() const
+	{
+		return std::span<const std::byte>(data, size);
+	}
+
+private:
+	const std::byte *data = nullptr;
+	size_t size = 0;
+	bool opened = false;
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
+
+// Bounds checked cursor over a mapped cache file
+class CacheReader
+{
+public:
+	explicit CacheReader(std::span<const std::byte> data) : data(data), position(0) {}
+
+	template <class T>
+	bool Read(T &out_value)
+	{
+		if (data.size() - position < sizeof(T))
+		{
+			return false;
+		}
+
+		std::memcpy(&out_value, data.data() + position, sizeof(T));
+		Advance(sizeof(T));
+		return true;
+	}
+
+	// Views count elements in place, without copying them
+	template <class T>
+	bool ReadArray(uint64_t count, std::span<const T> &out_array)
+	{
+		if (count > (data.size() - position) / sizeof(T))
+		{
+			return false;
+		}
+
+		out_array = std::span<const T>(reinterpret_cast<const T *>(data.data() + position), static_cast<size_t>(count));
+		Advance(static_cast<size_t>(count) * sizeof(T));
+		return true;
+	}
+
+private:
+	void Advance(size_t byte_count)
+	{
+		size_t padded = (byte_count + section_alignment - 1) / section_alignment * section_alignment;
+		position = std::min(data.size(), position + padded);
+	}
+
+	std::span<const std::byte> data;
+	size_t position;
+};
+
+class CacheWriter
+{
+public:
+	explicit CacheWriter(std::ofstream &stream) : stream(stream) {}
+
+	template <class T>
+	void Write(const T &value)
+	{
+		WriteBytes(&value, sizeof(T));
+	}
+
+	template <class T>
+	void WriteArray(const std::vector<T> &values)
+	{
+		WriteBytes(values.data(), values.size() * sizeof(T));
+	}
+
+private:
+	void WriteBytes(const void *bytes, size_t byte_count)
+	{
+		static const char padding[section_alignment] = {};
+		stream.write(static_cast<const char *>(bytes), byte_count);
+		stream.write(padding, (section_alignment - byte_count % section_alignment) % section_alignment);
+	}
+
+	std::ofstream &stream;
+};
+
+uint64_t AccelerationStructureCache::HashFile(const std::string &file_path)
+{
+	MappedFile file(file_path);
+	if (!file.IsOpen())
+	{
+		throw std::exception("Could not open the file to hash");
+	}
+
+	return HashBytes(file.Data().data(), file.Data().size());
+}
+
+bool AccelerationStructureCache::Load(const std::string &cache_path, uint64_t source_hash, const BVHBuildOptions &options,
+	std::vector<std::shared_ptr<const MeshGeometry>> &out_geometry)
+{
+	out_geometry.clear();
+
+	MappedFile file(cache_path);
+	if (!file.IsOpen())
+	{
+		return false;
+	}
+
+	CacheReader reader(file.Data());
+	CacheHeader header;
+	if (!reader.Read(header) || 0 != std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) || Version != header.version ||
+		source_hash != header.source_hash || HashBuildOptions(options) != header.options_hash)
+	{
+		return false;
+	}
+
+	for (uint32_t mesh_index = 0; mesh_index < header.mesh_count; mesh_index++)
+	{
+		CacheMeshHeader mesh_header;
+		std::span<const float> vertex_components;
+		std::span<const uint64_t> face_components;
+		std::span<const BVH::Node> nodes;
+		std::span<const uint32_t> slots;
+		if (!reader.Read(mesh_header) ||
+			mesh_header.vertex_count > std::numeric_limits<uint64_t>::max() / 3 ||
+			mesh_header.face_count > std::numeric_limits<uint64_t>::max() / 3 ||
+			!reader.ReadArray(3 * mesh_header.vertex_count, vertex_components) ||
+			!reader.ReadArray(3 * mesh_header.face_count, face_components) ||
+			!reader.ReadArray(mesh_header.node_count, nodes) ||
+			!reader.ReadArray(mesh_header.slot_count, slots))
+		{
+			out_geometry.clear();
+			return false;
+		}
+
+		std::vector<Vector3<float>> vertices;
+		vertices.reserve(mesh_header.vertex_count);
+		for (size_t i = 0; i < vertex_components.size(); i += 3)
+		{
+			vertices.emplace_back(vertex_components[i], vertex_components[i + 1], vertex_components[i + 2]);
+		}
+
+		std::vector<Vector3<size_t>> faces;
+		faces.reserve(mesh_header.face_count);
+		for (size_t i = 0; i < face_components.size(); i += 3)
+		{
+			faces.emplace_back(static_cast<size_t>(face_components[i]), static_cast<size_t>(face_components[i + 1]), static_cast<size_t>(face_components[i + 2]));
+		}
+
+		try
+		{
+			out_geometry.emplace_back(std::make_shared<const MeshGeometry>(vertices, faces, BVH(nodes, slots, options), options));
+		}
+		catch (const std::exception &)
+		{
+			// Indices out of range or a broken tree, the cache cannot be trusted
+			out_geometry.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AccelerationStructureCache::Save(const std::string &cache_path, uint64_t source_hash, const BVHBuildOptions &options,
+	const std::vector<std::shared_ptr<const MeshGeometry>> &geometry)
+{
+	const std::string temporary_path = cache_path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	{
+		std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			throw std::exception("Could not create the acceleration structure cache file");
+		}
+
+		CacheWriter writer(stream);
+		CacheHeader header;
+		std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+		header.version = Version;
+		header.mesh_count = static_cast<uint32_t>(geometry.size());
+		header.source_hash = source_hash;
+		header.options_hash = HashBuildOptions(options);
+		writer.Write(header);
+
+		for (const auto &mesh_geometry : geometry)
+		{
+			const BVH &hierarchy = mesh_geometry->Hierarchy();
+
+			CacheMeshHeader mesh_header;
+			mesh_header.vertex_count = mesh_geometry->VertexData().size();
+			mesh_header.face_count = mesh_geometry->VertexIndices.size();
+			mesh_header.node_count = hierarchy.Nodes().size();
+			mesh_header.slot_count = hierarchy.PrimitiveIndices().size();
+			writer.Write(mesh_header);
+
+			std::vector<float> vertex_components;
+			vertex_components.reserve(3 * mesh_header.vertex_count);
+			for (const auto &vertex : mesh_geometry->VertexData())
+			{
+				vertex_components.insert(vertex_components.end(), { vertex.X, vertex.Y, vertex.Z });
+			}
+
+			std::vector<uint64_t> face_components;
+			face_components.reserve(3 * mesh_header.face_count);
+			for (const auto &face : mesh_geometry->VertexIndices)
+			{
+				face_components.insert(face_components.end(), { face.X, face.Y, face.Z });
+			}
+
+			writer.WriteArray(vertex_components);
+			writer.WriteArray(face_components);
+			writer.WriteArray(hierarchy.Nodes());
+			writer.WriteArray(hierarchy.PrimitiveIndices());
+		}
+
+		if (!stream.flush())
+		{
+			stream.close();
+			std::filesystem::remove(temporary_path);
+			throw std::exception("Could not write the acceleration structure cache file");
+		}
+	}
+
+	std::filesystem::rename(temporary_path, cache_path);
+}
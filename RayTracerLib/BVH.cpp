@@ -0,0 +1,1176 @@
+#include "BVH.h"
+#include "ElapsedTimer.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <thread>
+
+using RayTracer::BVH;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVHBuilder;
+using RayTracer::BoundingBox;
+using RayTracer::ElapsedTimer;
+using RayTracer::ThreadPool;
+using RayTracer::Vector3;
+
+// Past this depth the builder falls back to median splits, which bounds the final depth by MaxDepth
+static const size_t median_split_depth = 64;
+
+// Parallel builds never hand out subtrees smaller than this to the thread pool
+static const size_t minimum_parallel_subtree_size = 4096;
+
+struct BuildReference
+{
+	BoundingBox bounds;
+	float centroid[3];
+	uint32_t primitive_index;
+	// Only used by the LBVH builder
+	uint64_t morton_code;
+};
+
+struct BuildOutput
+{
+	std::vector<BVH::Node> nodes;
+	std::vector<uint32_t> primitive_indices;
+};
+
+struct SplitResult
+{
+	// Only valid for leaves, interior bounds are taken from the children once they are built
+	BoundingBox bounds;
+	bool make_leaf;
+	// References in [begin, split) go to the first child, [split, end) to the second
+	size_t split;
+	// SAH cost of the chosen split, infinite when it was not picked by cost
+	float cost = std::numeric_limits<float>::infinity();
+};
+
+static BuildReference MakeReference(const BoundingBox &bounds, uint32_t primitive_index)
+{
+	BuildReference reference;
+	reference.bounds = bounds;
+	reference.centroid[0] = bounds.Centroid(0);
+	reference.centroid[1] = bounds.Centroid(1);
+	reference.centroid[2] = bounds.Centroid(2);
+	reference.primitive_index = primitive_index;
+	return reference;
+}
+
+static void SortReferences(std::vector<BuildReference> &references, size_t begin, size_t end, int axis)
+{
+	std::sort(references.begin() + begin, references.begin() + end,
+		[axis](const BuildReference &a, const BuildReference &b)
+		{
+			return a.centroid[axis] < b.centroid[axis] ||
+				(a.centroid[axis] == b.centroid[axis] && a.primitive_index < b.primitive_index);
+		});
+}
+
+// Full sweep SAH: try every split position between the sorted centroids on every axis
+static float FindSweepSplit(std::vector<BuildReference> &references, std::vector<float> &right_areas, size_t begin, size_t end,
+	const BoundingBox &centroid_bounds, float parent_area, const BVHBuildOptions &options, int &out_axis, size_t &out_split)
+{
+	const size_t count = end - begin;
+	float best_cost = std::numeric_limits<float>::infinity();
+
+	if (right_areas.size() < count)
+	{
+		right_areas.resize(count);
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (centroid_bounds.Extent(axis) <= 0.0f)
+		{
+			continue;
+		}
+
+		SortReferences(references, begin, end, axis);
+
+		BoundingBox right_bounds;
+		for (size_t i = end - 1; i > begin; i--)
+		{
+			right_bounds.Expand(references[i].bounds);
+			right_areas[i - begin] = right_bounds.SurfaceArea();
+		}
+
+		BoundingBox left_bounds;
+		for (size_t i = begin + 1; i < end; i++)
+		{
+			left_bounds.Expand(references[i - 1].bounds);
+			size_t left_count = i - begin;
+			float cost = options.TraversalCost + options.IntersectionCost *
+				(left_bounds.SurfaceArea() * left_count + right_areas[i - begin] * (count - left_count)) / parent_area;
+
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				out_axis = axis;
+				out_split = i;
+			}
+		}
+	}
+
+	if (out_axis != -1)
+	{
+		SortReferences(references, begin, end, out_axis);
+	}
+
+	return best_cost;
+}
+
+// Binned SAH: centroids are dropped into equally sized bins and only the planes between bins are evaluated
+static float FindBinnedSplit(std::vector<BuildReference> &references, size_t begin, size_t end,
+	const BoundingBox &centroid_bounds, float parent_area, const BVHBuildOptions &options, int &out_axis, size_t &out_split)
+{
+	static const size_t max_bin_count = 64;
+	const size_t bin_count = std::max<size_t>(2, std::min<size_t>(max_bin_count, options.BinCount));
+
+	float best_cost = std::numeric_limits<float>::infinity();
+	size_t best_bin = 0;
+
+	BoundingBox bin_bounds[max_bin_count];
+	size_t bin_counts[max_bin_count];
+	float right_areas[max_bin_count];
+	size_t right_counts[max_bin_count];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroid_bounds.Extent(axis);
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		float bin_scale = bin_count / extent;
+		for (size_t bin = 0; bin < bin_count; bin++)
+		{
+			bin_bounds[bin] = BoundingBox();
+			bin_counts[bin] = 0;
+		}
+
+		for (size_t i = begin; i < end; i++)
+		{
+			size_t bin = std::min<size_t>(bin_count - 1, (size_t)((references[i].centroid[axis] - centroid_bounds.min[axis]) * bin_scale));
+			bin_bounds[bin].Expand(references[i].bounds);
+			bin_counts[bin]++;
+		}
+
+		BoundingBox right_bounds;
+		size_t right_count = 0;
+		for (size_t bin = bin_count - 1; bin > 0; bin--)
+		{
+			right_bounds.Expand(bin_bounds[bin]);
+			right_count += bin_counts[bin];
+			right_areas[bin] = right_bounds.SurfaceArea();
+			right_counts[bin] = right_count;
+		}
+
+		BoundingBox left_bounds;
+		size_t left_count = 0;
+		for (size_t bin = 1; bin < bin_count; bin++)
+		{
+			left_bounds.Expand(bin_bounds[bin - 1]);
+			left_count += bin_counts[bin - 1];
+			if (left_count == 0 || right_counts[bin] == 0)
+			{
+				continue;
+			}
+
+			float cost = options.TraversalCost + options.IntersectionCost *
+				(left_bounds.SurfaceArea() * left_count + right_areas[bin] * right_counts[bin]) / parent_area;
+
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_bin = bin;
+				out_axis = axis;
+			}
+		}
+	}
+
+	if (out_axis != -1)
+	{
+		const int axis = out_axis;
+		const float bin_scale = bin_count / centroid_bounds.Extent(axis);
+		const float minimum = centroid_bounds.min[axis];
+		auto middle = std::partition(references.begin() + begin, references.begin() + end,
+			[&](const BuildReference &reference)
+			{
+				return std::min<size_t>(bin_count - 1, (size_t)((reference.centroid[axis] - minimum) * bin_scale)) < best_bin;
+			});
+		out_split = middle - references.begin();
+	}
+
+	return best_cost;
+}
+
+// LBVH: references are sorted by Morton code, so split where the highest differing bit of the range flips
+static SplitResult FindMortonSplit(const std::vector<BuildReference> &references, size_t begin, size_t end, const BVHBuildOptions &options)
+{
+	SplitResult result;
+	const size_t count = end - begin;
+	result.make_leaf = count <= options.MaxLeafSize;
+	result.split = begin + count / 2;
+
+	if (result.make_leaf)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			result.bounds.Expand(references[i].bounds);
+		}
+
+		return result;
+	}
+
+	const uint64_t first_code = references[begin].morton_code;
+	const uint64_t last_code = references[end - 1].morton_code;
+	if (first_code == last_code)
+	{
+		// Identical codes cannot be told apart, the median split keeps the tree balanced
+		return result;
+	}
+
+	uint64_t split_bit = uint64_t(1) << 63;
+	while (0 == ((first_code ^ last_code) & split_bit))
+	{
+		split_bit >>= 1;
+	}
+
+	// Binary search for the first reference that has the split bit set
+	size_t low = begin;
+	size_t high = end - 1;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (references[middle].morton_code & split_bit)
+		{
+			high = middle;
+		}
+		else
+		{
+			low = middle + 1;
+		}
+	}
+
+	result.split = low;
+	return result;
+}
+
+// Decides whether [begin, end) becomes a leaf and otherwise partitions it in place for the two children
+static SplitResult FindSplit(std::vector<BuildReference> &references, std::vector<float> &scratch, size_t begin, size_t end,
+	size_t depth, const BVHBuildOptions &options)
+{
+	if (BVHBuilder::LBVH == options.Builder)
+	{
+		return FindMortonSplit(references, begin, end, options);
+	}
+
+	SplitResult result;
+	BoundingBox centroid_bounds;
+	for (size_t i = begin; i < end; i++)
+	{
+		result.bounds.Expand(references[i].bounds);
+		centroid_bounds.Expand(Vector3<float>(references[i].centroid[0], references[i].centroid[1], references[i].centroid[2]));
+	}
+
+	const size_t count = end - begin;
+	result.make_leaf = false;
+	result.split = begin + count / 2;
+
+	if (count == 1)
+	{
+		result.make_leaf = true;
+		return result;
+	}
+
+	int best_axis = -1;
+	float best_cost = std::numeric_limits<float>::infinity();
+	const float parent_area = result.bounds.SurfaceArea();
+
+	if (depth < median_split_depth && parent_area > 0.0f)
+	{
+		if (BVHBuilder::SweepSAH == options.Builder)
+		{
+			best_cost = FindSweepSplit(references, scratch, begin, end, centroid_bounds, parent_area, options, best_axis, result.split);
+		}
+		else
+		{
+			best_cost = FindBinnedSplit(references, begin, end, centroid_bounds, parent_area, options, best_axis, result.split);
+		}
+	}
+
+	if (best_axis == -1)
+	{
+		// Every centroid coincides (or the tree is too deep), only split when the leaf would be too big
+		if (count <= options.MaxLeafSize)
+		{
+			result.make_leaf = true;
+			return result;
+		}
+
+		int axis = centroid_bounds.IsEmpty() ? 0 : centroid_bounds.LargestAxis();
+		result.split = begin + count / 2;
+		std::nth_element(references.begin() + begin, references.begin() + result.split, references.begin() + end,
+			[axis](const BuildReference &a, const BuildReference &b) { return a.centroid[axis] < b.centroid[axis]; });
+	}
+	else if (best_cost >= options.IntersectionCost * count && count <= options.MaxLeafSize)
+	{
+		result.make_leaf = true;
+	}
+	else
+	{
+		result.cost = best_cost;
+	}
+
+	return result;
+}
+
+static void MakeLeaf(BVH::Node &node, std::vector<uint32_t> &primitive_indices, const std::vector<BuildReference> &references, size_t begin, size_t end)
+{
+	node.offset = static_cast<uint32_t>(primitive_indices.size());
+	node.primitive_count = static_cast<uint32_t>(end - begin);
+	for (size_t i = begin; i < end; i++)
+	{
+		primitive_indices.emplace_back(references[i].primitive_index);
+	}
+}
+
+static uint32_t BuildRecursive(BuildOutput &output, std::vector<BuildReference> &references, std::vector<float> &scratch,
+	size_t begin, size_t end, size_t depth, const BVHBuildOptions &options)
+{
+	SplitResult split = FindSplit(references, scratch, begin, end, depth, options);
+
+	uint32_t node_index = static_cast<uint32_t>(output.nodes.size());
+	output.nodes.emplace_back();
+	output.nodes[node_index].primitive_count = 0;
+
+	if (split.make_leaf)
+	{
+		output.nodes[node_index].bounds = split.bounds;
+		MakeLeaf(output.nodes[node_index], output.primitive_indices, references, begin, end);
+		return node_index;
+	}
+
+	uint32_t first_child = BuildRecursive(output, references, scratch, begin, split.split, depth + 1, options);
+	uint32_t second_child = BuildRecursive(output, references, scratch, split.split, end, depth + 1, options);
+	output.nodes[node_index].offset = second_child;
+	output.nodes[node_index].bounds = output.nodes[first_child].bounds;
+	output.nodes[node_index].bounds.Expand(output.nodes[second_child].bounds);
+
+	return node_index;
+}
+
+#pragma region Parallel build
+
+class BuildTask : public ThreadPool::IThreadPoolTask
+{
+public:
+	BuildTask(std::function<void()> &&work) : work(std::move(work)) {}
+
+	void Execute() override
+	{
+		work();
+	}
+
+private:
+	std::function<void()> work;
+};
+
+// Runs work(0) ... work(count - 1), on the pool when there is one
+static void RunTasks(ThreadPool *pool, size_t count, const std::function<void(size_t)> &work)
+{
+	if (nullptr == pool)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			work(i);
+		}
+
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		pool->EnqueueTask(std::make_shared<BuildTask>([&work, i]() { work(i); }));
+	}
+
+	pool->BlockUntilComplete();
+}
+
+// The top of the tree is split serially until the ranges are small enough to hand out as
+// independent subtree builds. Each subtree is built into its own buffers and spliced back in
+// depth-first order afterwards so the "first child follows its parent" layout is preserved.
+struct SubtreeJob
+{
+	size_t begin;
+	size_t end;
+	size_t depth;
+	BuildOutput output;
+};
+
+struct TopLevelNode
+{
+	// Non-negative values index top level nodes, negative values are -(job index + 1)
+	int64_t children[2];
+};
+
+static int64_t PartitionTopLevel(std::vector<TopLevelNode> &top_level_nodes, std::vector<std::unique_ptr<SubtreeJob>> &jobs,
+	std::vector<BuildReference> &references, std::vector<float> &scratch, size_t begin, size_t end, size_t depth,
+	size_t subtree_size, const BVHBuildOptions &options)
+{
+	if (end - begin > subtree_size)
+	{
+		SplitResult split = FindSplit(references, scratch, begin, end, depth, options);
+		if (!split.make_leaf && split.split > begin && split.split < end)
+		{
+			int64_t node_index = static_cast<int64_t>(top_level_nodes.size());
+			top_level_nodes.emplace_back();
+
+			int64_t first_child = PartitionTopLevel(top_level_nodes, jobs, references, scratch, begin, split.split, depth + 1, subtree_size, options);
+			int64_t second_child = PartitionTopLevel(top_level_nodes, jobs, references, scratch, split.split, end, depth + 1, subtree_size, options);
+			top_level_nodes[node_index].children[0] = first_child;
+			top_level_nodes[node_index].children[1] = second_child;
+			return node_index;
+		}
+	}
+
+	std::unique_ptr<SubtreeJob> job = std::make_unique<SubtreeJob>();
+	job->begin = begin;
+	job->end = end;
+	job->depth = depth;
+	jobs.emplace_back(std::move(job));
+	return -static_cast<int64_t>(jobs.size());
+}
+
+static void EmitTopLevel(const std::vector<TopLevelNode> &top_level_nodes, const std::vector<std::unique_ptr<SubtreeJob>> &jobs,
+	int64_t reference, BuildOutput &output)
+{
+	if (reference < 0)
+	{
+		const BuildOutput &subtree = jobs[static_cast<size_t>(-reference - 1)]->output;
+		uint32_t node_base = static_cast<uint32_t>(output.nodes.size());
+		uint32_t primitive_base = static_cast<uint32_t>(output.primitive_indices.size());
+
+		for (BVH::Node node : subtree.nodes)
+		{
+			node.offset += node.IsLeaf() ? primitive_base : node_base;
+			output.nodes.emplace_back(node);
+		}
+
+		output.primitive_indices.insert(output.primitive_indices.end(), subtree.primitive_indices.begin(), subtree.primitive_indices.end());
+		return;
+	}
+
+	const TopLevelNode &top_level_node = top_level_nodes[static_cast<size_t>(reference)];
+	size_t node_index = output.nodes.size();
+	output.nodes.emplace_back();
+	output.nodes[node_index].primitive_count = 0;
+
+	EmitTopLevel(top_level_nodes, jobs, top_level_node.children[0], output);
+	output.nodes[node_index].offset = static_cast<uint32_t>(output.nodes.size());
+	EmitTopLevel(top_level_nodes, jobs, top_level_node.children[1], output);
+
+	output.nodes[node_index].bounds = output.nodes[node_index + 1].bounds;
+	output.nodes[node_index].bounds.Expand(output.nodes[output.nodes[node_index].offset].bounds);
+}
+
+static void BuildParallel(BuildOutput &output, std::vector<BuildReference> &references, ThreadPool &pool, size_t thread_count, const BVHBuildOptions &options)
+{
+	// Aim for several subtrees per thread so uneven subtrees still balance out
+	size_t subtree_size = std::max<size_t>(minimum_parallel_subtree_size, references.size() / (8 * std::max<size_t>(1, thread_count)));
+
+	std::vector<TopLevelNode> top_level_nodes;
+	std::vector<std::unique_ptr<SubtreeJob>> jobs;
+	std::vector<float> scratch;
+	int64_t root = PartitionTopLevel(top_level_nodes, jobs, references, scratch, 0, references.size(), 0, subtree_size, options);
+
+	RunTasks(&pool, jobs.size(), [&](size_t job_index)
+		{
+			SubtreeJob &job = *jobs[job_index];
+			std::vector<float> job_scratch;
+			job.output.nodes.reserve(2 * (job.end - job.begin));
+			job.output.primitive_indices.reserve(job.end - job.begin);
+			BuildRecursive(job.output, references, job_scratch, job.begin, job.end, job.depth, options);
+		});
+
+	EmitTopLevel(top_level_nodes, jobs, root, output);
+}
+
+#pragma endregion
+
+#pragma region Spatial splits
+
+// SBVH (Stich et al. 2009): where the children of the best object split overlap, the node may
+// instead be cut by an axis aligned plane. References straddling the plane are clipped into
+// both children, so each node gets its own copy of its references instead of a range.
+struct SpatialBuildState
+{
+	const BVH::PrimitiveClipper &clip_primitive;
+	const BVHBuildOptions &options;
+	float root_area;
+	// Duplicate references that may still be created
+	size_t remaining_budget;
+	std::vector<float> scratch;
+};
+
+struct SpatialBin
+{
+	BoundingBox bounds;
+	// References whose clipped extent starts and ends in this bin
+	size_t entry_count;
+	size_t exit_count;
+};
+
+static BoundingBox ClipReference(const SpatialBuildState &state, const BuildReference &reference, const BoundingBox &clip_bounds)
+{
+	BoundingBox bounds = reference.bounds.Overlap(clip_bounds);
+	if (bounds.IsEmpty() || !state.clip_primitive)
+	{
+		return bounds;
+	}
+
+	// The clipper only sees the primitive, keep the result inside the part this reference covers
+	return state.clip_primitive(reference.primitive_index, bounds).Overlap(bounds);
+}
+
+// Chopped binning: every reference is clipped into each bin it overlaps, and the planes between
+// bins are evaluated with the references counted on both sides of the planes they straddle
+static float FindSpatialSplit(const SpatialBuildState &state, const std::vector<BuildReference> &references, const BoundingBox &node_bounds,
+	float parent_area, int &out_axis, float &out_position)
+{
+	static const size_t max_bin_count = 64;
+	const size_t bin_count = std::max<size_t>(2, std::min<size_t>(max_bin_count, state.options.BinCount));
+	const BVHBuildOptions &options = state.options;
+
+	float best_cost = std::numeric_limits<float>::infinity();
+	SpatialBin bins[max_bin_count];
+	float right_areas[max_bin_count];
+	size_t right_counts[max_bin_count];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float extent = node_bounds.Extent(axis);
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		const float minimum = node_bounds.min[axis];
+		const float bin_size = extent / bin_count;
+		auto bin_index = [&](float position)
+		{
+			return std::min<size_t>(bin_count - 1, static_cast<size_t>(std::max(0.0f, (position - minimum) / bin_size)));
+		};
+
+		for (size_t bin = 0; bin < bin_count; bin++)
+		{
+			bins[bin] = { BoundingBox(), 0, 0 };
+		}
+
+		for (const auto &reference : references)
+		{
+			const size_t first_bin = bin_index(reference.bounds.min[axis]);
+			const size_t last_bin = bin_index(reference.bounds.max[axis]);
+			for (size_t bin = first_bin; bin <= last_bin; bin++)
+			{
+				BoundingBox slab = reference.bounds;
+				slab.min[axis] = bin == first_bin ? reference.bounds.min[axis] : minimum + bin * bin_size;
+				slab.max[axis] = bin == last_bin ? reference.bounds.max[axis] : minimum + (bin + 1) * bin_size;
+				bins[bin].bounds.Expand(first_bin == last_bin ? reference.bounds : ClipReference(state, reference, slab));
+			}
+
+			bins[first_bin].entry_count++;
+			bins[last_bin].exit_count++;
+		}
+
+		BoundingBox right_bounds;
+		size_t right_count = 0;
+		for (size_t bin = bin_count - 1; bin > 0; bin--)
+		{
+			right_bounds.Expand(bins[bin].bounds);
+			right_count += bins[bin].exit_count;
+			right_areas[bin] = right_bounds.SurfaceArea();
+			right_counts[bin] = right_count;
+		}
+
+		BoundingBox left_bounds;
+		size_t left_count = 0;
+		for (size_t bin = 1; bin < bin_count; bin++)
+		{
+			left_bounds.Expand(bins[bin - 1].bounds);
+			left_count += bins[bin - 1].entry_count;
+			if (left_count == 0 || right_counts[bin] == 0)
+			{
+				continue;
+			}
+
+			float cost = options.TraversalCost + options.IntersectionCost *
+				(left_bounds.SurfaceArea() * left_count + right_areas[bin] * right_counts[bin]) / parent_area;
+
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				out_axis = axis;
+				out_position = minimum + bin * bin_size;
+			}
+		}
+	}
+
+	return best_cost;
+}
+
+// Distributes references on either side of the plane. A straddling reference is only duplicated
+// when that is cheaper than growing one child to hold all of it, and while the budget lasts.
+static void PartitionSpatial(SpatialBuildState &state, const std::vector<BuildReference> &references, int axis, float position,
+	std::vector<BuildReference> &out_left, std::vector<BuildReference> &out_right)
+{
+	struct StraddlingReference
+	{
+		size_t reference_index;
+		BoundingBox left_bounds;
+		BoundingBox right_bounds;
+	};
+
+	std::vector<StraddlingReference> straddling;
+	BoundingBox left_bounds;
+	BoundingBox right_bounds;
+
+	for (size_t i = 0; i < references.size(); i++)
+	{
+		const BuildReference &reference = references[i];
+		if (reference.bounds.max[axis] <= position)
+		{
+			out_left.emplace_back(reference);
+			left_bounds.Expand(reference.bounds);
+		}
+		else if (reference.bounds.min[axis] >= position)
+		{
+			out_right.emplace_back(reference);
+			right_bounds.Expand(reference.bounds);
+		}
+		else
+		{
+			BoundingBox left_half = reference.bounds;
+			BoundingBox right_half = reference.bounds;
+			left_half.max[axis] = position;
+			right_half.min[axis] = position;
+			straddling.push_back({ i, ClipReference(state, reference, left_half), ClipReference(state, reference, right_half) });
+			left_bounds.Expand(straddling.back().left_bounds);
+			right_bounds.Expand(straddling.back().right_bounds);
+		}
+	}
+
+	// Counts as if every straddling reference was duplicated, corrected as references are kept whole
+	size_t left_count = out_left.size() + straddling.size();
+	size_t right_count = out_right.size() + straddling.size();
+
+	for (const auto &piece : straddling)
+	{
+		const BuildReference &reference = references[piece.reference_index];
+		BoundingBox left_with_reference = left_bounds;
+		BoundingBox right_with_reference = right_bounds;
+		left_with_reference.Expand(reference.bounds);
+		right_with_reference.Expand(reference.bounds);
+
+		// Constant factors of the SAH cancel out between the three choices
+		const float duplicate_cost = left_bounds.SurfaceArea() * left_count + right_bounds.SurfaceArea() * right_count;
+		const float left_cost = left_with_reference.SurfaceArea() * left_count + right_bounds.SurfaceArea() * (right_count - 1);
+		const float right_cost = left_bounds.SurfaceArea() * (left_count - 1) + right_with_reference.SurfaceArea() * right_count;
+
+		// Clipping can leave nothing on one side when the primitive only touches the plane
+		const bool can_duplicate = state.remaining_budget > 0 && !piece.left_bounds.IsEmpty() && !piece.right_bounds.IsEmpty();
+		if (can_duplicate && duplicate_cost < left_cost && duplicate_cost < right_cost)
+		{
+			out_left.emplace_back(MakeReference(piece.left_bounds, reference.primitive_index));
+			out_right.emplace_back(MakeReference(piece.right_bounds, reference.primitive_index));
+			state.remaining_budget--;
+		}
+		else if (left_cost <= right_cost)
+		{
+			out_left.emplace_back(reference);
+			left_bounds = left_with_reference;
+			right_count--;
+		}
+		else
+		{
+			out_right.emplace_back(reference);
+			right_bounds = right_with_reference;
+			left_count--;
+		}
+	}
+}
+
+static uint32_t BuildSpatialRecursive(BuildOutput &output, SpatialBuildState &state, std::vector<BuildReference> &&references, size_t depth)
+{
+	const size_t count = references.size();
+	SplitResult split = FindSplit(references, state.scratch, 0, count, depth, state.options);
+
+	uint32_t node_index = static_cast<uint32_t>(output.nodes.size());
+	output.nodes.emplace_back();
+	output.nodes[node_index].primitive_count = 0;
+
+	if (split.make_leaf)
+	{
+		output.nodes[node_index].bounds = split.bounds;
+		MakeLeaf(output.nodes[node_index], output.primitive_indices, references, 0, count);
+		return node_index;
+	}
+
+	std::vector<BuildReference> left;
+	std::vector<BuildReference> right;
+
+	// Only look for a spatial split where the object split leaves a significant overlap
+	if (depth < median_split_depth && state.remaining_budget > 0 && split.cost < std::numeric_limits<float>::infinity())
+	{
+		BoundingBox object_left_bounds;
+		BoundingBox object_right_bounds;
+		for (size_t i = 0; i < count; i++)
+		{
+			(i < split.split ? object_left_bounds : object_right_bounds).Expand(references[i].bounds);
+		}
+
+		float overlap_area = object_left_bounds.Overlap(object_right_bounds).SurfaceArea();
+		if (overlap_area > state.options.SpatialSplitOverlap * state.root_area)
+		{
+			int spatial_axis = -1;
+			float spatial_position = 0.0f;
+			float spatial_cost = FindSpatialSplit(state, references, split.bounds, split.bounds.SurfaceArea(), spatial_axis, spatial_position);
+			if (spatial_axis != -1 && spatial_cost < split.cost)
+			{
+				PartitionSpatial(state, references, spatial_axis, spatial_position, left, right);
+				if (left.empty() || right.empty())
+				{
+					left.clear();
+					right.clear();
+				}
+			}
+		}
+	}
+
+	if (left.empty())
+	{
+		left.assign(references.begin(), references.begin() + split.split);
+		right.assign(references.begin() + split.split, references.end());
+	}
+
+	// The children own their references from here on
+	references.clear();
+	references.shrink_to_fit();
+
+	uint32_t first_child = BuildSpatialRecursive(output, state, std::move(left), depth + 1);
+	uint32_t second_child = BuildSpatialRecursive(output, state, std::move(right), depth + 1);
+	output.nodes[node_index].offset = second_child;
+	output.nodes[node_index].bounds = output.nodes[first_child].bounds;
+	output.nodes[node_index].bounds.Expand(output.nodes[second_child].bounds);
+
+	return node_index;
+}
+
+static void BuildSpatial(BuildOutput &output, std::vector<BuildReference> &&references, const BVH::PrimitiveClipper &clip_primitive, const BVHBuildOptions &options)
+{
+	BoundingBox root_bounds;
+	for (const auto &reference : references)
+	{
+		root_bounds.Expand(reference.bounds);
+	}
+
+	SpatialBuildState state = { clip_primitive, options, root_bounds.SurfaceArea(),
+		static_cast<size_t>(std::max(0.0f, options.SpatialSplitBudget) * references.size()), {} };
+	BuildSpatialRecursive(output, state, std::move(references), 0);
+}
+
+#pragma endregion
+
+#pragma region Morton codes
+
+// Spreads the low 21 bits of value so there are two zero bits between each of them
+static uint64_t ExpandBits(uint64_t value)
+{
+	value &= 0x1fffff;
+	value = (value | value << 32) & 0x1f00000000ffff;
+	value = (value | value << 16) & 0x1f0000ff0000ff;
+	value = (value | value << 8) & 0x100f00f00f00f00f;
+	value = (value | value << 4) & 0x10c30c30c30c30c3;
+	value = (value | value << 2) & 0x1249249249249249;
+	return value;
+}
+
+struct MortonKey
+{
+	uint64_t code;
+	uint32_t reference_index;
+};
+
+// Serial LSD radix sort of keys by the low "bits" bits of their code, 8 bits per pass
+static void RadixSortKeys(MortonKey *keys, MortonKey *scratch, size_t count, unsigned int bits)
+{
+	for (unsigned int shift = 0; shift < bits; shift += 8)
+	{
+		size_t offsets[256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			offsets[(keys[i].code >> shift) & 0xff]++;
+		}
+
+		size_t total = 0;
+		for (size_t digit = 0; digit < 256; digit++)
+		{
+			size_t digit_count = offsets[digit];
+			offsets[digit] = total;
+			total += digit_count;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[offsets[(keys[i].code >> shift) & 0xff]++] = keys[i];
+		}
+
+		std::copy(scratch, scratch + count, keys);
+	}
+}
+
+// Assigns Morton codes and sorts the references by them. The top 8 bits scatter the keys into
+// buckets in parallel, then every bucket finishes with a serial radix sort over the remaining bits.
+static void SortByMortonCode(std::vector<BuildReference> &references, ThreadPool *pool, size_t thread_count, const BVHBuildOptions &options)
+{
+	const unsigned int code_bits = std::max(3u, std::min(63u, options.MortonCodeBits - options.MortonCodeBits % 3));
+	const unsigned int bucket_shift = code_bits > 8 ? code_bits - 8 : 0;
+
+	BoundingBox centroid_bounds;
+	for (const auto &reference : references)
+	{
+		centroid_bounds.Expand(Vector3<float>(reference.centroid[0], reference.centroid[1], reference.centroid[2]));
+	}
+
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroid_bounds.Extent(axis);
+		scale[axis] = extent > 0.0f ? 2097151.0f / extent : 0.0f;
+	}
+
+	const size_t count = references.size();
+	const size_t chunk_count = nullptr == pool ? 1 : std::min<size_t>(count, 4 * thread_count);
+	const size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+	std::vector<MortonKey> keys(count);
+	std::vector<MortonKey> sorted_keys(count);
+	std::vector<std::array<size_t, 256>> chunk_offsets(chunk_count);
+
+	RunTasks(pool, chunk_count, [&](size_t chunk)
+		{
+			std::array<size_t, 256> &histogram = chunk_offsets[chunk];
+			histogram.fill(0);
+			for (size_t i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); i++)
+			{
+				BuildReference &reference = references[i];
+				uint64_t code = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					uint64_t quantized = static_cast<uint64_t>((reference.centroid[axis] - centroid_bounds.min[axis]) * scale[axis]);
+					code |= ExpandBits(std::min<uint64_t>(quantized, 2097151)) << (2 - axis);
+				}
+
+				// Keep the most significant bits when fewer than 63 are requested
+				reference.morton_code = code >> (63 - code_bits);
+				keys[i] = { reference.morton_code, static_cast<uint32_t>(i) };
+				histogram[reference.morton_code >> bucket_shift]++;
+			}
+		});
+
+	// Turn the per chunk histograms into scatter offsets, ordered by bucket and then by chunk
+	std::array<size_t, 257> bucket_starts;
+	size_t total = 0;
+	for (size_t bucket = 0; bucket < 256; bucket++)
+	{
+		bucket_starts[bucket] = total;
+		for (size_t chunk = 0; chunk < chunk_count; chunk++)
+		{
+			size_t bucket_count = chunk_offsets[chunk][bucket];
+			chunk_offsets[chunk][bucket] = total;
+			total += bucket_count;
+		}
+	}
+	bucket_starts[256] = total;
+
+	RunTasks(pool, chunk_count, [&](size_t chunk)
+		{
+			std::array<size_t, 256> &offsets = chunk_offsets[chunk];
+			for (size_t i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); i++)
+			{
+				sorted_keys[offsets[keys[i].code >> bucket_shift]++] = keys[i];
+			}
+		});
+
+	RunTasks(pool, 256, [&](size_t bucket)
+		{
+			size_t bucket_begin = bucket_starts[bucket];
+			size_t bucket_count = bucket_starts[bucket + 1] - bucket_begin;
+			if (bucket_count > 1)
+			{
+				RadixSortKeys(&sorted_keys[bucket_begin], &keys[bucket_begin], bucket_count, bucket_shift);
+			}
+		});
+
+	std::vector<BuildReference> sorted_references;
+	sorted_references.reserve(count);
+	for (const auto &key : sorted_keys)
+	{
+		sorted_references.emplace_back(references[key.reference_index]);
+	}
+
+	references = std::move(sorted_references);
+}
+
+#pragma endregion
+
+BVH::BVH(const std::vector<BoundingBox> &primitive_bounds, const BVHBuildOptions &options, const PrimitiveClipper &clip_primitive)
+	: build_time_ms(0), traversal_cost(options.TraversalCost), intersection_cost(options.IntersectionCost)
+{
+	ElapsedTimer build_timer;
+
+	std::vector<BuildReference> references;
+	references.reserve(primitive_bounds.size());
+
+	for (size_t i = 0; i < primitive_bounds.size(); i++)
+	{
+		const BoundingBox &bounds = primitive_bounds[i];
+		if (bounds.IsEmpty())
+		{
+			// Nothing can hit an empty primitive so leave it out of the tree
+			continue;
+		}
+
+		references.emplace_back(MakeReference(bounds, static_cast<uint32_t>(i)));
+	}
+
+	if (references.empty())
+	{
+		return;
+	}
+
+	BuildOutput output;
+	output.nodes.reserve(2 * references.size());
+	output.primitive_indices.reserve(references.size());
+
+	size_t thread_count = options.Pool != nullptr ? options.Pool->ThreadCount() : std::thread::hardware_concurrency();
+	bool build_in_parallel = BVHBuilder::SweepSAH != options.Builder && BVHBuilder::SBVH != options.Builder && thread_count > 1 &&
+		references.size() >= options.ParallelBuildThreshold;
+
+	ThreadPool *pool = nullptr;
+	std::unique_ptr<ThreadPool> build_pool;
+	if (build_in_parallel)
+	{
+		if (nullptr == options.Pool)
+		{
+			build_pool = std::make_unique<ThreadPool>(thread_count, 1000);
+		}
+
+		pool = nullptr != options.Pool ? options.Pool : build_pool.get();
+	}
+
+	if (BVHBuilder::LBVH == options.Builder)
+	{
+		SortByMortonCode(references, pool, thread_count, options);
+	}
+
+	if (BVHBuilder::SBVH == options.Builder)
+	{
+		BuildSpatial(output, std::move(references), clip_primitive, options);
+	}
+	else if (nullptr != pool)
+	{
+		BuildParallel(output, references, *pool, thread_count, options);
+	}
+	else
+	{
+		std::vector<float> scratch;
+		BuildRecursive(output, references, scratch, 0, references.size(), 0, options);
+	}
+
+	nodes = std::move(output.nodes);
+	primitive_indices = std::move(output.primitive_indices);
+	sah_cost = build_sah_cost = ComputeSAHCost();
+
+	build_time_ms = build_timer.Poll().count();
+}
+
+BVH::BVH(std::span<const Node> built_nodes, std::span<const uint32_t> built_primitive_indices, const BVHBuildOptions &options)
+	: nodes(built_nodes.begin(), built_nodes.end()), primitive_indices(built_primitive_indices.begin(), built_primitive_indices.end()),
+	build_time_ms(0), traversal_cost(options.TraversalCost), intersection_cost(options.IntersectionCost)
+{
+	const size_t node_count = nodes.size();
+	for (size_t node_index = 0; node_index < node_count; node_index++)
+	{
+		const Node &node = nodes[node_index];
+		bool valid = node.IsLeaf() ?
+			static_cast<size_t>(node.offset) + node.primitive_count <= primitive_indices.size() :
+			node_index + 1 < node.offset && node.offset < node_count;
+
+		if (!valid)
+		{
+			throw std::exception("BVH nodes do not form a valid hierarchy");
+		}
+	}
+
+	if (ComputeStatistics().MaxDepth > MaxDepth)
+	{
+		throw std::exception("BVH is deeper than the traversal stack");
+	}
+
+	sah_cost = build_sah_cost = ComputeSAHCost();
+}
+
+float BVH::ComputeSAHCost() const
+{
+	if (nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	// The cost is a sum over all nodes, so their order does not matter
+	float weighted_area = 0.0f;
+	for (const auto &node : nodes)
+	{
+		weighted_area += node.bounds.SurfaceArea() * (node.IsLeaf() ? intersection_cost * node.primitive_count : traversal_cost);
+	}
+
+	float root_area = nodes[0].bounds.SurfaceArea();
+	return root_area > 0.0f ? weighted_area / root_area : weighted_area;
+}
+
+void BVH::RefitNode(uint32_t node_index, const std::vector<BoundingBox> &slot_bounds)
+{
+	Node &node = nodes[node_index];
+	node.bounds = BoundingBox();
+	if (node.IsLeaf())
+	{
+		for (uint32_t slot = node.offset; slot < node.offset + node.primitive_count; slot++)
+		{
+			node.bounds.Expand(slot_bounds[slot]);
+		}
+	}
+	else
+	{
+		node.bounds.Expand(nodes[node_index + 1].bounds);
+		node.bounds.Expand(nodes[node.offset].bounds);
+	}
+}
+
+// Splits the subtree occupying nodes [node_index, end) into independent ranges of about target_size
+// nodes. Nodes above those ranges are collected in top_nodes, in increasing index order.
+static void CollectRefitRanges(const std::vector<BVH::Node> &nodes, uint32_t node_index, uint32_t end, uint32_t target_size,
+	std::vector<uint32_t> &top_nodes, std::vector<std::pair<uint32_t, uint32_t>> &ranges)
+{
+	if (end - node_index <= target_size || nodes[node_index].IsLeaf())
+	{
+		ranges.emplace_back(node_index, end);
+		return;
+	}
+
+	top_nodes.emplace_back(node_index);
+	CollectRefitRanges(nodes, node_index + 1, nodes[node_index].offset, target_size, top_nodes, ranges);
+	CollectRefitRanges(nodes, nodes[node_index].offset, end, target_size, top_nodes, ranges);
+}
+
+float BVH::Refit(const std::vector<BoundingBox> &slot_bounds, ThreadPool *pool)
+{
+	if (slot_bounds.size() != primitive_indices.size())
+	{
+		throw std::exception("Refit needs the bounds of every primitive slot");
+	}
+
+	if (nodes.empty())
+	{
+		return sah_cost;
+	}
+
+	// Children always have larger indices than their parent, so a reverse sweep over a
+	// subtree's contiguous node range visits every child before its parent
+	const uint32_t node_count = static_cast<uint32_t>(nodes.size());
+	if (nullptr == pool || pool->ThreadCount() < 2 || node_count < minimum_parallel_subtree_size)
+	{
+		for (uint32_t node_index = node_count; node_index-- > 0;)
+		{
+			RefitNode(node_index, slot_bounds);
+		}
+	}
+	else
+	{
+		std::vector<uint32_t> top_nodes;
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+		uint32_t target_size = std::max<uint32_t>(minimum_parallel_subtree_size / 4, node_count / static_cast<uint32_t>(8 * pool->ThreadCount()));
+		CollectRefitRanges(nodes, 0, node_count, target_size, top_nodes, ranges);
+
+		RunTasks(pool, ranges.size(), [&](size_t range_index)
+			{
+				for (uint32_t node_index = ranges[range_index].second; node_index-- > ranges[range_index].first;)
+				{
+					RefitNode(node_index, slot_bounds);
+				}
+			});
+
+		for (auto top_node = top_nodes.rbegin(); top_node != top_nodes.rend(); top_node++)
+		{
+			RefitNode(*top_node, slot_bounds);
+		}
+	}
+
+	sah_cost = ComputeSAHCost();
+	return sah_cost;
+}
+
+BVH::Statistics BVH::ComputeStatistics() const
+{
+	Statistics statistics;
+	statistics.BuildTimeMilliseconds = build_time_ms;
+	statistics.NodeCount = nodes.size();
+	statistics.ReferenceCount = primitive_indices.size();
+
+	if (nodes.empty())
+	{
+		return statistics;
+	}
+
+	const float root_area = nodes[0].bounds.SurfaceArea();
+
+	struct StackEntry
+	{
+		uint32_t node_index;
+		uint32_t depth;
+	};
+
+	std::vector<StackEntry> stack;
+	stack.push_back({ 0, 1 });
+	while (!stack.empty())
+	{
+		StackEntry entry = stack.back();
+		stack.pop_back();
+
+		const Node &node = nodes[entry.node_index];
+		float relative_area = root_area > 0.0f ? node.bounds.SurfaceArea() / root_area : 1.0f;
+		statistics.MaxDepth = std::max<uint32_t>(statistics.MaxDepth, entry.depth);
+
+		if (node.IsLeaf())
+		{
+			statistics.SAHCost += intersection_cost * node.primitive_count * relative_area;
+			statistics.LeafCount++;
+			if (statistics.LeafSizeHistogram.size() <= node.primitive_count)
+			{
+				statistics.LeafSizeHistogram.resize(node.primitive_count + 1, 0);
+			}
+
+			statistics.LeafSizeHistogram[node.primitive_count]++;
+		}
+		else
+		{
+			statistics.SAHCost += traversal_cost * relative_area;
+			stack.push_back({ entry.node_index + 1, entry.depth + 1 });
+			stack.push_back({ node.offset, entry.depth + 1 });
+		}
+	}
+
+	return statistics;
+}
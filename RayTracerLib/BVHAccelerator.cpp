@@ -0,0 +1,228 @@
+#include "BVHAccelerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using RayTracer::BVHAccelerator;
+using RayTracer::BVH;
+using RayTracer::TraversalHierarchy;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BoundingBox;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Ray;
+using RayTracer::RayPacket;
+using RayTracer::SphereArray;
+using RayTracer::Vector3;
+using RayTracer::ThreadPool;
+
+static std::vector<BoundingBox> GetObjectBounds(const std::vector<const IIntersectable *> &objects)
+{
+	std::vector<BoundingBox> bounds;
+	bounds.reserve(objects.size());
+	for (const auto &object : objects)
+	{
+		bounds.emplace_back(object->Bounds());
+	}
+
+	return bounds;
+}
+
+BVHAccelerator::BVHAccelerator(const std::vector<const IIntersectable *> &objects, const BVHBuildOptions &options)
+	: bvh(GetObjectBounds(objects), options), build_options(options)
+{
+	// The pool is only borrowed for the build
+	build_options.Pool = nullptr;
+
+	ordered_objects.reserve(bvh.PrimitiveIndices().size());
+	for (const auto &index : bvh.PrimitiveIndices())
+	{
+		ordered_objects.emplace_back(objects[index]);
+	}
+
+	spheres = SphereArray(ordered_objects);
+}
+
+void BVHAccelerator::Rebuild(const BVHBuildOptions &options)
+{
+	// Objects split by an SBVH appear in several slots, build from each of them once
+	std::vector<const IIntersectable *> objects;
+	std::unordered_set<const IIntersectable *> seen_objects;
+	for (const auto &object : ordered_objects)
+	{
+		if (seen_objects.insert(object).second)
+		{
+			objects.emplace_back(object);
+		}
+	}
+
+	ordered_objects.clear();
+
+	bvh = TraversalHierarchy(GetObjectBounds(objects), options);
+	build_options = options;
+	build_options.Pool = nullptr;
+
+	ordered_objects.reserve(bvh.PrimitiveIndices().size());
+	for (const auto &index : bvh.PrimitiveIndices())
+	{
+		ordered_objects.emplace_back(objects[index]);
+	}
+
+	spheres = SphereArray(ordered_objects);
+}
+
+bool BVHAccelerator::Update(ThreadPool *pool)
+{
+	// ordered_objects is already in slot order
+	bvh.Refit(GetObjectBounds(ordered_objects), pool);
+	spheres = SphereArray(ordered_objects);
+	if (!bvh.NeedsRebuild(build_options.RefitRebuildThreshold))
+	{
+		return false;
+	}
+
+	BVHBuildOptions options = build_options;
+	options.Pool = pool;
+	Rebuild(options);
+	return true;
+}
+
+// Closest hit of one ray so far. A sphere hit only gets its intersection built once the traversal is done.
+struct BVHAccelerator::ClosestHit
+{
+	Intersection intersection;
+	const IIntersectable *object = nullptr;
+	int64_t sphere_slot = -1;
+};
+
+bool BVHAccelerator::IntersectSlots(const Ray &ray, const float origin[3], const float direction[3], uint32_t first_slot, uint32_t slot_count,
+	float &max_depth, ClosestHit &closest_hit) const
+{
+	bool intersection_found = false;
+	uint32_t sphere_slot = 0;
+	if (spheres.SphereCount() > 0 && spheres.IntersectsRay(origin, direction, first_slot, slot_count, max_depth, sphere_slot))
+	{
+		closest_hit.sphere_slot = sphere_slot;
+		intersection_found = true;
+	}
+
+	for (uint32_t slot = first_slot; slot < first_slot + slot_count; slot++)
+	{
+		if (spheres.IsSphere(slot))
+		{
+			continue;
+		}
+
+		// Lets the object skip anything beyond the closest hit so far
+		const IIntersectable *object = ordered_objects[slot];
+		ray.SetMaxDepth(max_depth);
+
+		Intersection current_intersection;
+		if (object->IntersectsRay(ray, current_intersection) && current_intersection.Depth() < max_depth)
+		{
+			max_depth = current_intersection.Depth();
+			closest_hit.intersection = current_intersection;
+			closest_hit.object = object;
+			closest_hit.sphere_slot = -1;
+			intersection_found = true;
+		}
+	}
+
+	return intersection_found;
+}
+
+bool BVHAccelerator::FinishClosestHit(const Ray &ray, const float direction[3], float depth, ClosestHit &closest_hit,
+	Intersection &out_intersection_info, const IIntersectable *&out_object) const
+{
+	if (closest_hit.sphere_slot >= 0)
+	{
+		const size_t slot = static_cast<size_t>(closest_hit.sphere_slot);
+		out_intersection_info = spheres.SurfaceIntersection(slot, ray.Origin(), Vector3<float>(direction[0], direction[1], direction[2]), depth);
+		out_object = ordered_objects[slot];
+		return true;
+	}
+
+	if (nullptr != closest_hit.object)
+	{
+		out_intersection_info = closest_hit.intersection;
+		out_object = closest_hit.object;
+		return true;
+	}
+
+	return false;
+}
+
+bool BVHAccelerator::IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info, const IIntersectable *&out_object) const
+{
+	// Hits are kept while closer than max_depth, one at the ray's MaxDepth() still counts
+	const float ray_max_depth = incoming_ray.MaxDepth();
+	float max_depth = std::nextafter(ray_max_depth, std::numeric_limits<float>::infinity());
+
+	const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+	const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+	const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+	ClosestHit closest_hit;
+	bvh.Traverse(incoming_ray, max_depth, [&](uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+		{
+			return IntersectSlots(incoming_ray, origin, direction, first_slot, slot_count, current_max_depth, closest_hit);
+		});
+
+	incoming_ray.SetMaxDepth(ray_max_depth);
+	return FinishClosestHit(incoming_ray, direction, max_depth, closest_hit, out_intersection_info, out_object);
+}
+
+bool BVHAccelerator::Occluded(const Ray &incoming_ray, float max_depth) const
+{
+	const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+	const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+	const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+	return bvh.Traverse(incoming_ray, max_depth, [&](uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+		{
+			uint32_t sphere_slot = 0;
+			bool occluded = spheres.SphereCount() > 0 && spheres.IntersectsRay(origin, direction, first_slot, slot_count, current_max_depth, sphere_slot);
+			for (uint32_t slot = first_slot; slot < first_slot + slot_count && !occluded; slot++)
+			{
+				occluded = !spheres.IsSphere(slot) && ordered_objects[slot]->Occluded(incoming_ray, current_max_depth);
+			}
+
+			if (occluded)
+			{
+				current_max_depth = BVH::StopTraversal;
+			}
+
+			return occluded;
+		});
+}
+
+void BVHAccelerator::IntersectsPacket(const RayPacket &packet, Intersection out_intersections[], const IIntersectable *out_objects[]) const
+{
+	if (!packet.Coherent())
+	{
+		IAccelerationStructure::IntersectsPacket(packet, out_intersections, out_objects);
+		return;
+	}
+
+	float ray_max_depths[RayPacket::MaxSize];
+	float max_depths[RayPacket::MaxSize];
+	ClosestHit closest_hits[RayPacket::MaxSize];
+	for (size_t ray_index = 0; ray_index < packet.Size(); ray_index++)
+	{
+		ray_max_depths[ray_index] = packet[ray_index].MaxDepth();
+		max_depths[ray_index] = std::nextafter(ray_max_depths[ray_index], std::numeric_limits<float>::infinity());
+	}
+
+	bvh.Binary().TraversePacket(packet, max_depths, [&](size_t ray_index, uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+		{
+			return IntersectSlots(packet[ray_index], packet.Origin(ray_index), packet.Direction(ray_index), first_slot, slot_count, current_max_depth, closest_hits[ray_index]);
+		});
+
+	for (size_t ray_index = 0; ray_index < packet.Size(); ray_index++)
+	{
+		out_objects[ray_index] = nullptr;
+		packet[ray_index].SetMaxDepth(ray_max_depths[ray_index]);
+		FinishClosestHit(packet[ray_index], packet.Direction(ray_index), max_depths[ray_index], closest_hits[ray_index], out_intersections[ray_index], out_objects[ray_index]);
+	}
+}
@@ -0,0 +1,160 @@
+#include "Benchmark.h"
+#include "ElapsedTimer.h"
+#include "Mesh.h"
+#include "MeshInstance.h"
+
+#include <iomanip>
+
+using RayTracer::Benchmark;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVHBuilder;
+using RayTracer::Camera;
+using RayTracer::ElapsedTimer;
+using RayTracer::IScene;
+using RayTracer::Intersection;
+using RayTracer::Mesh;
+using RayTracer::MeshGeometry;
+using RayTracer::MeshInstance;
+using RayTracer::Transform;
+using RayTracer::Vector3;
+
+// Every configuration traces all rays this many times and keeps the fastest pass
+static const int benchmark_passes = 3;
+
+static void AppendGeometry(const MeshGeometry &geometry, const Transform &object_to_world,
+	std::vector<Vector3<float>> &vertices, std::vector<Vector3<size_t>> &faces)
+{
+	size_t vertex_offset = vertices.size();
+	for (const auto &vertex : geometry.VertexData())
+	{
+		vertices.emplace_back(object_to_world.TransformPoint(vertex));
+	}
+
+	for (const auto &face : geometry.VertexIndices)
+	{
+		faces.emplace_back(face + Vector3<size_t>(vertex_offset, vertex_offset, vertex_offset));
+	}
+}
+
+Benchmark::Benchmark(const IScene &scene, const Camera &camera)
+{
+	for (const auto &object : scene.Objects())
+	{
+		if (const Mesh *mesh = dynamic_cast<const Mesh *>(object))
+		{
+			AppendGeometry(mesh->Geometry(), Transform(), vertices, faces);
+		}
+		else if (const MeshInstance *instance = dynamic_cast<const MeshInstance *>(object))
+		{
+			AppendGeometry(instance->Geometry(), instance->ObjectToWorld(), vertices, faces);
+		}
+	}
+
+	// The camera's jitter is seeded with the pixel, so every run traces the same jittered rays
+	for (size_t y = 0; y < camera.Resolution().Y; y++)
+	{
+		for (size_t x = 0; x < camera.Resolution().X; x++)
+		{
+			rays.emplace_back(camera.GetRay(x, y, 0));
+		}
+	}
+}
+
+Benchmark::Result Benchmark::MeasureMeshHierarchy(const std::string &name, const BVHBuildOptions &options) const
+{
+	Result result;
+	result.name = name;
+
+	ElapsedTimer timer;
+	MeshGeometry geometry(vertices, faces, options);
+	result.build_time_ms = timer.Poll().count();
+	result.memory_bytes = geometry.HierarchyMemoryBytes();
+
+	double fastest_pass_ms = std::numeric_limits<double>::infinity();
+	for (int pass = 0; pass < benchmark_passes; pass++)
+	{
+		size_t hit_count = 0;
+		timer.Poll();
+		for (const auto &ray : rays)
+		{
+			Intersection intersection;
+			if (geometry.IntersectsRay(ray, intersection))
+			{
+				hit_count++;
+			}
+		}
+
+		fastest_pass_ms = std::min(fastest_pass_ms, timer.Poll().count());
+		result.hit_count = hit_count;
+	}
+
+	result.million_rays_per_second = fastest_pass_ms > 0.0 ? rays.size() / (fastest_pass_ms * 1000.0) : 0.0;
+	return result;
+}
+
+std::vector<Benchmark::Result> Benchmark::MeasureHierarchyLayouts() const
+{
+	std::vector<Result> results;
+
+	BVHBuildOptions options;
+	options.Width = 2;
+	results.emplace_back(MeasureMeshHierarchy("binary", options));
+
+	options.Width = 4;
+	results.emplace_back(MeasureMeshHierarchy("4 wide", options));
+
+	options.Width = 8;
+	results.emplace_back(MeasureMeshHierarchy("8 wide", options));
+
+	options.QuantizedNodes = true;
+	results.emplace_back(MeasureMeshHierarchy("4 wide quantized", options));
+
+	return results;
+}
+
+std::vector<Benchmark::Result> Benchmark::MeasureBuilders() const
+{
+	std::vector<Result> results;
+	const std::pair<const char *, BVHBuilder> builders[] = {
+		{ "binned sah", BVHBuilder::BinnedSAH },
+		{ "sweep sah", BVHBuilder::SweepSAH },
+		{ "sbvh", BVHBuilder::SBVH },
+		{ "lbvh", BVHBuilder::LBVH } };
+
+	for (const auto &builder : builders)
+	{
+		BVHBuildOptions options;
+		options.Builder = builder.second;
+		results.emplace_back(MeasureMeshHierarchy(builder.first, options));
+	}
+
+	return results;
+}
+
+std::vector<Benchmark::Result> Benchmark::MeasureTriangleTests() const
+{
+	std::vector<Result> results;
+
+	BVHBuildOptions options;
+	results.emplace_back(MeasureMeshHierarchy("moller-trumbore", options));
+
+	options.WatertightTriangles = true;
+	results.emplace_back(MeasureMeshHierarchy("watertight", options));
+
+	return results;
+}
+
+void Benchmark::PrintResults(const std::vector<Result> &results, std::ostream &stream) const
+{
+	stream << "[BENCHMARK]: " << faces.size() << " triangles, " << rays.size() << " rays" << std::endl;
+	stream << std::left << std::setw(24) << "configuration" << std::right
+		<< std::setw(12) << "build (ms)" << std::setw(14) << "nodes (KiB)"
+		<< std::setw(12) << "Mrays/s" << std::setw(10) << "hits" << std::endl;
+
+	for (const auto &result : results)
+	{
+		stream << std::left << std::setw(24) << result.name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << result.build_time_ms << std::setw(14) << result.memory_bytes / 1024.0
+			<< std::setw(12) << result.million_rays_per_second << std::setw(10) << result.hit_count << std::endl;
+	}
+}
@@ -1,18 +1,26 @@
 #include "png.h"
 #include "CPURenderer.h"
 #include "Image.h"
+#include "FrameBuffer.h"
 #include "Ray.h"
 #include "IIntersectable.h"
 #include "Color.h"
 #include "IWorld.h"
 #include "IMaterial.h"
 #include "ThreadPool.h"
-#include "PixelRenderTask.h"
+#include "TileRenderTask.h"
+#include "WavefrontRenderTask.h"
+#include "BVHAccelerator.h"
+#include "GridAccelerator.h"
+#include "Mesh.h"
+#include "MeshInstance.h"
+#include "PerformanceLogger.h"
 #include <chrono>
 #include <iostream>
 #include <limits>
 #include <string>
 #include <thread>
+#include <unordered_set>
 
 using RayTracer::CPURenderer;
 using RayTracer::Ray;
@@ -24,11 +32,117 @@ using RayTracer::IMaterial;
 using RayTracer::Color;
 using RayTracer::IImage;
 using RayTracer::Image;
-using RayTracer::PixelRenderTask;
+using RayTracer::FrameBuffer;
+using RayTracer::TileRenderTask;
+using RayTracer::WavefrontRenderTask;
+using RayTracer::ImageTile;
+using RayTracer::BVHAccelerator;
+using RayTracer::GridAccelerator;
+using RayTracer::IAccelerationStructure;
+using RayTracer::AccelerationStructureType;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVH;
+using RayTracer::Mesh;
+using RayTracer::MeshInstance;
+using RayTracer::MeshGeometry;
+using RayTracer::PerformanceTracking::PerformanceSession;
 
-void CPURenderer::Render(size_t max_threads, const Camera &camera, unsigned int samples, 
-	const IScene &scene, std::shared_ptr<IImage> &out_image)
+static void trace_bvh_statistics(const std::unique_ptr<PerformanceSession> &performance_session, const std::string &name, const BVH &bvh)
 {
+	BVH::Statistics statistics = bvh.ComputeStatistics();
+	TRACE_COUNTERS(performance_session, name, {
+		{ "build_time_ms", statistics.BuildTimeMilliseconds },
+		{ "sah_cost", statistics.SAHCost },
+		{ "max_depth", (double)statistics.MaxDepth },
+		{ "node_count", (double)statistics.NodeCount },
+		{ "leaf_count", (double)statistics.LeafCount },
+		{ "reference_count", (double)statistics.ReferenceCount } });
+
+	std::vector<std::pair<std::string, double>> leaf_sizes;
+	for (size_t size = 1; size < statistics.LeafSizeHistogram.size(); size++)
+	{
+		leaf_sizes.emplace_back("leaves_of_size_" + std::to_string(size), (double)statistics.LeafSizeHistogram[size]);
+	}
+	TRACE_COUNTERS(performance_session, name + "_leaf_sizes", leaf_sizes);
+}
+
+static void trace_acceleration_structure_statistics(const std::unique_ptr<PerformanceSession> &performance_session, const IScene &scene, const IAccelerationStructure &acceleration_structure)
+{
+	if (!performance_session)
+	{
+		return;
+	}
+
+	if (const BVHAccelerator *bvh_accelerator = dynamic_cast<const BVHAccelerator *>(&acceleration_structure))
+	{
+		trace_bvh_statistics(performance_session, "top_level_bvh", bvh_accelerator->Hierarchy());
+	}
+	else if (const GridAccelerator *grid_accelerator = dynamic_cast<const GridAccelerator *>(&acceleration_structure))
+	{
+		GridAccelerator::Statistics statistics = grid_accelerator->ComputeStatistics();
+		TRACE_COUNTERS(performance_session, "top_level_grid", {
+			{ "build_time_ms", statistics.BuildTimeMilliseconds },
+			{ "resolution_x", (double)statistics.Resolution[0] },
+			{ "resolution_y", (double)statistics.Resolution[1] },
+			{ "resolution_z", (double)statistics.Resolution[2] },
+			{ "cell_count", (double)statistics.CellCount },
+			{ "empty_cell_count", (double)statistics.EmptyCellCount },
+			{ "reference_count", (double)statistics.ReferenceCount } });
+	}
+
+	// Mesh BVHs are built when the scene is loaded, report each shared geometry once
+	std::unordered_set<const MeshGeometry *> reported_geometry;
+	for (const auto &object : scene.Objects())
+	{
+		const MeshGeometry *geometry = nullptr;
+		if (const Mesh *mesh = dynamic_cast<const Mesh *>(object))
+		{
+			geometry = &mesh->Geometry();
+		}
+		else if (const MeshInstance *instance = dynamic_cast<const MeshInstance *>(object))
+		{
+			geometry = &instance->Geometry();
+		}
+
+		if (nullptr != geometry && reported_geometry.insert(geometry).second)
+		{
+			trace_bvh_statistics(performance_session, "mesh_bvh_" + std::to_string(reported_geometry.size() - 1), geometry->Hierarchy());
+		}
+	}
+}
+
+// Pixels rendered together by one wavefront task, enough rays per bounce to amortize the sorting
+static const size_t wavefront_batch_pixels = 4096;
+
+static std::unique_ptr<IAccelerationStructure> create_acceleration_structure(const CPURenderer::CPURendererParameters &params, const BVHBuildOptions &build_options)
+{
+	const std::vector<const RayTracer::IIntersectable *> &objects = params.scene.Objects();
+
+	AccelerationStructureType type = params.acceleration_structure;
+	if (AccelerationStructureType::Automatic == type)
+	{
+		type = GridAccelerator::SuitsObjects(objects, params.grid_build_options) ? AccelerationStructureType::Grid : AccelerationStructureType::BVH;
+	}
+
+	if (AccelerationStructureType::Grid == type)
+	{
+		std::cout << "\t[SETUP]: Using a uniform grid" << std::endl;
+		return std::make_unique<GridAccelerator>(objects, params.grid_build_options);
+	}
+
+	std::cout << "\t[SETUP]: Using a BVH" << std::endl;
+	return std::make_unique<BVHAccelerator>(objects, build_options);
+}
+
+void CPURenderer::Render(const CPURendererParameters &params, std::shared_ptr<IImage> &out_image)
+{
+	std::unique_ptr<PerformanceSession> performance_session = params.trace_performance ?
+		std::make_unique<PerformanceSession>(PerformanceSession::PerformanceTrackingGranularity::Coarse, "cpu_performance_log.json") : nullptr;
+	TRACE_FUNCTION(performance_session);
+
+	const Camera &camera = params.camera;
+	const IScene &scene = params.scene;
+
 	auto time = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double, std::milli> cpuTime;
 #define PRINT_TIME(message) \
@@ -40,31 +154,64 @@ do \
 } while(0)
 
 	out_image = std::make_shared<Image>(camera.Resolution());
-
-	std::vector<Pixel> pixels = camera.GetOutgoingPixels();
-
-	PRINT_TIME("\t[SETUP]: Getting outgoing pixels");
-
-	std::cout << "[RENDERING]" << std::endl;
+	FrameBuffer frame_buffer(camera.Resolution());
 
 	// For each sample in each pixel, trace its ray
 	unsigned int hardware_concurrency = std::thread::hardware_concurrency();
 	// If there is more than one core, leave one available for enquing other tasks
-	if (max_threads > 0)
+	if (params.max_threads > 0)
 	{
-		hardware_concurrency = std::min<unsigned int>((unsigned int)max_threads, hardware_concurrency);
+		hardware_concurrency = std::min<unsigned int>((unsigned int)params.max_threads, hardware_concurrency);
 	}
 	hardware_concurrency -= hardware_concurrency > 1 ? 1 : 0;
 
 	ThreadPool rendering_pool(hardware_concurrency, 1000);
 
-	for (auto &pixel : pixels)
+	// The pool is still idle, so the acceleration structure can build its subtrees on it
+	BVHBuildOptions build_options = params.bvh_build_options;
+	build_options.Pool = &rendering_pool;
+	std::unique_ptr<IAccelerationStructure> acceleration_structure = create_acceleration_structure(params, build_options);
+
+	PRINT_TIME("\t[SETUP]: Building acceleration structure");
+
+	trace_acceleration_structure_statistics(performance_session, scene, *acceleration_structure);
+
+	std::cout << "[RENDERING]" << std::endl;
+
+	// The tasks generate their camera rays from the camera as they go, nothing is stored per pixel
+	const std::vector<ImageTile> tiles = RayTracer::OrderTiles(camera.Resolution().X, camera.Resolution().Y, params.tile_size, params.tile_order);
+	if (params.wavefront)
+	{
+		// Wavefront batches keep the pixels tile by tile so their camera rays still make packets
+		std::vector<ImageTile> batch_tiles;
+		size_t batch_pixels = 0;
+		for (const ImageTile &tile : tiles)
+		{
+			batch_tiles.emplace_back(tile);
+			batch_pixels += tile.width * tile.height;
+			if (batch_pixels >= wavefront_batch_pixels)
+			{
+				rendering_pool.EnqueueTask(std::make_shared<WavefrontRenderTask>(camera, batch_tiles, params.samples, scene, *acceleration_structure, frame_buffer));
+				batch_tiles.clear();
+				batch_pixels = 0;
+			}
+		}
+
+		if (!batch_tiles.empty())
+		{
+			rendering_pool.EnqueueTask(std::make_shared<WavefrontRenderTask>(camera, batch_tiles, params.samples, scene, *acceleration_structure, frame_buffer));
+		}
+	}
+	else
 	{
-		std::shared_ptr<ThreadPool::IThreadPoolTask> pixel_render_task = std::make_shared<PixelRenderTask>(pixel, samples, scene, out_image);
-		rendering_pool.EnqueueTask(pixel_render_task);
+		for (const ImageTile &tile : tiles)
+		{
+			rendering_pool.EnqueueTask(std::make_shared<TileRenderTask>(camera, tile, params.samples, scene, *acceleration_structure, frame_buffer, params.packet_tracing));
+		}
 	}
 
 	rendering_pool.BlockUntilComplete();
+	frame_buffer.WriteImage(*out_image);
 
 	PRINT_TIME("[RENDER TIME]");
 }
\ No newline at end of file
@@ -14,9 +14,9 @@ float RayTracer::DiffuseBSDF::Roughness() const
 }
 
 void RayTracer::DiffuseBSDF::GetResultantRay(const Intersection &intersection,
-	const Ray &incoming_ray, Ray &outgoing_ray) const
+	const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const
 {
-	Vector3<float> out_direction = intersection.Normal().Normalize() + (Vector3<float>::RandomInUnitSphere() * roughness);
+	Vector3<float> out_direction = intersection.Normal().Normalize() + (Vector3<float>::RandomInUnitSphere(random) * roughness);
 	// TODO: figure out the modularity value
 	outgoing_ray = Ray(intersection.Location(), out_direction, color.Modulate(incoming_ray.RayColor(), 0.2f));
 }
@@ -15,7 +15,7 @@ float RayTracer::EmissiveBSDF::Roughness() const
 }
 
 void RayTracer::EmissiveBSDF::GetResultantRay(const Intersection &intersection,
-	const Ray &incoming_ray, Ray &outgoing_ray) const
+	const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const
 {
 	outgoing_ray = Ray(incoming_ray.Origin(), Vector3<float>(0, 0, 0), Color(incoming_ray.RayColor() * color * strength));
 }
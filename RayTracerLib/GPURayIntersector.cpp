@@ -13,8 +13,8 @@ const static size_t shader_local_size_x = 1024;
 
 #pragma region GPURayIntersector
 
-GPURayIntersector::GPURayIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_gpu_sphere_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session)
-	: Device(device), world_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, session), sphere_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, input_gpu_sphere_buffer, session), mesh_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, input_vertex_buffer, input_face_buffer, session), performance_session(session)
+GPURayIntersector::GPURayIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_gpu_sphere_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, bool watertight_triangles, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session)
+	: Device(device), world_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, session), sphere_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, input_gpu_sphere_buffer, session), mesh_intersector(device, compute_queue_index, input_gpu_ray_buffer, output_gpu_intersection_buffer, input_vertex_buffer, input_face_buffer, watertight_triangles, session), performance_session(session)
 {}
 
 void GPURayIntersector::WriteCommandBuffers(const std::vector<std::reference_wrapper<vk::CommandBuffer>> &buffers, size_t incoming_ray_count)
@@ -73,15 +73,17 @@ void GPURayIntersector::GPUSphereIntersector::WriteCommandBuffer(vk::CommandBuff
 
 #pragma region GPUMeshIntersector
 
-GPURayIntersector::GPUMeshIntersector::GPUMeshIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session)
-	: GPUComputeShader("GPUMeshIntersector.comp.spv", compute_queue_index, 4, 0, device, std::vector<vk::Buffer>{input_gpu_ray_buffer, output_gpu_intersection_buffer, input_vertex_buffer, input_face_buffer}, session), performance_session(session)
-{}
+GPURayIntersector::GPUMeshIntersector::GPUMeshIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, bool watertight_triangles, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session)
+	: MeshIntersectorPushConstants(), GPUComputeShader("GPUMeshIntersector.comp.spv", compute_queue_index, 4, sizeof(GPUMeshIntersector::MeshIntersectorPushConstants), device, std::vector<vk::Buffer>{input_gpu_ray_buffer, output_gpu_intersection_buffer, input_vertex_buffer, input_face_buffer}, session), performance_session(session)
+{
+	MeshIntersectorPushConstants.watertight_triangles = watertight_triangles ? 1 : 0;
+}
 
 void GPURayIntersector::GPUMeshIntersector::WriteCommandBuffer(vk::CommandBuffer &buffer, size_t incoming_ray_count)
 {
 	TRACE_FUNCTION(performance_session);
 
-	GPUComputeShader::WriteCommandBuffer(buffer, incoming_ray_count);
+	GPUComputeShader::WriteCommandBuffer(buffer, incoming_ray_count, static_cast<void *>(&MeshIntersectorPushConstants));
 }
 
 #pragma endregion
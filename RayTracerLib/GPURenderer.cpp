@@ -5,6 +5,7 @@
 #include "VulkanUtils.h"
 #include "GPUStructs.h"
 #include "Mesh.h"
+#include "MeshInstance.h"
 
 #include "GPURayInitializer.h"
 #include "GPURayIntersector.h"
@@ -25,6 +26,7 @@ using RayTracer::IMaterial;
 using RayTracer::ElapsedTimer;
 using RayTracer::Sphere;
 using RayTracer::Mesh;
+using RayTracer::MeshInstance;
 
 using RayTracer::GPURayInitializer;
 using RayTracer::GPURayIntersector;
@@ -59,7 +61,7 @@ static vk::DeviceSize AlignedMemorySize(vk::DeviceSize non_aligned_size)
 }
 
 GPURenderer::GPURenderer(const GPURendererInitParameters &params)
-	: camera(params.camera), samples(params.samples), scene(params.scene), max_bounces(params.max_bounces)
+	: camera(params.camera), samples(params.samples), scene(params.scene), max_bounces(params.max_bounces), watertight_triangles(params.watertight_triangles)
 {
 	if (params.trace_performance)
 	{
@@ -262,14 +264,33 @@ void GPURenderer::ParseSceneData(const IScene &scene, std::vector<GPUSphere> &ou
 		}
 		else if (const Mesh *const mesh = dynamic_cast<const Mesh *const>(object))
 		{
-			for (const auto &vertex : mesh->VertexData)
+			// Face indices are local to each mesh so offset them into the shared vertex buffer
+			size_t vertex_offset = out_gpu_vertices.size();
+			for (const auto &vertex : mesh->Geometry().VertexData())
 			{
 				out_gpu_vertices.emplace_back(vertex);
 			}
 
-			for (const auto &index : mesh->VertexIndices)
+			for (const auto &index : mesh->Geometry().VertexIndices)
 			{
-				out_gpu_faces.emplace_back(index);
+				out_gpu_faces.emplace_back(index + Vector3<size_t>(vertex_offset, vertex_offset, vertex_offset));
+				GPUFace &back = out_gpu_faces.back();
+				back.material_id = material_id;
+				back.material_index = material_index;
+			}
+		}
+		else if (const MeshInstance *const instance = dynamic_cast<const MeshInstance *const>(object))
+		{
+			// The GPU path has no instancing yet, so flatten each instance into world space
+			size_t vertex_offset = out_gpu_vertices.size();
+			for (const auto &vertex : instance->Geometry().VertexData())
+			{
+				out_gpu_vertices.emplace_back(instance->ObjectToWorld().TransformPoint(vertex));
+			}
+
+			for (const auto &index : instance->Geometry().VertexIndices)
+			{
+				out_gpu_faces.emplace_back(index + Vector3<size_t>(vertex_offset, vertex_offset, vertex_offset));
 				GPUFace &back = out_gpu_faces.back();
 				back.material_id = material_id;
 				back.material_index = material_index;
@@ -397,7 +418,7 @@ void GPURenderer::Render(std::shared_ptr<IImage> &out_image)
 	std::cout << "[RENDER STARTED]: line " << __LINE__ << ": time (ms): " << performance_timer.Poll().count() << "\n";
 
 	GPURayInitializer ray_initializer(device, ComputeQueueIndex, BufferData[(int)GPUBufferBindings::ray_buffer].buffer, BufferData[(int)GPUBufferBindings::intersection_buffer].buffer, performance_session);
-	GPURayIntersector ray_intersector(device, ComputeQueueIndex, BufferData[(int)GPUBufferBindings::ray_buffer].buffer, BufferData[(int)GPUBufferBindings::intersection_buffer].buffer, BufferData[(int)GPUBufferBindings::sphere_buffer].buffer, BufferData[(int)GPUBufferBindings::vertex_buffer].buffer, BufferData[(int)GPUBufferBindings::face_buffer].buffer, performance_session);
+	GPURayIntersector ray_intersector(device, ComputeQueueIndex, BufferData[(int)GPUBufferBindings::ray_buffer].buffer, BufferData[(int)GPUBufferBindings::intersection_buffer].buffer, BufferData[(int)GPUBufferBindings::sphere_buffer].buffer, BufferData[(int)GPUBufferBindings::vertex_buffer].buffer, BufferData[(int)GPUBufferBindings::face_buffer].buffer, watertight_triangles, performance_session);
 	GPUMaterialCalculator material_calculator(device, ComputeQueueIndex, BufferData[(int)GPUBufferBindings::intersection_buffer].buffer, BufferData[(int)GPUBufferBindings::ray_buffer].buffer, BufferData[(int)GPUBufferBindings::diffuse_material_parameters].buffer, BufferData[(int)GPUBufferBindings::emissive_material_parameters].buffer, performance_session);
 	GPUSampleAccumulator sample_accumulator(device, ComputeQueueIndex, BufferData[(int)GPUBufferBindings::intersection_buffer].buffer, BufferData[(int)GPUBufferBindings::sample_buffer].buffer, performance_session);
 
@@ -15,13 +15,13 @@ float RayTracer::GlossyBSDF::Roughness() const
 }
 
 void RayTracer::GlossyBSDF::GetResultantRay(const Intersection &intersection,
-	const Ray &incoming_ray, Ray &outgoing_ray) const
+	const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const
 {
-	Vector3<float> in_direction = incoming_ray.Direction().Normalize();
+	Vector3<float> in_direction = incoming_ray.NormalizedDirection();
 	Vector3<float> intersection_normal = intersection.Normal().Normalize();
 
 	Vector3<float> out_reflection = in_direction - intersection_normal * 2 * in_direction.Dot(intersection_normal);
-	Vector3<float> out_reflection_offset = out_reflection + (Vector3<float>::RandomInUnitSphere() * roughness);
+	Vector3<float> out_reflection_offset = out_reflection + (Vector3<float>::RandomInUnitSphere(random) * roughness);
 
 	if (out_reflection_offset.Dot(intersection_normal) <= 0)
 	{
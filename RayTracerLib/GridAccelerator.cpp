@@ -0,0 +1,400 @@
+#include "GridAccelerator.h"
+#include "ElapsedTimer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using RayTracer::GridAccelerator;
+using RayTracer::GridBuildOptions;
+using RayTracer::BoundingBox;
+using RayTracer::ElapsedTimer;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Ray;
+using RayTracer::SphereArray;
+using RayTracer::Vector3;
+
+// Fewer objects than this are not worth a grid, a BVH over them is just as fast
+static const size_t minimum_grid_object_count = 64;
+
+// SuitsObjects rejects scenes where an object's bounds diagonal exceeds the median by this factor
+static const float maximum_object_size_ratio = 4.0f;
+
+// SuitsObjects wants at least this fraction of the objects to have a cell of their own
+static const float minimum_cell_occupancy = 0.5f;
+
+// Objects tested recently during one traversal, so objects spanning several cells are tested once
+static const size_t mailbox_size = 8;
+
+// Chooses cubic cells so that there are about CellsPerObject cells per object. Flat axes get a single cell.
+static void ChooseResolution(const BoundingBox &bounds, size_t object_count, const GridBuildOptions &options, uint32_t out_resolution[3])
+{
+	float volume = 1.0f;
+	int dimensions = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (bounds.Extent(axis) > 0.0f)
+		{
+			volume *= bounds.Extent(axis);
+			dimensions++;
+		}
+	}
+
+	const float target_cell_count = std::max(1.0f, options.CellsPerObject * object_count);
+	const float cells_per_unit = dimensions > 0 ? std::pow(target_cell_count / volume, 1.0f / dimensions) : 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float cells = std::round(bounds.Extent(axis) * cells_per_unit);
+		out_resolution[axis] = static_cast<uint32_t>(std::clamp(cells, 1.0f, static_cast<float>(std::max(1u, options.MaxResolution))));
+	}
+}
+
+static std::vector<const IIntersectable *> GetBoundedObjects(const std::vector<const IIntersectable *> &objects)
+{
+	std::vector<const IIntersectable *> bounded_objects;
+	bounded_objects.reserve(objects.size());
+	for (const auto &object : objects)
+	{
+		// Nothing can hit an empty object so leave it out of the grid
+		if (!object->Bounds().IsEmpty())
+		{
+			bounded_objects.emplace_back(object);
+		}
+	}
+
+	return bounded_objects;
+}
+
+GridAccelerator::GridAccelerator(const std::vector<const IIntersectable *> &objects, const GridBuildOptions &options)
+{
+	ElapsedTimer build_timer;
+
+	std::vector<const IIntersectable *> bounded_objects = GetBoundedObjects(objects);
+	if (bounded_objects.empty())
+	{
+		return;
+	}
+
+	std::vector<BoundingBox> object_bounds;
+	object_bounds.reserve(bounded_objects.size());
+	for (const auto &object : bounded_objects)
+	{
+		object_bounds.emplace_back(object->Bounds());
+		bounds.Expand(object_bounds.back());
+	}
+
+	ChooseResolution(bounds, bounded_objects.size(), options, resolution);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell_size[axis] = bounds.Extent(axis) / resolution[axis];
+		inverse_cell_size[axis] = cell_size[axis] > 0.0f ? 1.0f / cell_size[axis] : 0.0f;
+	}
+
+	// Count the objects of each cell, turn the counts into offsets, then place the objects
+	const size_t cell_count = static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2];
+	cell_offsets.assign(cell_count + 1, 0);
+
+	auto for_each_overlapped_cell = [&](const BoundingBox &object_box, auto &&visit_cell)
+	{
+		uint32_t first[3];
+		uint32_t last[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			first[axis] = CellCoordinate(object_box.min[axis], axis);
+			last[axis] = CellCoordinate(object_box.max[axis], axis);
+		}
+
+		uint32_t cell[3];
+		for (cell[2] = first[2]; cell[2] <= last[2]; cell[2]++)
+		{
+			for (cell[1] = first[1]; cell[1] <= last[1]; cell[1]++)
+			{
+				for (cell[0] = first[0]; cell[0] <= last[0]; cell[0]++)
+				{
+					visit_cell(CellIndex(cell));
+				}
+			}
+		}
+	};
+
+	for (const auto &object_box : object_bounds)
+	{
+		for_each_overlapped_cell(object_box, [&](size_t cell_index) { cell_offsets[cell_index + 1]++; });
+	}
+
+	for (size_t cell_index = 0; cell_index < cell_count; cell_index++)
+	{
+		cell_offsets[cell_index + 1] += cell_offsets[cell_index];
+	}
+
+	cell_objects.resize(cell_offsets[cell_count]);
+	std::vector<uint32_t> fill_positions(cell_offsets.begin(), cell_offsets.end() - 1);
+	for (size_t object_index = 0; object_index < bounded_objects.size(); object_index++)
+	{
+		for_each_overlapped_cell(object_bounds[object_index], [&](size_t cell_index)
+			{
+				cell_objects[fill_positions[cell_index]++] = bounded_objects[object_index];
+			});
+	}
+
+	spheres = SphereArray(cell_objects);
+
+	build_time_ms = build_timer.Poll().count();
+}
+
+uint32_t GridAccelerator::CellCoordinate(float position, int axis) const
+{
+	float cell = std::floor((position - bounds.min[axis]) * inverse_cell_size[axis]);
+	return static_cast<uint32_t>(std::clamp(cell, 0.0f, static_cast<float>(resolution[axis] - 1)));
+}
+
+// 3D-DDA (Amanatides and Woo): walk the cells the ray passes through in order
+template <class CellVisitor>
+void GridAccelerator::WalkCells(const Ray &incoming_ray, const float direction[3], CellVisitor &&visit_cell) const
+{
+	const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+	const float *inverse_direction = incoming_ray.InverseDirection();
+
+	float entry_depth = 0.0f;
+	if (!bounds.IntersectsRay(incoming_ray.Origin(), inverse_direction, std::numeric_limits<float>::infinity(), entry_depth))
+	{
+		return;
+	}
+
+	uint32_t cell[3];
+	int step[3];
+	float next_crossing[3];
+	float crossing_interval[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = CellCoordinate(origin[axis] + direction[axis] * entry_depth, axis);
+		if (direction[axis] > 0.0f)
+		{
+			step[axis] = 1;
+			next_crossing[axis] = (bounds.min[axis] + (cell[axis] + 1) * cell_size[axis] - origin[axis]) * inverse_direction[axis];
+			crossing_interval[axis] = cell_size[axis] * inverse_direction[axis];
+		}
+		else if (direction[axis] < 0.0f)
+		{
+			step[axis] = -1;
+			next_crossing[axis] = (bounds.min[axis] + cell[axis] * cell_size[axis] - origin[axis]) * inverse_direction[axis];
+			crossing_interval[axis] = -cell_size[axis] * inverse_direction[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			next_crossing[axis] = std::numeric_limits<float>::infinity();
+			crossing_interval[axis] = std::numeric_limits<float>::infinity();
+		}
+	}
+
+	while (true)
+	{
+		const int axis = next_crossing[0] < next_crossing[1] ?
+			(next_crossing[0] < next_crossing[2] ? 0 : 2) :
+			(next_crossing[1] < next_crossing[2] ? 1 : 2);
+
+		if (!visit_cell(CellIndex(cell), next_crossing[axis]) || 0 == step[axis])
+		{
+			break;
+		}
+
+		if ((step[axis] > 0 && cell[axis] + 1 == resolution[axis]) || (step[axis] < 0 && 0 == cell[axis]))
+		{
+			break;
+		}
+
+		cell[axis] += step[axis];
+		next_crossing[axis] += crossing_interval[axis];
+	}
+}
+
+// The closest hit so far is kept across cells, so the walk can stop once it lies before the exit of
+// the current cell
+bool GridAccelerator::IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info, const IIntersectable *&out_object) const
+{
+	if (cell_objects.empty())
+	{
+		return false;
+	}
+
+	const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+	const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+	const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+	const IIntersectable *mailbox[mailbox_size] = {};
+	size_t mailbox_position = 0;
+	// Hits are kept while closer than closest_depth, one at the ray's MaxDepth() still counts
+	const float ray_max_depth = incoming_ray.MaxDepth();
+	float closest_depth = std::nextafter(ray_max_depth, std::numeric_limits<float>::infinity());
+	bool intersection_found = false;
+	const bool has_spheres = spheres.SphereCount() > 0;
+	// Reference of the closest hit while that is a sphere, whose intersection is only built at the end
+	int64_t closest_sphere_reference = -1;
+
+	WalkCells(incoming_ray, direction, [&](size_t cell_index, float exit_depth)
+		{
+			// Spheres are cheap enough in a batch that the mailbox is not worth it for them
+			uint32_t sphere_reference = 0;
+			if (has_spheres && spheres.IntersectsRay(origin, direction, cell_offsets[cell_index], cell_offsets[cell_index + 1] - cell_offsets[cell_index], closest_depth, sphere_reference))
+			{
+				closest_sphere_reference = sphere_reference;
+				intersection_found = true;
+			}
+
+			for (uint32_t i = cell_offsets[cell_index]; i < cell_offsets[cell_index + 1]; i++)
+			{
+				if (spheres.IsSphere(i))
+				{
+					continue;
+				}
+
+				const IIntersectable *object = cell_objects[i];
+				if (std::find(mailbox, mailbox + mailbox_size, object) != mailbox + mailbox_size)
+				{
+					continue;
+				}
+
+				mailbox[mailbox_position] = object;
+				mailbox_position = (mailbox_position + 1) % mailbox_size;
+
+				incoming_ray.SetMaxDepth(closest_depth);
+				Intersection current_intersection;
+				if (object->IntersectsRay(incoming_ray, current_intersection) && current_intersection.Depth() < closest_depth)
+				{
+					closest_depth = current_intersection.Depth();
+					out_intersection_info = current_intersection;
+					out_object = object;
+					closest_sphere_reference = -1;
+					intersection_found = true;
+				}
+			}
+
+			return closest_depth > exit_depth;
+		});
+
+	if (closest_sphere_reference >= 0)
+	{
+		out_intersection_info = spheres.SurfaceIntersection(static_cast<size_t>(closest_sphere_reference), incoming_ray.Origin(), direction_vector, closest_depth);
+		out_object = cell_objects[static_cast<size_t>(closest_sphere_reference)];
+	}
+
+	incoming_ray.SetMaxDepth(ray_max_depth);
+	return intersection_found;
+}
+
+// Any hit closer than max_depth occludes, even one outside the current cell, so the walk stops at the
+// first hit or once the cells lie beyond max_depth
+bool GridAccelerator::Occluded(const Ray &incoming_ray, float max_depth) const
+{
+	if (cell_objects.empty())
+	{
+		return false;
+	}
+
+	const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+	const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+	const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+	const IIntersectable *mailbox[mailbox_size] = {};
+	size_t mailbox_position = 0;
+	bool occluded = false;
+	const bool has_spheres = spheres.SphereCount() > 0;
+
+	WalkCells(incoming_ray, direction, [&](size_t cell_index, float exit_depth)
+		{
+			float sphere_depth = max_depth;
+			uint32_t sphere_reference = 0;
+			occluded = has_spheres && spheres.IntersectsRay(origin, direction, cell_offsets[cell_index], cell_offsets[cell_index + 1] - cell_offsets[cell_index], sphere_depth, sphere_reference);
+
+			for (uint32_t i = cell_offsets[cell_index]; i < cell_offsets[cell_index + 1] && !occluded; i++)
+			{
+				const IIntersectable *object = cell_objects[i];
+				if (spheres.IsSphere(i) || std::find(mailbox, mailbox + mailbox_size, object) != mailbox + mailbox_size)
+				{
+					continue;
+				}
+
+				mailbox[mailbox_position] = object;
+				mailbox_position = (mailbox_position + 1) % mailbox_size;
+				occluded = object->Occluded(incoming_ray, max_depth);
+			}
+
+			return !occluded && exit_depth < max_depth;
+		});
+
+	return occluded;
+}
+
+bool GridAccelerator::SuitsObjects(const std::vector<const IIntersectable *> &objects, const GridBuildOptions &options)
+{
+	std::vector<const IIntersectable *> bounded_objects = GetBoundedObjects(objects);
+	if (bounded_objects.size() < minimum_grid_object_count)
+	{
+		return false;
+	}
+
+	BoundingBox scene_bounds;
+	std::vector<float> diagonals;
+	diagonals.reserve(bounded_objects.size());
+	for (const auto &object : bounded_objects)
+	{
+		BoundingBox object_bounds = object->Bounds();
+		scene_bounds.Expand(object_bounds);
+		diagonals.emplace_back((object_bounds.Max() - object_bounds.Min()).MagnitudeSquared());
+	}
+
+	// Large objects would be referenced from many cells and tested by every ray crossing them
+	auto median = diagonals.begin() + diagonals.size() / 2;
+	std::nth_element(diagonals.begin(), median, diagonals.end());
+	const float largest = *std::max_element(diagonals.begin(), diagonals.end());
+	if (largest > maximum_object_size_ratio * maximum_object_size_ratio * *median)
+	{
+		return false;
+	}
+
+	// Clustered objects leave most cells empty and pile up in the rest
+	uint32_t resolution[3];
+	ChooseResolution(scene_bounds, bounded_objects.size(), options, resolution);
+	std::vector<bool> occupied(static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2], false);
+	size_t occupied_count = 0;
+	for (const auto &object : bounded_objects)
+	{
+		BoundingBox object_bounds = object->Bounds();
+		size_t cell_index = 0;
+		for (int axis = 2; axis >= 0; axis--)
+		{
+			float extent = scene_bounds.Extent(axis);
+			float relative = extent > 0.0f ? (object_bounds.Centroid(axis) - scene_bounds.min[axis]) / extent : 0.0f;
+			size_t coordinate = std::min<size_t>(resolution[axis] - 1, static_cast<size_t>(relative * resolution[axis]));
+			cell_index = cell_index * resolution[axis] + coordinate;
+		}
+
+		if (!occupied[cell_index])
+		{
+			occupied[cell_index] = true;
+			occupied_count++;
+		}
+	}
+
+	return occupied_count >= minimum_cell_occupancy * std::min(occupied.size(), bounded_objects.size());
+}
+
+GridAccelerator::Statistics GridAccelerator::ComputeStatistics() const
+{
+	Statistics statistics;
+	statistics.BuildTimeMilliseconds = build_time_ms;
+	std::copy(resolution, resolution + 3, statistics.Resolution);
+	statistics.CellCount = cell_offsets.empty() ? 0 : cell_offsets.size() - 1;
+	statistics.ReferenceCount = cell_objects.size();
+
+	for (size_t cell_index = 0; cell_index < statistics.CellCount; cell_index++)
+	{
+		if (cell_offsets[cell_index] == cell_offsets[cell_index + 1])
+		{
+			statistics.EmptyCellCount++;
+		}
+	}
+
+	return statistics;
+}
@@ -2,52 +2,41 @@
 
 using RayTracer::ThreadPool;
 using RayTracer::PixelRenderTask;
-using RayTracer::Pixel;
+using RayTracer::Camera;
 using RayTracer::Ray;
 using RayTracer::IScene;
+using RayTracer::IAccelerationStructure;
+using RayTracer::IIntersectable;
 using RayTracer::Color;
 using RayTracer::Intersection;
+using RayTracer::PCG32;
 using RayTracer::IMaterial;
 using RayTracer::IWorld;
-using RayTracer::IImage;
+using RayTracer::FrameBuffer;
+using RayTracer::SampleStatistics;
 using RayTracer::Vector3;
 
-PixelRenderTask::PixelRenderTask(Pixel &pixel, unsigned int samples, const IScene &scene, std::shared_ptr<IImage> out_image) :
-	pixel(pixel), samples(samples), scene(scene), out_image(out_image) {}
+PixelRenderTask::PixelRenderTask(const Camera &camera, size_t x, size_t y, unsigned int samples, const IScene &scene,
+	const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer) :
+	camera(camera), x(x), y(y), samples(samples), scene(scene), acceleration_structure(acceleration_structure), frame_buffer(frame_buffer) {}
 
-static void TraceRay(Ray &ray, const IScene &scene)
+void PixelRenderTask::TracePath(Ray &ray, Intersection closest_intersection, const IIntersectable *closest_object,
+	uint32_t pixel_index, unsigned int sample, const IScene &scene, const IAccelerationStructure &acceleration_structure)
 {
-	const unsigned int max_bounces = 10;
-
 	unsigned int total_bounces = 0;
 	Ray &traced_ray = ray;
 
 	/* Keep going while an intersection happens
 	* and the bounces is less than max bounce count */
-	while (traced_ray.Direction() != Vector3<float>(0, 0, 0))
+	while (true)
 	{
-		float min_depth = std::numeric_limits<float>::infinity();
-
-		const IMaterial *closest_intersection_mat = nullptr;
-		Intersection closest_intersection;
-
-		// Check for object intersections
-		for (const auto &intersectable : scene.Objects())
-		{
-			Intersection current_intersection;
-			if (intersectable->IntersectsRay(traced_ray, current_intersection)
-				&& current_intersection.Depth() < min_depth)
-			{
-				closest_intersection = current_intersection;
-				min_depth = closest_intersection.Depth();
-				closest_intersection_mat = intersectable->Material().get();
-			}
-		}
+		const IMaterial *closest_intersection_mat = nullptr != closest_object ? closest_object->Material().get() : nullptr;
 
 		if (nullptr != closest_intersection_mat)
 		{
 			Ray reflected_ray;
-			closest_intersection_mat->GetResultantRay(closest_intersection, traced_ray, reflected_ray);
+			PCG32 random = PCG32::ForPath(pixel_index, sample, total_bounces + 1);
+			closest_intersection_mat->GetResultantRay(closest_intersection, traced_ray, reflected_ray, random);
 			traced_ray = reflected_ray;
 		}
 		else
@@ -59,27 +48,55 @@ static void TraceRay(Ray &ray, const IScene &scene)
 		}
 
 		total_bounces++;
-		if (total_bounces == max_bounces)
+		if (total_bounces == MaxBounces)
 		{
 			const IWorld *world = scene.World();
 			traced_ray.SetColor(traced_ray.RayColor() * world->AmbientColor());
 			break;
 		}
+
+		if (traced_ray.Direction() == Vector3<float>(0, 0, 0))
+		{
+			break;
+		}
+
+		// Check for object intersections
+		closest_intersection = Intersection();
+		closest_object = nullptr;
+		if (!acceleration_structure.IntersectsRay(traced_ray, closest_intersection, closest_object))
+		{
+			closest_object = nullptr;
+		}
 	}
 }
 
+void PixelRenderTask::TraceRay(Ray &ray, uint32_t pixel_index, unsigned int sample, const IScene &scene,
+	const IAccelerationStructure &acceleration_structure)
+{
+	if (ray.Direction() == Vector3<float>(0, 0, 0))
+	{
+		return;
+	}
+
+	Intersection closest_intersection;
+	const IIntersectable *closest_object = nullptr;
+	if (!acceleration_structure.IntersectsRay(ray, closest_intersection, closest_object))
+	{
+		closest_object = nullptr;
+	}
+
+	TracePath(ray, closest_intersection, closest_object, pixel_index, sample, scene, acceleration_structure);
+}
+
 void PixelRenderTask::Execute()
 {
-	std::vector<Color> colors;
-	colors.reserve(samples);
+	SampleStatistics statistics;
 	for (unsigned int i = 0; i < samples; i++)
 	{
-		Ray ray = pixel.GetNextRay();
-		TraceRay(ray, scene);
-		colors.emplace_back(ray.RayColor());
+		Ray ray = camera.GetRay(x, y, i);
+		TraceRay(ray, camera.PixelIndex(x, y), i, scene, acceleration_structure);
+		statistics.Add(ray.RayColor());
 	}
-	
-	pixel.Average(colors);
 
-	out_image->SetPixelColor(pixel.XCoordinate(), pixel.YCoordinate(), pixel.OutputColor());
+	frame_buffer.SetPixel(x, y, statistics);
 }
\ No newline at end of file
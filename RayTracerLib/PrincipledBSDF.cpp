@@ -14,7 +14,7 @@ float RayTracer::PrincipledBSDF::Roughness() const
 }
 
 void RayTracer::PrincipledBSDF::GetResultantRay(const Intersection &intersection, 
-	const Ray &incoming_ray, Ray &outgoing_ray) const
+	const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const
 {
 	outgoing_ray = Ray();
 }
@@ -0,0 +1,135 @@
+#include "QuantizedBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+using RayTracer::QuantizedBVH;
+using RayTracer::WideBVH;
+using RayTracer::BVH;
+using RayTracer::BoundingBox;
+
+// Exponent used for axes along which every child is flat
+static const int flat_axis_exponent = -100;
+
+QuantizedBVH::QuantizedBVH(const BVH &binary)
+{
+	// Collapse exactly like the 4 wide tree, then store its nodes quantized
+	WideBVH<Width> wide(binary);
+	source_nodes = wide.SourceNodes();
+	nodes.resize(wide.Nodes().size());
+
+	for (size_t node_index = 0; node_index < nodes.size(); node_index++)
+	{
+		const WideBVH<Width>::Node &wide_node = wide.Nodes()[node_index];
+		Node &node = nodes[node_index];
+		for (size_t child_index = 0; child_index < Width; child_index++)
+		{
+			uint32_t primitive_count = wide_node.primitive_count[child_index];
+			if (primitive_count > std::numeric_limits<uint8_t>::max())
+			{
+				throw std::exception("Quantized BVH leaves hold at most 255 primitives");
+			}
+
+			node.child[child_index] = wide_node.child[child_index];
+			node.primitive_count[child_index] = static_cast<uint8_t>(primitive_count);
+		}
+	}
+
+	Refit(binary);
+}
+
+void QuantizedBVH::Refit(const BVH &binary)
+{
+	const std::vector<BVH::Node> &binary_nodes = binary.Nodes();
+	for (size_t node_index = 0; node_index < nodes.size(); node_index++)
+	{
+		BoundingBox child_bounds[Width];
+		for (size_t child_index = 0; child_index < Width; child_index++)
+		{
+			uint32_t binary_index = source_nodes[node_index * Width + child_index];
+			if (EmptyChild != binary_index)
+			{
+				child_bounds[child_index] = binary_nodes[binary_index].bounds;
+			}
+		}
+
+		QuantizeNode(nodes[node_index], child_bounds);
+	}
+}
+
+void QuantizedBVH::QuantizeNode(Node &node, const BoundingBox child_bounds[Width])
+{
+	BoundingBox node_bounds;
+	for (size_t child_index = 0; child_index < Width; child_index++)
+	{
+		node_bounds.Expand(child_bounds[child_index]);
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float origin = node_bounds.IsEmpty() ? 0.0f : node_bounds.min[axis];
+		const float extent = node_bounds.IsEmpty() ? 0.0f : node_bounds.max[axis] - origin;
+
+		// Smallest power of two step that lets 255 steps cover the node
+		int exponent = flat_axis_exponent;
+		if (extent > 0.0f)
+		{
+			exponent = std::max(flat_axis_exponent, static_cast<int>(std::ceil(std::log2(extent / 255.0f))));
+			while (origin + 255.0f * ScaleFromExponent(static_cast<int8_t>(exponent)) < node_bounds.max[axis])
+			{
+				exponent++;
+			}
+		}
+
+		const float scale = ScaleFromExponent(static_cast<int8_t>(exponent));
+		node.origin[axis] = origin;
+		node.scale_exponent[axis] = static_cast<int8_t>(exponent);
+
+		for (size_t child_index = 0; child_index < Width; child_index++)
+		{
+			const BoundingBox &bounds = child_bounds[child_index];
+			if (bounds.IsEmpty())
+			{
+				// Unused children are skipped by their EmptyChild index, the box does not matter
+				node.quantized_bounds[axis][child_index] = 0;
+				node.quantized_bounds[axis + 3][child_index] = 0;
+				continue;
+			}
+
+			// Round the minimum down and the maximum up so the decoded box always contains the child
+			float quantized_min = std::clamp(std::floor((bounds.min[axis] - origin) / scale), 0.0f, 255.0f);
+			while (quantized_min > 0.0f && origin + quantized_min * scale > bounds.min[axis])
+			{
+				quantized_min -= 1.0f;
+			}
+
+			float quantized_max = std::clamp(std::ceil((bounds.max[axis] - origin) / scale), 0.0f, 255.0f);
+			while (quantized_max < 255.0f && origin + quantized_max * scale < bounds.max[axis])
+			{
+				quantized_max += 1.0f;
+			}
+
+			node.quantized_bounds[axis][child_index] = static_cast<uint8_t>(quantized_min);
+			node.quantized_bounds[axis + 3][child_index] = static_cast<uint8_t>(quantized_max);
+		}
+	}
+}
+
+BoundingBox QuantizedBVH::ChildBounds(const Node &node, size_t child_index) const
+{
+	if (EmptyChild == node.child[child_index])
+	{
+		return BoundingBox();
+	}
+
+	float minimum[3];
+	float maximum[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float scale = ScaleFromExponent(node.scale_exponent[axis]);
+		minimum[axis] = node.origin[axis] + node.quantized_bounds[axis][child_index] * scale;
+		maximum[axis] = node.origin[axis] + node.quantized_bounds[axis + 3][child_index] * scale;
+	}
+
+	return BoundingBox(Vector3<float>(minimum[0], minimum[1], minimum[2]), Vector3<float>(maximum[0], maximum[1], maximum[2]));
+}
@@ -0,0 +1,134 @@
+#include "SphereArray.h"
+#include "Sphere.h"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+using RayTracer::SphereArray;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Sphere;
+using RayTracer::Vector3;
+
+enum Row
+{
+	center_x, center_y, center_z, radius_squared
+};
+
+SphereArray::SphereArray(const std::vector<const IIntersectable *> &objects)
+	: entry_count(objects.size()), is_sphere(objects.size(), 0)
+{
+	for (auto &row : components)
+	{
+		row.assign(entry_count + BatchWidth, 0.0f);
+	}
+
+	for (size_t index = 0; index < entry_count + BatchWidth; index++)
+	{
+		const Sphere *sphere = index < entry_count ? dynamic_cast<const Sphere *>(objects[index]) : nullptr;
+		if (nullptr == sphere)
+		{
+			// A negative infinite radius squared makes the discriminant negative for every ray
+			components[radius_squared][index] = -std::numeric_limits<float>::infinity();
+			continue;
+		}
+
+		components[center_x][index] = sphere->Position().X;
+		components[center_y][index] = sphere->Position().Y;
+		components[center_z][index] = sphere->Position().Z;
+		components[radius_squared][index] = sphere->Radius() * sphere->Radius();
+		is_sphere[index] = 1;
+		sphere_count++;
+	}
+}
+
+bool SphereArray::IntersectsRay(const float origin[3], const float direction[3], uint32_t first_index, uint32_t count,
+	float &max_depth, uint32_t &out_index) const
+{
+	bool intersection_found = false;
+
+#if defined(__AVX__)
+	const __m256 direction_x = _mm256_set1_ps(direction[0]);
+	const __m256 direction_y = _mm256_set1_ps(direction[1]);
+	const __m256 direction_z = _mm256_set1_ps(direction[2]);
+	const __m256 origin_x = _mm256_set1_ps(origin[0]);
+	const __m256 origin_y = _mm256_set1_ps(origin[1]);
+	const __m256 origin_z = _mm256_set1_ps(origin[2]);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+	const __m256 lane_indices = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (uint32_t batch_start = first_index; batch_start < first_index + count; batch_start += BatchWidth)
+	{
+		auto load = [&](Row row) { return _mm256_loadu_ps(components[row].data() + batch_start); };
+		const __m256 to_center_x = _mm256_sub_ps(load(center_x), origin_x);
+		const __m256 to_center_y = _mm256_sub_ps(load(center_y), origin_y);
+		const __m256 to_center_z = _mm256_sub_ps(load(center_z), origin_z);
+
+		const __m256 u_dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(to_center_x, direction_x), _mm256_mul_ps(to_center_y, direction_y)), _mm256_mul_ps(to_center_z, direction_z));
+		const __m256 magnitude_squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(to_center_x, to_center_x), _mm256_mul_ps(to_center_y, to_center_y)), _mm256_mul_ps(to_center_z, to_center_z));
+		const __m256 delta = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(u_dot, u_dot), load(radius_squared)), magnitude_squared);
+		const __m256 depth = _mm256_sub_ps(u_dot, _mm256_sqrt_ps(delta));
+
+		__m256 hit = _mm256_cmp_ps(delta, zero, _CMP_GE_OQ);
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(depth, zero, _CMP_GE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(depth, _mm256_set1_ps(max_depth), _CMP_LT_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(lane_indices, _mm256_set1_ps(static_cast<float>(first_index + count - batch_start)), _CMP_LT_OQ));
+
+		if (0 == _mm256_movemask_ps(hit))
+		{
+			continue;
+		}
+
+		const __m256 hit_depths = _mm256_blendv_ps(infinity, depth, hit);
+		__m256 closest = _mm256_min_ps(hit_depths, _mm256_permute2f128_ps(hit_depths, hit_depths, 1));
+		closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(1, 0, 3, 2)));
+		closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		const uint32_t closest_lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(hit_depths, closest, _CMP_EQ_OQ)));
+		max_depth = _mm256_cvtss_f32(closest);
+		out_index = batch_start + std::countr_zero(closest_lanes);
+		intersection_found = true;
+	}
+#else
+	for (uint32_t index = first_index; index < first_index + count; index++)
+	{
+		const float to_center[3] = {
+			components[center_x][index] - origin[0],
+			components[center_y][index] - origin[1],
+			components[center_z][index] - origin[2] };
+		float u_dot = to_center[0] * direction[0] + to_center[1] * direction[1] + to_center[2] * direction[2];
+		float magnitude_squared = to_center[0] * to_center[0] + to_center[1] * to_center[1] + to_center[2] * to_center[2];
+		float delta = u_dot * u_dot + components[radius_squared][index] - magnitude_squared;
+
+		if (delta < 0)
+		{
+			continue;
+		}
+
+		float depth = u_dot - std::sqrt(delta);
+		if (depth >= 0 && depth < max_depth)
+		{
+			max_depth = depth;
+			out_index = index;
+			intersection_found = true;
+		}
+	}
+#endif
+
+	return intersection_found;
+}
+
+Intersection SphereArray::SurfaceIntersection(size_t index, const Vector3<float> &origin, const Vector3<float> &direction, float depth) const
+{
+	const Vector3<float> center(components[center_x][index], components[center_y][index], components[center_z][index]);
+	Vector3<float> intersection_location = origin + direction * depth;
+	Vector3<float> intersection_normal = (intersection_location - center).Normalize();
+
+	return Intersection(depth, intersection_normal, intersection_location);
+}
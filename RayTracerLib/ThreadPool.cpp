@@ -1,54 +1,216 @@
 #include "ThreadPool.h"
 
+#include <algorithm>
+#include <bit>
+
 using RayTracer::ThreadPool;
 
+// Worker the current thread runs for, so tasks enqueued from a task go to that worker's own deque
+struct CurrentWorker
+{
+	const ThreadPool *pool = nullptr;
+	size_t index = 0;
+};
+
+static thread_local CurrentWorker current_worker;
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models"). Only the
+// owning worker pushes and pops, at the bottom, any thread may steal from the top. The pool never has
+// more than queue_size tasks waiting, so a fixed ring of at least that size never has to grow.
+class ThreadPool::WorkQueue
+{
+public:
+	WorkQueue(size_t capacity)
+		: top(0), bottom(0), mask(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1), slots(new std::atomic<TaskHandle *>[mask + 1])
+	{
+	}
+
+	void Push(TaskHandle *task)
+	{
+		const int64_t current_bottom = bottom.load(std::memory_order_relaxed);
+		slots[current_bottom & mask].store(task, std::memory_order_relaxed);
+		// Publishes the task to thieves, which read bottom with acquire
+		bottom.store(current_bottom + 1, std::memory_order_release);
+	}
+
+	TaskHandle *Pop()
+	{
+		const int64_t last = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(last, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t current_top = top.load(std::memory_order_relaxed);
+
+		if (current_top > last)
+		{
+			bottom.store(last + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		TaskHandle *task = slots[last & mask].load(std::memory_order_relaxed);
+		if (current_top == last)
+		{
+			// The last task, a thief may be taking it at the same time
+			if (!top.compare_exchange_strong(current_top, current_top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				task = nullptr;
+			}
+			bottom.store(last + 1, std::memory_order_relaxed);
+		}
+
+		return task;
+	}
+
+	// False when the deque is empty. Returns true with a null task when another thread took the top task
+	// first, the deque may still hold others.
+	bool Steal(TaskHandle *&out_task)
+	{
+		int64_t current_top = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t current_bottom = bottom.load(std::memory_order_acquire);
+
+		if (current_top >= current_bottom)
+		{
+			return false;
+		}
+
+		TaskHandle *task = slots[current_top & mask].load(std::memory_order_relaxed);
+		out_task = top.compare_exchange_strong(current_top, current_top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) ? task : nullptr;
+		return true;
+	}
+
+private:
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	size_t mask;
+	std::unique_ptr<std::atomic<TaskHandle *>[]> slots;
+};
+
 void ThreadPool::IThreadPoolTask::Execute()
 {
 	return;
 }
 
-void ThreadPool::thread_loop()
+ThreadPool::TaskHandle *ThreadPool::FindTask(size_t worker_index)
 {
-	while (!stop_requested)
+	TaskHandle *task = work_queues[worker_index]->Pop();
+	if (nullptr != task)
+	{
+		return task;
+	}
+
+	// Take a share of the injected tasks at once, the rest of the batch can be stolen from this worker's
+	// deque. They are pushed before the lock is released, so a worker that finds the injected tasks empty
+	// afterwards sees them when it tries to steal.
 	{
-		std::shared_ptr<ThreadPool::IThreadPoolTask> task = nullptr;
-		
+		const std::lock_guard<std::mutex> lock(injected_tasks_lock);
+		if (!injected_tasks.empty())
 		{
-			const std::lock_guard<std::mutex> lock(enqueued_tasks_lock);
-			if (!enqueued_tasks.empty())
+			const size_t batch_size = std::max<size_t>(1, injected_tasks.size() / work_queues.size());
+			task = injected_tasks.front();
+			injected_tasks.pop_front();
+			for (size_t i = 1; i < batch_size; i++)
 			{
-				task = enqueued_tasks.front();
-				enqueued_tasks.pop_front();
+				work_queues[worker_index]->Push(injected_tasks.front());
+				injected_tasks.pop_front();
 			}
+
+			return task;
 		}
+	}
 
-		if(nullptr != task)
+	// A lost race does not mean the victim is empty, so victims are retried until a pass finds them all empty
+	bool retry = true;
+	while (retry)
+	{
+		retry = false;
+		for (size_t offset = 1; offset < work_queues.size(); offset++)
 		{
-			enqueued_tasks_count++;
-			queue_counter.release();
-			task->Execute();
-			completed_tasks_count++;
+			if (work_queues[(worker_index + offset) % work_queues.size()]->Steal(task))
+			{
+				if (nullptr != task)
+				{
+					return task;
+				}
+
+				retry = true;
+			}
 		}
-		else
+	}
+
+	return nullptr;
+}
+
+void ThreadPool::RunTask(TaskHandle *task)
+{
+	std::unique_ptr<TaskHandle> owned_task(task);
+	queue_counter.release();
+	(*owned_task)->Execute();
+	owned_task.reset();
+
+	if (1 == unfinished_tasks.fetch_sub(1))
+	{
+		unfinished_tasks.notify_all();
+	}
+}
+
+void ThreadPool::WakeWorker()
+{
+	// Parking workers count themselves before they wait on the epoch, and the wait returns at once when
+	// the epoch changed since they read it, so skipping the notification while nobody is parked loses no wakeup
+	work_epoch.fetch_add(1);
+	if (parked_workers.load() > 0)
+	{
+		work_epoch.notify_one();
+	}
+}
+
+void ThreadPool::thread_loop(size_t worker_index)
+{
+	current_worker = { this, worker_index };
+
+	while (true)
+	{
+		// Read before looking for work, any work added later changes it and cuts the wait short
+		const uint32_t epoch = work_epoch.load();
+		if (stop_requested)
+		{
+			break;
+		}
+
+		TaskHandle *task = FindTask(worker_index);
+		if (nullptr != task)
 		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			RunTask(task);
+			continue;
 		}
+
+		parked_workers.fetch_add(1);
+		work_epoch.wait(epoch);
+		parked_workers.fetch_sub(1);
 	}
 }
 
 ThreadPool::ThreadPool(size_t thread_count, size_t queue_size)
-	: stop_requested(false), enqueued_tasks_lock(), queue_counter(queue_size), enqueued_tasks()
+	: unfinished_tasks(0), queue_counter(queue_size), injected_tasks_lock(), injected_tasks(), work_epoch(0), parked_workers(0), stop_requested(false)
 {
 	size_t actual_threads = thread_count < 1 ? 1 : thread_count;
-	for (int index = 0; index < actual_threads; index++)
+	for (size_t index = 0; index < actual_threads; index++)
 	{
-		threads.emplace_back(std::thread(&ThreadPool::thread_loop, this));
+		work_queues.emplace_back(std::make_unique<WorkQueue>(queue_size));
+	}
+
+	// The workers steal from each other's deques, so all of them exist before the first worker starts
+	for (size_t index = 0; index < actual_threads; index++)
+	{
+		threads.emplace_back(std::thread(&ThreadPool::thread_loop, this, index));
 	}
 }
 
 ThreadPool::~ThreadPool()
 {
 	stop_requested = true;
+	work_epoch.fetch_add(1);
+	work_epoch.notify_all();
 
 	for(auto & thread: threads)
 	{
@@ -56,28 +218,55 @@ ThreadPool::~ThreadPool()
 	}
 
 	threads.clear();
+
+	// Tasks that were never started
+	for (auto &work_queue : work_queues)
+	{
+		while (TaskHandle *task = work_queue->Pop())
+		{
+			delete task;
+		}
+	}
+
+	for (TaskHandle *task : injected_tasks)
+	{
+		delete task;
+	}
 }
 
 void ThreadPool::EnqueueTask(const std::shared_ptr<IThreadPoolTask> &task)
 {
-	queue_counter.acquire();
-	const std::lock_guard<std::mutex> lock(enqueued_tasks_lock);
-	enqueued_tasks.push_back(task);
+	if (this == current_worker.pool)
+	{
+		// Waiting for room here could leave no worker free to start the queued tasks, so a worker runs
+		// the task itself while the queue is full
+		if (!queue_counter.try_acquire())
+		{
+			task->Execute();
+			return;
+		}
+
+		unfinished_tasks.fetch_add(1);
+		work_queues[current_worker.index]->Push(new TaskHandle(task));
+	}
+	else
+	{
+		queue_counter.acquire();
+		unfinished_tasks.fetch_add(1);
+
+		const std::lock_guard<std::mutex> lock(injected_tasks_lock);
+		injected_tasks.push_back(new TaskHandle(task));
+	}
+
+	WakeWorker();
 }
 
 void ThreadPool::BlockUntilComplete()
 {
-	bool tasks_enqueued = true;
-	while (tasks_enqueued)
+	size_t remaining = unfinished_tasks.load();
+	while (0 != remaining)
 	{
-		{
-			const std::lock_guard<std::mutex> lock(enqueued_tasks_lock);
-			tasks_enqueued = !enqueued_tasks.empty() || completed_tasks_count != enqueued_tasks_count;
-		}
-
-		if (tasks_enqueued)
-		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		}
+		unfinished_tasks.wait(remaining);
+		remaining = unfinished_tasks.load();
 	}
 }
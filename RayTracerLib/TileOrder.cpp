@@ -0,0 +1,104 @@
+#include "TileOrder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+using RayTracer::TileOrder;
+using RayTracer::ImageTile;
+
+// Distance of cell (x, y) along the Hilbert curve through a side by side grid, side a power of two
+static uint64_t HilbertIndex(uint64_t side, uint64_t x, uint64_t y)
+{
+	uint64_t index = 0;
+	for (uint64_t half = side / 2; half > 0; half /= 2)
+	{
+		const uint64_t quadrant_x = (x & half) > 0 ? 1 : 0;
+		const uint64_t quadrant_y = (y & half) > 0 ? 1 : 0;
+		index += half * half * ((3 * quadrant_x) ^ quadrant_y);
+
+		// Turn the quadrant so the curve through it starts and ends next to its neighbors
+		if (0 == quadrant_y)
+		{
+			if (1 == quadrant_x)
+			{
+				x = side - 1 - x;
+				y = side - 1 - y;
+			}
+
+			std::swap(x, y);
+		}
+	}
+
+	return index;
+}
+
+std::vector<ImageTile> RayTracer::OrderTiles(size_t resolution_x, size_t resolution_y, size_t tile_size, TileOrder order)
+{
+	if (0 == tile_size)
+	{
+		throw std::exception("Tiles must be at least one pixel wide");
+	}
+
+	const size_t tiles_x = (resolution_x + tile_size - 1) / tile_size;
+	const size_t tiles_y = (resolution_y + tile_size - 1) / tile_size;
+	const size_t tile_count = tiles_x * tiles_y;
+	auto tile = [&](size_t tile_x, size_t tile_y)
+	{
+		const size_t x = tile_x * tile_size;
+		const size_t y = tile_y * tile_size;
+		return ImageTile{ x, y, std::min(tile_size, resolution_x - x), std::min(tile_size, resolution_y - y) };
+	};
+
+	std::vector<ImageTile> tiles;
+	tiles.reserve(tile_count);
+	if (TileOrder::Spiral == order)
+	{
+		// Square spiral from the center tile, every second turn the arms grow by one. Steps outside the
+		// image are skipped, so on wide images the spiral keeps going over and under it.
+		const int64_t directions[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+		int64_t tile_x = static_cast<int64_t>(tiles_x - 1) / 2;
+		int64_t tile_y = static_cast<int64_t>(tiles_y - 1) / 2;
+		size_t direction = 0;
+		for (int64_t arm_length = 1; tiles.size() < tile_count; arm_length++)
+		{
+			for (int arm = 0; arm < 2; arm++)
+			{
+				for (int64_t step = 0; step < arm_length; step++)
+				{
+					if (tile_x >= 0 && tile_y >= 0 && tile_x < static_cast<int64_t>(tiles_x) && tile_y < static_cast<int64_t>(tiles_y))
+					{
+						tiles.emplace_back(tile(static_cast<size_t>(tile_x), static_cast<size_t>(tile_y)));
+					}
+
+					tile_x += directions[direction][0];
+					tile_y += directions[direction][1];
+				}
+
+				direction = (direction + 1) % 4;
+			}
+		}
+
+		return tiles;
+	}
+
+	for (size_t tile_y = 0; tile_y < tiles_y; tile_y++)
+	{
+		for (size_t tile_x = 0; tile_x < tiles_x; tile_x++)
+		{
+			tiles.emplace_back(tile(tile_x, tile_y));
+		}
+	}
+
+	if (TileOrder::Hilbert == order)
+	{
+		// The curve covers the smallest power of two square around the tiles, it jumps over the cells outside the image
+		const uint64_t side = std::bit_ceil(static_cast<uint64_t>(std::max(tiles_x, tiles_y)));
+		std::sort(tiles.begin(), tiles.end(), [side, tile_size](const ImageTile &first, const ImageTile &second)
+			{
+				return HilbertIndex(side, first.x / tile_size, first.y / tile_size) < HilbertIndex(side, second.x / tile_size, second.y / tile_size);
+			});
+	}
+
+	return tiles;
+}
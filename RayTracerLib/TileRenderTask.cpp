@@ -0,0 +1,101 @@
+#include "TileRenderTask.h"
+#include "PixelRenderTask.h"
+#include "RayPacket.h"
+
+#include <algorithm>
+
+using RayTracer::TileRenderTask;
+using RayTracer::PixelRenderTask;
+using RayTracer::Camera;
+using RayTracer::Ray;
+using RayTracer::RayPacket;
+using RayTracer::IScene;
+using RayTracer::IAccelerationStructure;
+using RayTracer::IIntersectable;
+using RayTracer::Color;
+using RayTracer::Intersection;
+using RayTracer::FrameBuffer;
+using RayTracer::SampleStatistics;
+using RayTracer::ImageTile;
+using RayTracer::Vector3;
+
+static_assert(TileRenderTask::PacketTileSize * TileRenderTask::PacketTileSize <= RayPacket::MaxSize, "A block of pixels must fit in a ray packet");
+
+TileRenderTask::TileRenderTask(const Camera &camera, const ImageTile &tile, unsigned int samples, const IScene &scene,
+	const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer, bool packet_tracing) :
+	camera(camera), tile(tile), samples(samples), scene(scene), acceleration_structure(acceleration_structure),
+	frame_buffer(frame_buffer), packet_tracing(packet_tracing)
+{
+}
+
+void TileRenderTask::Execute()
+{
+	// Reused by every tile the worker renders, one entry per pixel of the tile row by row
+	static thread_local std::vector<SampleStatistics> pixel_statistics;
+	pixel_statistics.assign(tile.width * tile.height, SampleStatistics());
+
+	auto accumulate = [&](size_t x, size_t y, const Color &color)
+	{
+		pixel_statistics[(y - tile.y) * tile.width + x - tile.x].Add(color);
+	};
+
+	Intersection intersections[RayPacket::MaxSize];
+	const IIntersectable *objects[RayPacket::MaxSize];
+	for (size_t block_y = tile.y; block_y < tile.y + tile.height; block_y += PacketTileSize)
+	{
+		for (size_t block_x = tile.x; block_x < tile.x + tile.width; block_x += PacketTileSize)
+		{
+			const size_t block_width = std::min(PacketTileSize, tile.x + tile.width - block_x);
+			const size_t block_height = std::min(PacketTileSize, tile.y + tile.height - block_y);
+			const size_t block_size = block_width * block_height;
+			auto pixel_x = [&](size_t index) { return block_x + index % block_width; };
+			auto pixel_y = [&](size_t index) { return block_y + index / block_width; };
+
+			if (!packet_tracing)
+			{
+				for (size_t index = 0; index < block_size; index++)
+				{
+					for (unsigned int i = 0; i < samples; i++)
+					{
+						Ray ray = camera.GetRay(pixel_x(index), pixel_y(index), i);
+						PixelRenderTask::TraceRay(ray, camera.PixelIndex(pixel_x(index), pixel_y(index)), i, scene, acceleration_structure);
+						accumulate(pixel_x(index), pixel_y(index), ray.RayColor());
+					}
+				}
+
+				continue;
+			}
+
+			for (unsigned int i = 0; i < samples; i++)
+			{
+				RayPacket packet;
+				for (size_t index = 0; index < block_size; index++)
+				{
+					packet.Add(camera.GetRay(pixel_x(index), pixel_y(index), i));
+				}
+
+				acceleration_structure.IntersectsPacket(packet, intersections, objects);
+
+				for (size_t index = 0; index < block_size; index++)
+				{
+					Ray ray = packet[index];
+					if (ray.Direction() != Vector3<float>(0, 0, 0))
+					{
+						PixelRenderTask::TracePath(ray, intersections[index], objects[index], camera.PixelIndex(pixel_x(index), pixel_y(index)), i,
+							scene, acceleration_structure);
+					}
+
+					accumulate(pixel_x(index), pixel_y(index), ray.RayColor());
+				}
+			}
+		}
+	}
+
+	for (size_t y = tile.y; y < tile.y + tile.height; y++)
+	{
+		for (size_t x = tile.x; x < tile.x + tile.width; x++)
+		{
+			frame_buffer.SetPixel(x, y, pixel_statistics[(y - tile.y) * tile.width + x - tile.x]);
+		}
+	}
+}
@@ -3,6 +3,7 @@
 #include "Mesh.h"
 #include "DiffuseBSDF.h"
 #include "Scene.h"
+#include "AccelerationStructureCache.h"
 #include <iostream>
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -15,6 +16,8 @@ using RayTracer::IScene;
 using RayTracer::Scene;
 using RayTracer::Vector3;
 using RayTracer::Mesh;
+using RayTracer::MeshGeometry;
+using RayTracer::AccelerationStructureCache;
 using RayTracer::DiffuseBSDF;
 
 using tinyobj::ObjReader;
@@ -22,7 +25,8 @@ using tinyobj::ObjReader;
 // TODO: This needs to read in the full set of data from the obj,
 // and make materials from the mtl files, and have face normals,
 // and, and, and etc...
-bool RayTracer::CreateSceneFromOBJFile(const std::string &file_path, ImageResolution resolution, Camera *&out_camera, IScene *&out_scene)
+static bool LoadGeometryFromOBJFile(const std::string &file_path, const RayTracer::BVHBuildOptions &bvh_build_options,
+	std::vector<std::shared_ptr<const MeshGeometry>> &out_geometry)
 {
 	ObjReader reader;
 	if (!reader.ParseFromFile(file_path))
@@ -30,8 +34,6 @@ bool RayTracer::CreateSceneFromOBJFile(const std::string &file_path, ImageResolu
 		return false;
 	}
 
-	std::vector<Mesh*> meshes;
-
 	for (const auto &shape : reader.GetShapes())
 	{
 		std::vector<Vector3<float>> mesh_vertices;
@@ -54,8 +56,59 @@ bool RayTracer::CreateSceneFromOBJFile(const std::string &file_path, ImageResolu
 			mesh_vertex_indicies.emplace_back(Vector3<size_t>(3 * i, 3 * i + 1, 3 * i + 2));
 		}
 
-		Mesh *mesh = new Mesh(std::make_shared<const DiffuseBSDF>(Color(1.0f, 0, 0, 1), 0.3f), mesh_vertices, mesh_vertex_indicies);
-		meshes.emplace_back(mesh);
+		out_geometry.emplace_back(std::make_shared<const MeshGeometry>(mesh_vertices, mesh_vertex_indicies, bvh_build_options));
+	}
+
+	return true;
+}
+
+bool RayTracer::CreateSceneFromOBJFile(const std::string &file_path, ImageResolution resolution, Camera *&out_camera, IScene *&out_scene,
+	const BVHBuildOptions &bvh_build_options, const std::string &cache_path)
+{
+	std::vector<std::shared_ptr<const MeshGeometry>> geometry;
+	uint64_t source_hash = 0;
+	bool loaded_from_cache = false;
+
+	if (!cache_path.empty())
+	{
+		try
+		{
+			source_hash = AccelerationStructureCache::HashFile(file_path);
+		}
+		catch (const std::exception &)
+		{
+			return false;
+		}
+
+		loaded_from_cache = AccelerationStructureCache::Load(cache_path, source_hash, bvh_build_options, geometry);
+		std::cout << (loaded_from_cache ? "Loaded meshes from cache " : "No usable cache at ") << cache_path << std::endl;
+	}
+
+	if (!loaded_from_cache)
+	{
+		if (!LoadGeometryFromOBJFile(file_path, bvh_build_options, geometry))
+		{
+			return false;
+		}
+
+		if (!cache_path.empty())
+		{
+			try
+			{
+				AccelerationStructureCache::Save(cache_path, source_hash, bvh_build_options, geometry);
+			}
+			catch (const std::exception &e)
+			{
+				// Rendering can go ahead without the cache
+				std::cout << "Failed to write cache " << cache_path << ": " << e.what() << std::endl;
+			}
+		}
+	}
+
+	std::vector<Mesh*> meshes;
+	for (const auto &mesh_geometry : geometry)
+	{
+		meshes.emplace_back(new Mesh(std::make_shared<const DiffuseBSDF>(Color(1.0f, 0, 0, 1), 0.3f), mesh_geometry));
 	}
 
 	out_camera = new Camera(resolution, Vector3<float>(-5, 5, 5), Vector3<float>(1, -1, -1), 50, 18);
@@ -0,0 +1,80 @@
+#include "TraversalHierarchy.h"
+
+using RayTracer::TraversalHierarchy;
+using RayTracer::BVH;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BoundingBox;
+using RayTracer::ThreadPool;
+using RayTracer::WideBVH;
+using RayTracer::QuantizedBVH;
+
+TraversalHierarchy::TraversalHierarchy(const std::vector<BoundingBox> &primitive_bounds, const BVHBuildOptions &options,
+	const BVH::PrimitiveClipper &clip_primitive)
+	: bvh(primitive_bounds, options, clip_primitive), width(2), quantized(false)
+{
+	BuildLayout(options);
+}
+
+TraversalHierarchy::TraversalHierarchy(BVH &&binary, const BVHBuildOptions &options)
+	: bvh(std::move(binary)), width(2), quantized(false)
+{
+	BuildLayout(options);
+}
+
+void TraversalHierarchy::BuildLayout(const BVHBuildOptions &options)
+{
+	if (options.QuantizedNodes)
+	{
+		quantized_4 = QuantizedBVH(bvh);
+		width = 4;
+		quantized = true;
+	}
+	else if (8 == options.Width)
+	{
+		wide_8 = WideBVH<8>(bvh);
+		width = 8;
+	}
+	else if (4 == options.Width)
+	{
+		wide_4 = WideBVH<4>(bvh);
+		width = 4;
+	}
+}
+
+float TraversalHierarchy::Refit(const std::vector<BoundingBox> &slot_bounds, ThreadPool *pool)
+{
+	float sah_cost = bvh.Refit(slot_bounds, pool);
+
+	if (quantized)
+	{
+		quantized_4.Refit(bvh);
+	}
+	else if (8 == width)
+	{
+		wide_8.Refit(bvh);
+	}
+	else if (4 == width)
+	{
+		wide_4.Refit(bvh);
+	}
+
+	return sah_cost;
+}
+
+size_t TraversalHierarchy::MemoryBytes() const
+{
+	if (quantized)
+	{
+		return quantized_4.MemoryBytes();
+	}
+
+	switch (width)
+	{
+	case 8:
+		return wide_8.MemoryBytes();
+	case 4:
+		return wide_4.MemoryBytes();
+	default:
+		return bvh.MemoryBytes();
+	}
+}
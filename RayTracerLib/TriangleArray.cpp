@@ -0,0 +1,345 @@
+#include "TriangleArray.h"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+using RayTracer::TriangleArray;
+using RayTracer::Vector3;
+
+// Rows of the Moller-Trumbore layout, the watertight layout has the three vertices in the same places
+enum Row
+{
+	base_x, base_y, base_z,
+	edge_1_x, edge_1_y, edge_1_z,
+	edge_2_x, edge_2_y, edge_2_z
+};
+
+TriangleArray::TriangleArray(size_t triangle_count, bool watertight) : triangle_count(triangle_count), watertight(watertight), normals(3 * triangle_count, 0.0f)
+{
+	for (auto &row : components)
+	{
+		row.assign(triangle_count + BatchWidth, 0.0f);
+	}
+}
+
+void TriangleArray::Set(size_t index, const Vector3<float> &vertex_1, const Vector3<float> &vertex_2, const Vector3<float> &vertex_3)
+{
+	const Vector3<float> edge_1 = vertex_2 - vertex_1;
+	const Vector3<float> edge_2 = vertex_3 - vertex_1;
+	const Vector3<float> normal = edge_1.Cross(edge_2);
+	const Vector3<float> &second = watertight ? vertex_2 : edge_1;
+	const Vector3<float> &third = watertight ? vertex_3 : edge_2;
+	const float values[9] = { vertex_1.X, vertex_1.Y, vertex_1.Z, second.X, second.Y, second.Z, third.X, third.Y, third.Z };
+	for (size_t row = 0; row < 9; row++)
+	{
+		components[row][index] = values[row];
+	}
+
+	normals[3 * index] = normal.X;
+	normals[3 * index + 1] = normal.Y;
+	normals[3 * index + 2] = normal.Z;
+}
+
+static uint32_t DominantAxis(const float direction[3])
+{
+	uint32_t z_axis = 0;
+	for (uint32_t axis = 1; axis < 3; axis++)
+	{
+		if (std::fabs(direction[axis]) > std::fabs(direction[z_axis]))
+		{
+			z_axis = axis;
+		}
+	}
+
+	return z_axis;
+}
+
+TriangleArray::WatertightRay::WatertightRay(const float origin[3], const float direction[3])
+	: WatertightRay(origin, direction, DominantAxis(direction))
+{
+}
+
+TriangleArray::WatertightRay::WatertightRay(const float origin[3], const float direction[3], uint32_t z_axis)
+	: origin{ origin[0], origin[1], origin[2] }
+{
+	axes[0] = (z_axis + 1) % 3;
+	axes[1] = (z_axis + 2) % 3;
+	axes[2] = z_axis;
+	if (direction[z_axis] < 0.0f)
+	{
+		std::swap(axes[0], axes[1]);
+	}
+
+	shear[0] = direction[axes[0]] / direction[z_axis];
+	shear[1] = direction[axes[1]] / direction[z_axis];
+	shear[2] = 1.0f / direction[z_axis];
+}
+
+#if defined(__AVX__)
+// Closest hit of a batch: reduce to the minimum depth, then find the first lane holding it. Returns
+// false when no lane hits.
+static bool ClosestLane(__m256 depths, __m256 hit, float &out_depth, uint32_t &out_lane)
+{
+	if (0 == _mm256_movemask_ps(hit))
+	{
+		return false;
+	}
+
+	const __m256 hit_depths = _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::infinity()), depths, hit);
+	__m256 closest = _mm256_min_ps(hit_depths, _mm256_permute2f128_ps(hit_depths, hit_depths, 1));
+	closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(1, 0, 3, 2)));
+	closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	const uint32_t closest_lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(hit_depths, closest, _CMP_EQ_OQ)));
+	out_depth = _mm256_cvtss_f32(closest);
+	out_lane = std::countr_zero(closest_lanes);
+	return true;
+}
+#endif
+
+// See https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+bool TriangleArray::IntersectsRay(const float origin[3], const float direction[3], uint32_t first_index, uint32_t count,
+	float &max_depth, uint32_t &out_index) const
+{
+	bool intersection_found = false;
+
+#if defined(__AVX__)
+	const __m256 direction_x = _mm256_set1_ps(direction[0]);
+	const __m256 direction_y = _mm256_set1_ps(direction[1]);
+	const __m256 direction_z = _mm256_set1_ps(direction[2]);
+	const __m256 origin_x = _mm256_set1_ps(origin[0]);
+	const __m256 origin_y = _mm256_set1_ps(origin[1]);
+	const __m256 origin_z = _mm256_set1_ps(origin[2]);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 lane_indices = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (uint32_t batch_start = first_index; batch_start < first_index + count; batch_start += BatchWidth)
+	{
+		auto load = [&](Row row) { return _mm256_loadu_ps(components[row].data() + batch_start); };
+		const __m256 e1_x = load(edge_1_x);
+		const __m256 e1_y = load(edge_1_y);
+		const __m256 e1_z = load(edge_1_z);
+		const __m256 e2_x = load(edge_2_x);
+		const __m256 e2_y = load(edge_2_y);
+		const __m256 e2_z = load(edge_2_z);
+
+		// h = direction x edge_2
+		const __m256 h_x = _mm256_sub_ps(_mm256_mul_ps(direction_y, e2_z), _mm256_mul_ps(direction_z, e2_y));
+		const __m256 h_y = _mm256_sub_ps(_mm256_mul_ps(direction_z, e2_x), _mm256_mul_ps(direction_x, e2_z));
+		const __m256 h_z = _mm256_sub_ps(_mm256_mul_ps(direction_x, e2_y), _mm256_mul_ps(direction_y, e2_x));
+		const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1_x, h_x), _mm256_mul_ps(e1_y, h_y)), _mm256_mul_ps(e1_z, h_z));
+		const __m256 f = _mm256_div_ps(one, a);
+
+		const __m256 s_x = _mm256_sub_ps(origin_x, load(base_x));
+		const __m256 s_y = _mm256_sub_ps(origin_y, load(base_y));
+		const __m256 s_z = _mm256_sub_ps(origin_z, load(base_z));
+		const __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(s_x, h_x), _mm256_mul_ps(s_y, h_y)), _mm256_mul_ps(s_z, h_z)));
+
+		// q = s x edge_1
+		const __m256 q_x = _mm256_sub_ps(_mm256_mul_ps(s_y, e1_z), _mm256_mul_ps(s_z, e1_y));
+		const __m256 q_y = _mm256_sub_ps(_mm256_mul_ps(s_z, e1_x), _mm256_mul_ps(s_x, e1_z));
+		const __m256 q_z = _mm256_sub_ps(_mm256_mul_ps(s_x, e1_y), _mm256_mul_ps(s_y, e1_x));
+		const __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(direction_x, q_x), _mm256_mul_ps(direction_y, q_y)), _mm256_mul_ps(direction_z, q_z)));
+		const __m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2_x, q_x), _mm256_mul_ps(e2_y, q_y)), _mm256_mul_ps(e2_z, q_z)));
+
+		// Ordered comparisons also reject the NaNs of rays parallel to a triangle
+		__m256 hit = _mm256_cmp_ps(a, zero, _CMP_NEQ_OQ);
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GT_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(max_depth), _CMP_LT_OQ));
+		// Lanes past the end of the range hold other triangles or padding
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(lane_indices, _mm256_set1_ps(static_cast<float>(first_index + count - batch_start)), _CMP_LT_OQ));
+
+		uint32_t closest_lane = 0;
+		if (ClosestLane(t, hit, max_depth, closest_lane))
+		{
+			out_index = batch_start + closest_lane;
+			intersection_found = true;
+		}
+	}
+#else
+	for (uint32_t index = first_index; index < first_index + count; index++)
+	{
+		auto component = [&](Row row) { return components[row][index]; };
+		const float edge_1[3] = { component(edge_1_x), component(edge_1_y), component(edge_1_z) };
+		const float edge_2[3] = { component(edge_2_x), component(edge_2_y), component(edge_2_z) };
+
+		const float h[3] = {
+			direction[1] * edge_2[2] - direction[2] * edge_2[1],
+			direction[2] * edge_2[0] - direction[0] * edge_2[2],
+			direction[0] * edge_2[1] - direction[1] * edge_2[0] };
+		float a = edge_1[0] * h[0] + edge_1[1] * h[1] + edge_1[2] * h[2];
+
+		if (0 == a)
+		{
+			// The ray is parallel to the triangle
+			continue;
+		}
+
+		float f = 1.0f / a;
+		const float s[3] = { origin[0] - component(base_x), origin[1] - component(base_y), origin[2] - component(base_z) };
+		float u = f * (s[0] * h[0] + s[1] * h[1] + s[2] * h[2]);
+
+		if (0.0f > u || 1.0f < u)
+		{
+			continue;
+		}
+
+		const float q[3] = {
+			s[1] * edge_1[2] - s[2] * edge_1[1],
+			s[2] * edge_1[0] - s[0] * edge_1[2],
+			s[0] * edge_1[1] - s[1] * edge_1[0] };
+		float v = f * (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]);
+
+		if (0.0f > v || 1.0f < (u + v))
+		{
+			continue;
+		}
+
+		// If "t" is negative there is a line intersection but not a ray
+		// (the intersection is behind the ray)
+		float t = f * (edge_2[0] * q[0] + edge_2[1] * q[1] + edge_2[2] * q[2]);
+		if (0 < t && t < max_depth)
+		{
+			max_depth = t;
+			out_index = index;
+			intersection_found = true;
+		}
+	}
+#endif
+
+	return intersection_found;
+}
+
+bool TriangleArray::WatertightDepth(const WatertightRay &ray, size_t index, float &out_depth) const
+{
+	// Vertices relative to the origin, permuted and sheared so the ray runs along +z
+	float x[3], y[3], z[3];
+	for (size_t vertex = 0; vertex < 3; vertex++)
+	{
+		const float relative_x = components[3 * vertex + ray.axes[0]][index] - ray.origin[ray.axes[0]];
+		const float relative_y = components[3 * vertex + ray.axes[1]][index] - ray.origin[ray.axes[1]];
+		const float relative_z = components[3 * vertex + ray.axes[2]][index] - ray.origin[ray.axes[2]];
+		x[vertex] = relative_x - ray.shear[0] * relative_z;
+		y[vertex] = relative_y - ray.shear[1] * relative_z;
+		z[vertex] = ray.shear[2] * relative_z;
+	}
+
+	// Scaled barycentrics, the edge functions of the edges opposite each vertex
+	float u = x[2] * y[1] - y[2] * x[1];
+	float v = x[0] * y[2] - y[0] * x[2];
+	float w = x[1] * y[0] - y[1] * x[0];
+
+	// Exactly zero can be the product of rounding, double precision tells which side the ray is on
+	if (0.0f == u || 0.0f == v || 0.0f == w)
+	{
+		u = static_cast<float>(static_cast<double>(x[2]) * y[1] - static_cast<double>(y[2]) * x[1]);
+		v = static_cast<float>(static_cast<double>(x[0]) * y[2] - static_cast<double>(y[0]) * x[2]);
+		w = static_cast<float>(static_cast<double>(x[1]) * y[0] - static_cast<double>(y[1]) * x[0]);
+	}
+
+	// Both windings hit, so only mixed signs miss
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+	{
+		return false;
+	}
+
+	const float determinant = u + v + w;
+	if (0.0f == determinant)
+	{
+		return false;
+	}
+
+	out_depth = (u * z[0] + v * z[1] + w * z[2]) / determinant;
+	return true;
+}
+
+bool TriangleArray::IntersectsRayWatertight(const WatertightRay &ray, uint32_t first_index, uint32_t count,
+	float &max_depth, uint32_t &out_index) const
+{
+	bool intersection_found = false;
+
+#if defined(__AVX__)
+	const __m256 origin[3] = { _mm256_set1_ps(ray.origin[ray.axes[0]]), _mm256_set1_ps(ray.origin[ray.axes[1]]), _mm256_set1_ps(ray.origin[ray.axes[2]]) };
+	const __m256 shear_x = _mm256_set1_ps(ray.shear[0]);
+	const __m256 shear_y = _mm256_set1_ps(ray.shear[1]);
+	const __m256 shear_z = _mm256_set1_ps(ray.shear[2]);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 lane_indices = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (uint32_t batch_start = first_index; batch_start < first_index + count; batch_start += BatchWidth)
+	{
+		__m256 x[3], y[3], z[3];
+		for (size_t vertex = 0; vertex < 3; vertex++)
+		{
+			auto load_relative = [&](size_t axis) { return _mm256_sub_ps(_mm256_loadu_ps(components[3 * vertex + ray.axes[axis]].data() + batch_start), origin[axis]); };
+			const __m256 relative_z = load_relative(2);
+			x[vertex] = _mm256_sub_ps(load_relative(0), _mm256_mul_ps(shear_x, relative_z));
+			y[vertex] = _mm256_sub_ps(load_relative(1), _mm256_mul_ps(shear_y, relative_z));
+			z[vertex] = _mm256_mul_ps(shear_z, relative_z);
+		}
+
+		const __m256 u = _mm256_sub_ps(_mm256_mul_ps(x[2], y[1]), _mm256_mul_ps(y[2], x[1]));
+		const __m256 v = _mm256_sub_ps(_mm256_mul_ps(x[0], y[2]), _mm256_mul_ps(y[0], x[2]));
+		const __m256 w = _mm256_sub_ps(_mm256_mul_ps(x[1], y[0]), _mm256_mul_ps(y[1], x[0]));
+
+		// Lanes past the end of the range hold other triangles or padding
+		const __m256 in_range = _mm256_cmp_ps(lane_indices, _mm256_set1_ps(static_cast<float>(first_index + count - batch_start)), _CMP_LT_OQ);
+
+		// Lanes with a zero edge function are redone one at a time, see WatertightDepth
+		const __m256 any_zero = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_EQ_OQ), _mm256_cmp_ps(v, zero, _CMP_EQ_OQ)), _mm256_cmp_ps(w, zero, _CMP_EQ_OQ));
+		const __m256 any_negative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(v, zero, _CMP_LT_OQ)), _mm256_cmp_ps(w, zero, _CMP_LT_OQ));
+		const __m256 any_positive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ), _mm256_cmp_ps(v, zero, _CMP_GT_OQ)), _mm256_cmp_ps(w, zero, _CMP_GT_OQ));
+
+		const __m256 determinant = _mm256_add_ps(_mm256_add_ps(u, v), w);
+		const __m256 t = _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(u, z[0]), _mm256_mul_ps(v, z[1])), _mm256_mul_ps(w, z[2])), determinant);
+
+		__m256 hit = _mm256_andnot_ps(_mm256_or_ps(any_zero, _mm256_and_ps(any_negative, any_positive)), in_range);
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(determinant, zero, _CMP_NEQ_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GT_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(max_depth), _CMP_LT_OQ));
+
+		uint32_t closest_lane = 0;
+		if (ClosestLane(t, hit, max_depth, closest_lane))
+		{
+			out_index = batch_start + closest_lane;
+			intersection_found = true;
+		}
+
+		for (uint32_t zero_lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(any_zero, in_range))); 0 != zero_lanes; zero_lanes &= zero_lanes - 1)
+		{
+			const uint32_t index = batch_start + std::countr_zero(zero_lanes);
+			float depth = 0.0f;
+			if (WatertightDepth(ray, index, depth) && depth > 0.0f && depth < max_depth)
+			{
+				max_depth = depth;
+				out_index = index;
+				intersection_found = true;
+			}
+		}
+	}
+#else
+	for (uint32_t index = first_index; index < first_index + count; index++)
+	{
+		float depth = 0.0f;
+		if (WatertightDepth(ray, index, depth) && depth > 0.0f && depth < max_depth)
+		{
+			max_depth = depth;
+			out_index = index;
+			intersection_found = true;
+		}
+	}
+#endif
+
+	return intersection_found;
+}
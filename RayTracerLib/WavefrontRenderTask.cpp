@@ -0,0 +1,259 @@
+#include "WavefrontRenderTask.h"
+#include "PixelRenderTask.h"
+#include "TileRenderTask.h"
+#include "RayPacket.h"
+#include "IMaterial.h"
+#include "IWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+using RayTracer::WavefrontRenderTask;
+using RayTracer::PixelRenderTask;
+using RayTracer::TileRenderTask;
+using RayTracer::Camera;
+using RayTracer::Ray;
+using RayTracer::RayPacket;
+using RayTracer::IScene;
+using RayTracer::IAccelerationStructure;
+using RayTracer::IIntersectable;
+using RayTracer::IMaterial;
+using RayTracer::IWorld;
+using RayTracer::Color;
+using RayTracer::Intersection;
+using RayTracer::PCG32;
+using RayTracer::FrameBuffer;
+using RayTracer::SampleStatistics;
+using RayTracer::ImageTile;
+using RayTracer::Vector3;
+
+WavefrontRenderTask::WavefrontRenderTask(const Camera &camera, const std::vector<ImageTile> &tiles, unsigned int samples, const IScene &scene,
+	const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer) :
+	camera(camera), tiles(tiles), samples(samples), scene(scene), acceleration_structure(acceleration_structure), frame_buffer(frame_buffer)
+{
+}
+
+Ray WavefrontRenderTask::ActiveRay(uint32_t index) const
+{
+	return Ray(Vector3<float>(origins[0][index], origins[1][index], origins[2][index]),
+		Vector3<float>(directions[0][index], directions[1][index], directions[2][index]), colors[index]);
+}
+
+void WavefrontRenderTask::SetRay(uint32_t index, const Ray &ray)
+{
+	origins[0][index] = ray.Origin().X;
+	origins[1][index] = ray.Origin().Y;
+	origins[2][index] = ray.Origin().Z;
+	directions[0][index] = ray.Direction().X;
+	directions[1][index] = ray.Direction().Y;
+	directions[2][index] = ray.Direction().Z;
+	colors[index] = ray.RayColor();
+}
+
+void WavefrontRenderTask::InitializeRays(unsigned int sample)
+{
+	active_rays.clear();
+	for (uint32_t index = 0; index < pixel_x.size(); index++)
+	{
+		SetRay(index, camera.GetRay(pixel_x[index], pixel_y[index], sample));
+
+		// A ray without a direction keeps its initial color, like in PixelRenderTask
+		if (0.0f != directions[0][index] || 0.0f != directions[1][index] || 0.0f != directions[2][index])
+		{
+			active_rays.emplace_back(index);
+		}
+	}
+}
+
+void WavefrontRenderTask::IntersectRays(bool camera_rays)
+{
+	if (camera_rays)
+	{
+		// The pixels come tile by tile, so consecutive camera rays make coherent packets
+		for (size_t first = 0; first < active_rays.size(); first += RayPacket::MaxSize)
+		{
+			const size_t count = std::min<size_t>(RayPacket::MaxSize, active_rays.size() - first);
+
+			RayPacket packet;
+			for (size_t ray = 0; ray < count; ray++)
+			{
+				packet.Add(ActiveRay(active_rays[first + ray]));
+			}
+
+			Intersection packet_intersections[RayPacket::MaxSize];
+			const IIntersectable *packet_objects[RayPacket::MaxSize];
+			acceleration_structure.IntersectsPacket(packet, packet_intersections, packet_objects);
+
+			for (size_t ray = 0; ray < count; ray++)
+			{
+				intersections[active_rays[first + ray]] = packet_intersections[ray];
+				objects[active_rays[first + ray]] = packet_objects[ray];
+			}
+		}
+
+		return;
+	}
+
+	// Bounced rays start all over the scene, grouping them by the octant of their direction at least
+	// makes consecutive traversals visit the children of each node in the same order
+	size_t octant_starts[9] = {};
+	auto octant = [this](uint32_t index)
+	{
+		return (std::signbit(directions[0][index]) ? 1 : 0) | (std::signbit(directions[1][index]) ? 2 : 0) | (std::signbit(directions[2][index]) ? 4 : 0);
+	};
+
+	for (uint32_t index : active_rays)
+	{
+		octant_starts[octant(index) + 1]++;
+	}
+	for (size_t i = 1; i < 9; i++)
+	{
+		octant_starts[i] += octant_starts[i - 1];
+	}
+
+	sorted_rays.resize(active_rays.size());
+	for (uint32_t index : active_rays)
+	{
+		sorted_rays[octant_starts[octant(index)]++] = index;
+	}
+	active_rays.swap(sorted_rays);
+
+	for (uint32_t index : active_rays)
+	{
+		if (!acceleration_structure.IntersectsRay(ActiveRay(index), intersections[index], objects[index]))
+		{
+			objects[index] = nullptr;
+		}
+	}
+}
+
+void WavefrontRenderTask::CalculateMaterials(unsigned int sample, unsigned int bounce)
+{
+	const IWorld *world = scene.World();
+	auto material = [this](uint32_t index) -> const IMaterial *
+	{
+		return nullptr != objects[index] ? objects[index]->Material().get() : nullptr;
+	};
+
+	// Rays that hit the same material are shaded one after the other. Scenes have few materials, so
+	// they are numbered in the order they are first hit and the rays bucketed by that number.
+	const IMaterial *previous_material = nullptr;
+	uint32_t previous_slot = 0;
+	material_slots.resize(active_rays.size());
+	for (size_t ray = 0; ray < active_rays.size(); ray++)
+	{
+		const IMaterial *hit_material = material(active_rays[ray]);
+		if (0 == ray || hit_material != previous_material)
+		{
+			previous_material = hit_material;
+			previous_slot = static_cast<uint32_t>(std::find(materials.begin(), materials.end(), hit_material) - materials.begin());
+			if (previous_slot == materials.size())
+			{
+				materials.emplace_back(hit_material);
+			}
+		}
+
+		material_slots[ray] = previous_slot;
+	}
+
+	std::vector<size_t> slot_starts(materials.size() + 1, 0);
+	for (uint32_t slot : material_slots)
+	{
+		slot_starts[slot + 1]++;
+	}
+	for (size_t i = 1; i < slot_starts.size(); i++)
+	{
+		slot_starts[i] += slot_starts[i - 1];
+	}
+
+	sorted_rays.resize(active_rays.size());
+	for (size_t ray = 0; ray < active_rays.size(); ray++)
+	{
+		sorted_rays[slot_starts[material_slots[ray]]++] = active_rays[ray];
+	}
+	active_rays.swap(sorted_rays);
+
+	sorted_rays.clear();
+	for (uint32_t index : active_rays)
+	{
+		const IMaterial *hit_material = material(index);
+		if (nullptr == hit_material)
+		{
+			// Intersect with the world
+			colors[index] = colors[index] * world->SurfaceColor(Vector3<float>(directions[0][index], directions[1][index], directions[2][index]));
+			continue;
+		}
+
+		Ray reflected_ray;
+		PCG32 random = PCG32::ForPath(camera.PixelIndex(pixel_x[index], pixel_y[index]), sample, bounce + 1);
+		hit_material->GetResultantRay(intersections[index], ActiveRay(index), reflected_ray, random);
+		SetRay(index, reflected_ray);
+
+		if (bounce + 1 == PixelRenderTask::MaxBounces)
+		{
+			colors[index] = colors[index] * world->AmbientColor();
+			continue;
+		}
+
+		if (reflected_ray.Direction() == Vector3<float>(0, 0, 0))
+		{
+			continue;
+		}
+
+		sorted_rays.emplace_back(index);
+	}
+
+	active_rays.swap(sorted_rays);
+}
+
+void WavefrontRenderTask::AccumulateSamples()
+{
+	for (size_t index = 0; index < pixel_x.size(); index++)
+	{
+		pixel_statistics[index].Add(colors[index]);
+	}
+}
+
+void WavefrontRenderTask::Execute()
+{
+	pixel_x.clear();
+	pixel_y.clear();
+	for (const ImageTile &tile : tiles)
+	{
+		TileRenderTask::ForEachPixel(tile, [this](size_t x, size_t y)
+			{
+				pixel_x.emplace_back(static_cast<uint32_t>(x));
+				pixel_y.emplace_back(static_cast<uint32_t>(y));
+			});
+	}
+
+	const size_t ray_count = pixel_x.size();
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		origins[axis].resize(ray_count);
+		directions[axis].resize(ray_count);
+	}
+	colors.resize(ray_count);
+	intersections.resize(ray_count);
+	objects.resize(ray_count);
+	active_rays.reserve(ray_count);
+	sorted_rays.reserve(ray_count);
+	pixel_statistics.assign(ray_count, SampleStatistics());
+
+	for (unsigned int i = 0; i < samples; i++)
+	{
+		InitializeRays(i);
+		for (unsigned int bounce = 0; !active_rays.empty(); bounce++)
+		{
+			IntersectRays(0 == bounce);
+			CalculateMaterials(i, bounce);
+		}
+
+		AccumulateSamples();
+	}
+
+	for (size_t index = 0; index < ray_count; index++)
+	{
+		frame_buffer.SetPixel(pixel_x[index], pixel_y[index], pixel_statistics[index]);
+	}
+}
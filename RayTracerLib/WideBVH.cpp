@@ -0,0 +1,155 @@
+#include "WideBVH.h"
+
+using RayTracer::WideBVH;
+using RayTracer::BVH;
+
+template <size_t Width>
+WideBVH<Width>::WideBVH(const BVH &binary)
+{
+	const std::vector<BVH::Node> &binary_nodes = binary.Nodes();
+	if (binary_nodes.empty())
+	{
+		return;
+	}
+
+	nodes.reserve(binary_nodes.size() / (Width - 1) + 1);
+	source_nodes.reserve(nodes.capacity() * Width);
+
+	if (binary_nodes[0].IsLeaf())
+	{
+		// The root has to be an interior node, so a single leaf becomes its only child
+		nodes.emplace_back();
+		source_nodes.resize(Width);
+		for (size_t child_index = 0; child_index < Width; child_index++)
+		{
+			SetChild(0, child_index, BVH::Node(), EmptyChild);
+		}
+
+		SetChild(0, 0, binary_nodes[0], 0);
+		return;
+	}
+
+	Collapse(binary, 0);
+}
+
+template <size_t Width>
+void WideBVH<Width>::SetChild(uint32_t node_index, size_t child_index, const BVH::Node &binary_node, uint32_t binary_index)
+{
+	Node &node = nodes[node_index];
+	source_nodes[node_index * Width + child_index] = binary_index;
+
+	if (EmptyChild == binary_index)
+	{
+		// An inverted box. The slab test orders the depths of each axis, so it still reports a hit for this
+		// box; traversal skips the slot because its child is EmptyChild.
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.bounds[axis][child_index] = std::numeric_limits<float>::infinity();
+			node.bounds[axis + 3][child_index] = -std::numeric_limits<float>::infinity();
+		}
+
+		node.child[child_index] = EmptyChild;
+		node.primitive_count[child_index] = 0;
+		return;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		node.bounds[axis][child_index] = binary_node.bounds.min[axis];
+		node.bounds[axis + 3][child_index] = binary_node.bounds.max[axis];
+	}
+
+	node.child[child_index] = binary_node.offset;
+	node.primitive_count[child_index] = binary_node.primitive_count;
+}
+
+template <size_t Width>
+uint32_t WideBVH<Width>::Collapse(const BVH &binary, uint32_t binary_index)
+{
+	const std::vector<BVH::Node> &binary_nodes = binary.Nodes();
+
+	// Start from the two children and keep opening the largest interior one until the node is full
+	uint32_t children[Width];
+	size_t child_count = 2;
+	children[0] = binary_index + 1;
+	children[1] = binary_nodes[binary_index].offset;
+
+	while (child_count < Width)
+	{
+		size_t largest = Width;
+		float largest_area = -1.0f;
+		for (size_t i = 0; i < child_count; i++)
+		{
+			const BVH::Node &candidate = binary_nodes[children[i]];
+			if (!candidate.IsLeaf() && candidate.bounds.SurfaceArea() > largest_area)
+			{
+				largest = i;
+				largest_area = candidate.bounds.SurfaceArea();
+			}
+		}
+
+		if (Width == largest)
+		{
+			break;
+		}
+
+		uint32_t opened = children[largest];
+		children[largest] = opened + 1;
+		children[child_count++] = binary_nodes[opened].offset;
+	}
+
+	const uint32_t node_index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	source_nodes.resize(nodes.size() * Width);
+
+	for (size_t child_index = 0; child_index < Width; child_index++)
+	{
+		if (child_index < child_count)
+		{
+			SetChild(node_index, child_index, binary_nodes[children[child_index]], children[child_index]);
+		}
+		else
+		{
+			SetChild(node_index, child_index, BVH::Node(), EmptyChild);
+		}
+	}
+
+	// Interior children are collapsed after the node is filled in, the vector may reallocate
+	for (size_t child_index = 0; child_index < child_count; child_index++)
+	{
+		if (!binary_nodes[children[child_index]].IsLeaf())
+		{
+			uint32_t child_node = Collapse(binary, children[child_index]);
+			nodes[node_index].child[child_index] = child_node;
+		}
+	}
+
+	return node_index;
+}
+
+template <size_t Width>
+void WideBVH<Width>::Refit(const BVH &binary)
+{
+	const std::vector<BVH::Node> &binary_nodes = binary.Nodes();
+	for (size_t node_index = 0; node_index < nodes.size(); node_index++)
+	{
+		Node &node = nodes[node_index];
+		for (size_t child_index = 0; child_index < Width; child_index++)
+		{
+			uint32_t binary_index = source_nodes[node_index * Width + child_index];
+			if (EmptyChild == binary_index)
+			{
+				continue;
+			}
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.bounds[axis][child_index] = binary_nodes[binary_index].bounds.min[axis];
+				node.bounds[axis + 3][child_index] = binary_nodes[binary_index].bounds.max[axis];
+			}
+		}
+	}
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "AccelerationStructureCache.h"
+#include "MeshGeometry.h"
+
+#include <filesystem>
+#include <fstream>
+
+using RayTracer::AccelerationStructureCache;
+using RayTracer::BVH;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVHBuilder;
+using RayTracer::MeshGeometry;
+using RayTracer::Intersection;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+
+namespace AccelerationStructureCacheTests
+{
+	static std::shared_ptr<const MeshGeometry> CreateRandomGeometry(size_t face_count, const BVHBuildOptions &options)
+	{
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> faces;
+		for (size_t i = 0; i < face_count; i++)
+		{
+			Vector3<float> corner((float)rand() / RAND_MAX * 10, (float)rand() / RAND_MAX * 10, (float)rand() / RAND_MAX * 10);
+			vertices.emplace_back(corner);
+			vertices.emplace_back(corner + Vector3<float>((float)rand() / RAND_MAX, 0.0f, 0.0f));
+			vertices.emplace_back(corner + Vector3<float>(0.0f, (float)rand() / RAND_MAX, 0.0f));
+			faces.emplace_back(3 * i, 3 * i + 1, 3 * i + 2);
+		}
+
+		return std::make_shared<const MeshGeometry>(vertices, faces, options);
+	}
+
+	static std::string TemporaryPath(const std::string &name)
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	static void WriteFile(const std::string &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		stream << contents;
+	}
+
+	TEST(AccelerationStructureCacheTests, HashFileTest)
+	{
+		const std::string path = TemporaryPath("hash_file_test.obj");
+		WriteFile(path, "v 0 0 0\n");
+		uint64_t first_hash = AccelerationStructureCache::HashFile(path);
+		ASSERT_EQ(first_hash, AccelerationStructureCache::HashFile(path));
+
+		WriteFile(path, "v 0 0 1\n");
+		ASSERT_NE(first_hash, AccelerationStructureCache::HashFile(path));
+
+		std::filesystem::remove(path);
+		ASSERT_THROW(AccelerationStructureCache::HashFile(path), std::exception);
+	}
+
+	TEST(AccelerationStructureCacheTests, RoundTripTest)
+	{
+		srand(21);
+		BVHBuildOptions options;
+		options.Builder = BVHBuilder::SBVH;
+		std::vector<std::shared_ptr<const MeshGeometry>> geometry = { CreateRandomGeometry(500, options), CreateRandomGeometry(3, options) };
+
+		const std::string cache_path = TemporaryPath("round_trip_test.bvhcache");
+		AccelerationStructureCache::Save(cache_path, 42, options, geometry);
+
+		std::vector<std::shared_ptr<const MeshGeometry>> loaded;
+		ASSERT_TRUE(AccelerationStructureCache::Load(cache_path, 42, options, loaded));
+		ASSERT_EQ(geometry.size(), loaded.size());
+
+		for (size_t mesh = 0; mesh < geometry.size(); mesh++)
+		{
+			const BVH &expected_bvh = geometry[mesh]->Hierarchy();
+			const BVH &loaded_bvh = loaded[mesh]->Hierarchy();
+			ASSERT_EQ(geometry[mesh]->VertexData(), loaded[mesh]->VertexData());
+			ASSERT_EQ(geometry[mesh]->VertexIndices, loaded[mesh]->VertexIndices);
+			ASSERT_EQ(expected_bvh.PrimitiveIndices(), loaded_bvh.PrimitiveIndices());
+			ASSERT_EQ(expected_bvh.Nodes().size(), loaded_bvh.Nodes().size());
+			ASSERT_FLOAT_EQ(expected_bvh.SAHCost(), loaded_bvh.SAHCost());
+		}
+
+		srand(22);
+		for (int i = 0; i < 500; i++)
+		{
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 10, (float)rand() / RAND_MAX * 10, -2.0f),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+			Intersection expected_intersection;
+			Intersection loaded_intersection;
+			bool expected = geometry[0]->IntersectsRay(ray, expected_intersection);
+			ASSERT_EQ(expected, loaded[0]->IntersectsRay(ray, loaded_intersection));
+			if (expected)
+			{
+				ASSERT_FLOAT_EQ(expected_intersection.Depth(), loaded_intersection.Depth());
+			}
+		}
+
+		// The traversal layout is not part of the key, it is rebuilt on load
+		BVHBuildOptions binary_options = options;
+		binary_options.Width = 2;
+		ASSERT_TRUE(AccelerationStructureCache::Load(cache_path, 42, binary_options, loaded));
+
+		std::filesystem::remove(cache_path);
+	}
+
+	TEST(AccelerationStructureCacheTests, StaleCacheTest)
+	{
+		srand(23);
+		BVHBuildOptions options;
+		std::vector<std::shared_ptr<const MeshGeometry>> geometry = { CreateRandomGeometry(200, options) };
+
+		const std::string cache_path = TemporaryPath("stale_cache_test.bvhcache");
+		AccelerationStructureCache::Save(cache_path, 7, options, geometry);
+
+		std::vector<std::shared_ptr<const MeshGeometry>> loaded;
+		ASSERT_FALSE(AccelerationStructureCache::Load(cache_path, 8, options, loaded));
+		ASSERT_TRUE(loaded.empty());
+
+		BVHBuildOptions other_options = options;
+		other_options.MaxLeafSize = 2;
+		ASSERT_FALSE(AccelerationStructureCache::Load(cache_path, 7, other_options, loaded));
+
+		ASSERT_FALSE(AccelerationStructureCache::Load(TemporaryPath("missing.bvhcache"), 7, options, loaded));
+
+		// Truncated files and broken trees are rejected instead of crashing
+		std::string contents;
+		{
+			std::ifstream stream(cache_path, std::ios::binary);
+			contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+
+		WriteFile(cache_path, contents.substr(0, contents.size() / 2));
+		ASSERT_FALSE(AccelerationStructureCache::Load(cache_path, 7, options, loaded));
+
+		// The first node's second child index sits right after its bounds, past the two headers and the arrays
+		const BVH &bvh = geometry[0]->Hierarchy();
+		size_t nodes_start = 32 + 32 + 3 * sizeof(float) * geometry[0]->VertexData().size() + 3 * sizeof(uint64_t) * geometry[0]->VertexIndices.size();
+		nodes_start = (nodes_start + 7) / 8 * 8;
+		ASSERT_FALSE(bvh.Nodes()[0].IsLeaf());
+		uint32_t broken_offset = 0xfffffff0;
+		std::memcpy(&contents[nodes_start + offsetof(BVH::Node, offset)], &broken_offset, sizeof(broken_offset));
+		WriteFile(cache_path, contents);
+		ASSERT_FALSE(AccelerationStructureCache::Load(cache_path, 7, options, loaded));
+
+		std::filesystem::remove(cache_path);
+	}
+}
@@ -0,0 +1,772 @@
+#include "gtest/gtest.h"
+#include "BVH.h"
+#include "BVHAccelerator.h"
+#include "WideBVH.h"
+#include "QuantizedBVH.h"
+#include "Sphere.h"
+#include "Mesh.h"
+
+using RayTracer::BVH;
+using RayTracer::BVHBuildOptions;
+using RayTracer::BVHBuilder;
+using RayTracer::ThreadPool;
+using RayTracer::WideBVH;
+using RayTracer::QuantizedBVH;
+using RayTracer::BVHAccelerator;
+using RayTracer::BoundingBox;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Sphere;
+using RayTracer::Mesh;
+using RayTracer::MeshGeometry;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+
+namespace BVHTests
+{
+	static std::vector<Sphere> CreateSphereGrid(size_t count_per_axis)
+	{
+		std::vector<Sphere> spheres;
+		spheres.reserve(count_per_axis * count_per_axis * count_per_axis);
+		for (size_t x = 0; x < count_per_axis; x++)
+		{
+			for (size_t y = 0; y < count_per_axis; y++)
+			{
+				for (size_t z = 0; z < count_per_axis; z++)
+				{
+					float radius = 0.2f + 0.1f * ((x + y + z) % 3);
+					spheres.emplace_back(Vector3<float>((float)x, (float)y, (float)z), radius);
+				}
+			}
+		}
+
+		return spheres;
+	}
+
+	static std::vector<const IIntersectable *> GetObjects(const std::vector<Sphere> &spheres)
+	{
+		std::vector<const IIntersectable *> objects;
+		for (const auto &sphere : spheres)
+		{
+			objects.emplace_back(&sphere);
+		}
+
+		return objects;
+	}
+
+	static bool BruteForceIntersection(const std::vector<const IIntersectable *> &objects, const Ray &ray, Intersection &out_intersection, const IIntersectable *&out_object)
+	{
+		bool intersection_found = false;
+		for (const auto &object : objects)
+		{
+			Intersection current_intersection;
+			if (object->IntersectsRay(ray, current_intersection) && current_intersection.Depth() < out_intersection.Depth())
+			{
+				out_intersection = current_intersection;
+				out_object = object;
+				intersection_found = true;
+			}
+		}
+
+		return intersection_found;
+	}
+
+	TEST(BVHTests, BoundingBoxRayTest_01)
+	{
+		BoundingBox box(Vector3<float>(-1, -1, -1), Vector3<float>(1, 1, 1));
+		const float inverse_direction[3] = { 1.0f, std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+		float entry_depth = 0.0f;
+
+		ASSERT_TRUE(box.IntersectsRay(Vector3<float>(-3, 0, 0), inverse_direction, 100.0f, entry_depth));
+		ASSERT_FLOAT_EQ(2.0f, entry_depth);
+		ASSERT_FALSE(box.IntersectsRay(Vector3<float>(-3, 0, 0), inverse_direction, 1.0f, entry_depth));
+		ASSERT_FALSE(box.IntersectsRay(Vector3<float>(-3, 2, 0), inverse_direction, 100.0f, entry_depth));
+	}
+
+	TEST(BVHTests, BVHBuildTest_01)
+	{
+		std::vector<BoundingBox> bounds;
+		for (int i = 0; i < 100; i++)
+		{
+			bounds.emplace_back(BoundingBox(Vector3<float>((float)i, 0, 0), Vector3<float>((float)i + 0.5f, 1, 1)));
+		}
+
+		BVH bvh(bounds);
+
+		ASSERT_FALSE(bvh.Empty());
+		ASSERT_EQ(100, bvh.PrimitiveIndices().size());
+		ASSERT_FLOAT_EQ(0.0f, bvh.Bounds().min[0]);
+		ASSERT_FLOAT_EQ(99.5f, bvh.Bounds().max[0]);
+
+		std::vector<bool> referenced(100, false);
+		for (const auto &index : bvh.PrimitiveIndices())
+		{
+			referenced[index] = true;
+		}
+
+		for (int i = 0; i < 100; i++)
+		{
+			ASSERT_TRUE(referenced[i]);
+		}
+	}
+
+	TEST(BVHTests, BVHBuildTest_Empty)
+	{
+		BVH bvh(std::vector<BoundingBox>{});
+		float max_depth = std::numeric_limits<float>::infinity();
+
+		ASSERT_TRUE(bvh.Empty());
+		ASSERT_FALSE(bvh.Traverse(Ray(Vector3<float>(0, 0, 0), Vector3<float>(1, 0, 0), Color()), max_depth,
+			[](uint32_t, float &) { return true; }));
+	}
+
+	TEST(BVHTests, BVHAcceleratorMatchesBruteForce)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+		BVHAccelerator accelerator(spheres);
+
+		srand(1);
+		for (int i = 0; i < 1000; i++)
+		{
+			Vector3<float> origin(-2.0f, (float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8);
+			Vector3<float> direction(1.0f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f);
+			Ray ray(origin, direction, Color());
+
+			Intersection expected_intersection;
+			const IIntersectable *expected_object = nullptr;
+			bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			bool intersects = accelerator.IntersectsRay(ray, intersection, object);
+
+			ASSERT_EQ(expected, intersects);
+			if (expected)
+			{
+				ASSERT_EQ(expected_object, object);
+				ASSERT_FLOAT_EQ(expected_intersection.Depth(), intersection.Depth());
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHAcceleratorMixedObjects)
+	{
+		Sphere sphere(Vector3<float>(0, 0, 3), 0.5f);
+		Mesh mesh(std::shared_ptr<RayTracer::IMaterial>(nullptr),
+			{
+				Vector3<float>(-1.0f, -1.0f, 1.0f),
+				Vector3<float>(1.0f, -1.0f, 1.0f),
+				Vector3<float>(-1.0f, 1.0f, 1.0f),
+			},
+			{
+				Vector3<size_t>(0, 1, 2)
+			});
+
+		BVHAccelerator accelerator({ &sphere, &mesh });
+
+		Intersection intersection;
+		const IIntersectable *object = nullptr;
+
+		ASSERT_TRUE(accelerator.IntersectsRay(Ray(Vector3<float>(-0.5f, -0.5f, 0.0f), Vector3<float>(0, 0, 1), Color()), intersection, object));
+		ASSERT_EQ(&mesh, object);
+		ASSERT_FLOAT_EQ(1.0f, intersection.Depth());
+
+		ASSERT_TRUE(accelerator.IntersectsRay(Ray(Vector3<float>(0.1f, 0.1f, 0.0f), Vector3<float>(0, 0, 1), Color()), intersection, object));
+		ASSERT_EQ(&sphere, object);
+
+		ASSERT_FALSE(accelerator.IntersectsRay(Ray(Vector3<float>(5.0f, 5.0f, 0.0f), Vector3<float>(0, 0, 1), Color()), intersection, object));
+	}
+
+	static std::vector<BoundingBox> CreateRandomBounds(size_t count)
+	{
+		std::vector<BoundingBox> bounds;
+		srand(2);
+		for (size_t i = 0; i < count; i++)
+		{
+			Vector3<float> minimum((float)rand() / RAND_MAX * 100, (float)rand() / RAND_MAX * 100, (float)rand() / RAND_MAX * 100);
+			Vector3<float> size((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
+			bounds.emplace_back(BoundingBox(minimum, minimum + size));
+		}
+
+		return bounds;
+	}
+
+	// Every primitive is referenced exactly once and every node contains its children
+	static void ValidateHierarchy(const BVH &bvh, size_t primitive_count)
+	{
+		ASSERT_EQ(primitive_count, bvh.PrimitiveIndices().size());
+		std::vector<bool> referenced(primitive_count, false);
+		for (const auto &index : bvh.PrimitiveIndices())
+		{
+			ASSERT_FALSE(referenced[index]);
+			referenced[index] = true;
+		}
+
+		const auto &nodes = bvh.Nodes();
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (nodes[i].IsLeaf())
+			{
+				ASSERT_LE(nodes[i].offset + nodes[i].primitive_count, primitive_count);
+				continue;
+			}
+
+			for (const BVH::Node &child : { nodes[i + 1], nodes[nodes[i].offset] })
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					ASSERT_LE(nodes[i].bounds.min[axis], child.bounds.min[axis]);
+					ASSERT_GE(nodes[i].bounds.max[axis], child.bounds.max[axis]);
+				}
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHBuildTest_BinnedParallel)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(20000);
+
+		BVHBuildOptions serial_options;
+		serial_options.ParallelBuildThreshold = std::numeric_limits<size_t>::max();
+		BVH serial_bvh(bounds, serial_options);
+
+		ThreadPool pool(4, 1000);
+		BVHBuildOptions parallel_options;
+		parallel_options.ParallelBuildThreshold = 1000;
+		parallel_options.Pool = &pool;
+		BVH parallel_bvh(bounds, parallel_options);
+
+		ValidateHierarchy(serial_bvh, bounds.size());
+		ValidateHierarchy(parallel_bvh, bounds.size());
+
+		// Both builds make the same split decisions, only the order they are made in differs
+		ASSERT_EQ(serial_bvh.Nodes().size(), parallel_bvh.Nodes().size());
+		ASSERT_EQ(serial_bvh.PrimitiveIndices(), parallel_bvh.PrimitiveIndices());
+	}
+
+	TEST(BVHTests, BVHBuildTest_Statistics)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(5000);
+
+		BVHBuildOptions sweep_options;
+		sweep_options.Builder = BVHBuilder::SweepSAH;
+		BVH sweep_bvh(bounds, sweep_options);
+		BVH binned_bvh(bounds);
+
+		BVH::Statistics sweep_statistics = sweep_bvh.ComputeStatistics();
+		BVH::Statistics binned_statistics = binned_bvh.ComputeStatistics();
+
+		size_t histogram_leaves = 0;
+		size_t histogram_primitives = 0;
+		for (size_t size = 0; size < binned_statistics.LeafSizeHistogram.size(); size++)
+		{
+			histogram_leaves += binned_statistics.LeafSizeHistogram[size];
+			histogram_primitives += size * binned_statistics.LeafSizeHistogram[size];
+		}
+
+		ASSERT_EQ(binned_statistics.LeafCount, histogram_leaves);
+		ASSERT_EQ(bounds.size(), histogram_primitives);
+		ASSERT_EQ(binned_bvh.Nodes().size(), binned_statistics.NodeCount);
+		ASSERT_EQ(binned_statistics.NodeCount, 2 * binned_statistics.LeafCount - 1);
+		ASSERT_LE(binned_statistics.MaxDepth, BVH::MaxDepth);
+		ASSERT_GE(binned_statistics.BuildTimeMilliseconds, 0.0);
+
+		// Binning only approximates the full sweep, it should not be far off
+		ASSERT_GT(binned_statistics.SAHCost, 0.0f);
+		ASSERT_LT(binned_statistics.SAHCost, sweep_statistics.SAHCost * 1.25f);
+	}
+
+	TEST(BVHTests, BVHBuildTest_LBVH)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(20000);
+
+		BVHBuildOptions serial_options;
+		serial_options.Builder = BVHBuilder::LBVH;
+		serial_options.ParallelBuildThreshold = std::numeric_limits<size_t>::max();
+		BVH serial_bvh(bounds, serial_options);
+
+		ThreadPool pool(4, 1000);
+		BVHBuildOptions parallel_options = serial_options;
+		parallel_options.ParallelBuildThreshold = 1000;
+		parallel_options.Pool = &pool;
+		BVH parallel_bvh(bounds, parallel_options);
+
+		ValidateHierarchy(serial_bvh, bounds.size());
+		ValidateHierarchy(parallel_bvh, bounds.size());
+		ASSERT_EQ(serial_bvh.PrimitiveIndices(), parallel_bvh.PrimitiveIndices());
+		ASSERT_LE(parallel_bvh.ComputeStatistics().MaxDepth, BVH::MaxDepth);
+	}
+
+	TEST(BVHTests, BVHAcceleratorMatchesBruteForce_LBVH)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+		BVHBuildOptions options;
+		options.Builder = BVHBuilder::LBVH;
+		options.MortonCodeBits = 30;
+		BVHAccelerator accelerator(spheres, options);
+
+		srand(3);
+		for (int i = 0; i < 1000; i++)
+		{
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 8, -2.0f, (float)rand() / RAND_MAX * 8),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, 1.0f, (float)rand() / RAND_MAX - 0.5f), Color());
+
+			Intersection expected_intersection;
+			const IIntersectable *expected_object = nullptr;
+			bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			ASSERT_EQ(expected, accelerator.IntersectsRay(ray, intersection, object));
+			if (expected)
+			{
+				ASSERT_EQ(expected_object, object);
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHRefitTest)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+		BVHAccelerator accelerator(spheres);
+		size_t node_count = accelerator.Hierarchy().Nodes().size();
+
+		// Small moves keep the topology and only refit the bounds
+		srand(4);
+		for (auto &sphere : sphere_grid)
+		{
+			sphere.SetPosition(sphere.Position() + Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 0.0f) * 0.2f);
+		}
+
+		ASSERT_FALSE(accelerator.Update());
+		ASSERT_EQ(node_count, accelerator.Hierarchy().Nodes().size());
+
+		for (int i = 0; i < 1000; i++)
+		{
+			Ray ray(Vector3<float>(-2.0f, (float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8),
+				Vector3<float>(1.0f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f), Color());
+
+			Intersection expected_intersection;
+			const IIntersectable *expected_object = nullptr;
+			bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			ASSERT_EQ(expected, accelerator.IntersectsRay(ray, intersection, object));
+			if (expected)
+			{
+				ASSERT_EQ(expected_object, object);
+			}
+		}
+
+		// Scattering the spheres ruins the refit tree, so the monitor rebuilds it
+		for (auto &sphere : sphere_grid)
+		{
+			sphere.SetPosition(Vector3<float>((float)rand() / RAND_MAX * 100, (float)rand() / RAND_MAX * 100, (float)rand() / RAND_MAX * 100));
+		}
+
+		ASSERT_TRUE(accelerator.Update());
+		ASSERT_FALSE(accelerator.Hierarchy().NeedsRebuild(1.0f));
+	}
+
+	TEST(BVHTests, BVHRefitTest_Parallel)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(20000);
+		BVH serial_bvh(bounds);
+		BVH parallel_bvh(bounds);
+
+		std::vector<BoundingBox> slot_bounds;
+		for (const auto &index : serial_bvh.PrimitiveIndices())
+		{
+			BoundingBox moved = bounds[index];
+			moved.Expand(Vector3<float>(moved.max[0] + 1.0f, moved.max[1], moved.max[2]));
+			slot_bounds.emplace_back(moved);
+		}
+
+		ThreadPool pool(4, 1000);
+		float serial_cost = serial_bvh.Refit(slot_bounds);
+		float parallel_cost = parallel_bvh.Refit(slot_bounds, &pool);
+
+		ASSERT_FLOAT_EQ(serial_cost, parallel_cost);
+		for (size_t i = 0; i < serial_bvh.Nodes().size(); i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				ASSERT_EQ(serial_bvh.Nodes()[i].bounds.min[axis], parallel_bvh.Nodes()[i].bounds.min[axis]);
+				ASSERT_EQ(serial_bvh.Nodes()[i].bounds.max[axis], parallel_bvh.Nodes()[i].bounds.max[axis]);
+			}
+		}
+
+		ValidateHierarchy(parallel_bvh, bounds.size());
+		ASSERT_THROW(serial_bvh.Refit({}), std::exception);
+	}
+
+	TEST(BVHTests, WideBVHMatchesBruteForce)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+
+		for (uint32_t width : { 2u, 4u, 8u })
+		{
+			BVHBuildOptions options;
+			options.Width = width;
+			BVHAccelerator accelerator(spheres, options);
+
+			srand(5);
+			for (int i = 0; i < 1000; i++)
+			{
+				Ray ray(Vector3<float>((float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8, -2.0f),
+					Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+				Intersection expected_intersection;
+				const IIntersectable *expected_object = nullptr;
+				bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+				Intersection intersection;
+				const IIntersectable *object = nullptr;
+				ASSERT_EQ(expected, accelerator.IntersectsRay(ray, intersection, object));
+				if (expected)
+				{
+					ASSERT_EQ(expected_object, object);
+					ASSERT_FLOAT_EQ(expected_intersection.Depth(), intersection.Depth());
+				}
+			}
+
+			// Refitting the wide layout follows the binary tree
+			for (auto &sphere : sphere_grid)
+			{
+				sphere.SetPosition(sphere.Position() + Vector3<float>(0.0f, 0.0f, 0.25f));
+			}
+
+			ASSERT_FALSE(accelerator.Update());
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			// The sphere at the origin has radius 0.2 and now sits at z = 0.25
+			ASSERT_TRUE(accelerator.IntersectsRay(Ray(Vector3<float>(0, 0, -2.0f), Vector3<float>(0, 0, 1), Color()), intersection, object));
+			ASSERT_NEAR(2.05f, intersection.Depth(), 1e-4f);
+
+			for (auto &sphere : sphere_grid)
+			{
+				sphere.SetPosition(sphere.Position() - Vector3<float>(0.0f, 0.0f, 0.25f));
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHAcceleratorOccludedMatchesIntersection)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> objects = GetObjects(sphere_grid);
+
+		// A tessellated plane through the grid, big enough to be traversed through its own BVH
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> faces;
+		for (size_t y = 0; y <= 6; y++)
+		{
+			for (size_t x = 0; x <= 6; x++)
+			{
+				vertices.emplace_back((float)x * 1.2f, (float)y * 1.2f, 3.5f + 0.1f * (float)((x * y) % 2));
+				if (x > 0 && y > 0)
+				{
+					size_t corner = y * 7 + x;
+					faces.emplace_back(corner - 8, corner - 7, corner - 1);
+					faces.emplace_back(corner - 1, corner - 7, corner);
+				}
+			}
+		}
+		Mesh plane(std::shared_ptr<RayTracer::IMaterial>(nullptr), vertices, faces);
+		objects.emplace_back(&plane);
+
+		for (uint32_t width : { 2u, 4u, 8u })
+		{
+			BVHBuildOptions options;
+			options.Width = width;
+			BVHAccelerator accelerator(objects, options);
+
+			srand(9);
+			for (int i = 0; i < 1000; i++)
+			{
+				Ray ray(Vector3<float>((float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8, -2.0f),
+					Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+				Intersection intersection;
+				const IIntersectable *object = nullptr;
+				if (!accelerator.IntersectsRay(ray, intersection, object))
+				{
+					ASSERT_FALSE(accelerator.Occluded(ray, std::numeric_limits<float>::infinity()));
+					continue;
+				}
+
+				// Depths on either side of the closest hit
+				ASSERT_TRUE(accelerator.Occluded(ray, intersection.Depth() * 1.01f));
+				ASSERT_FALSE(accelerator.Occluded(ray, intersection.Depth() * 0.99f));
+				ASSERT_TRUE(object->Occluded(ray, std::numeric_limits<float>::infinity()));
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHAcceleratorMaxDepthTest)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> objects = GetObjects(sphere_grid);
+		Mesh plane(std::shared_ptr<RayTracer::IMaterial>(nullptr),
+			{ Vector3<float>(-20, -20, 3.5f), Vector3<float>(20, -20, 3.5f), Vector3<float>(-20, 20, 3.5f) }, { Vector3<size_t>(0, 1, 2) });
+		objects.emplace_back(&plane);
+
+		BVHAccelerator accelerator(objects);
+
+		srand(10);
+		for (int i = 0; i < 1000; i++)
+		{
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8, -2.0f),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			if (!accelerator.IntersectsRay(ray, intersection, object))
+			{
+				continue;
+			}
+
+			// The ray's depth interval is an input, it comes back unchanged
+			ASSERT_EQ(std::numeric_limits<float>::infinity(), ray.MaxDepth());
+
+			Intersection limited_intersection;
+			const IIntersectable *limited_object = nullptr;
+			ray.SetMaxDepth(intersection.Depth() * 1.01f);
+			ASSERT_TRUE(accelerator.IntersectsRay(ray, limited_intersection, limited_object));
+			ASSERT_EQ(object, limited_object);
+			ASSERT_FLOAT_EQ(intersection.Depth() * 1.01f, ray.MaxDepth());
+
+			ray.SetMaxDepth(intersection.Depth() * 0.99f);
+			ASSERT_FALSE(accelerator.IntersectsRay(ray, limited_intersection, limited_object));
+		}
+	}
+
+	TEST(BVHTests, WideBVHCollapseTest)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(1000);
+		BVH binary(bounds);
+		WideBVH<4> wide_4(binary);
+		WideBVH<8> wide_8(binary);
+
+		// Collapsing removes most interior nodes and every leaf reference is kept
+		ASSERT_LT(wide_8.Nodes().size(), wide_4.Nodes().size());
+		ASSERT_LT(wide_4.Nodes().size(), binary.Nodes().size() / 2);
+
+		size_t referenced_primitives = 0;
+		for (const auto &node : wide_8.Nodes())
+		{
+			for (size_t child = 0; child < 8; child++)
+			{
+				if (WideBVH<8>::EmptyChild != node.child[child])
+				{
+					referenced_primitives += node.primitive_count[child];
+				}
+			}
+		}
+
+		ASSERT_EQ(bounds.size(), referenced_primitives);
+
+		// A single primitive still needs an interior root
+		BVH single(std::vector<BoundingBox>{ BoundingBox(Vector3<float>(-1, -1, 1), Vector3<float>(1, 1, 2)) });
+		WideBVH<8> wide_single(single);
+		float max_depth = std::numeric_limits<float>::infinity();
+		ASSERT_TRUE(wide_single.Traverse(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), Color()), max_depth,
+			[](uint32_t slot, float &current_max_depth) { current_max_depth = 1.0f; return 0 == slot; }));
+		ASSERT_FLOAT_EQ(1.0f, max_depth);
+	}
+
+	TEST(BVHTests, QuantizedBVHConservativeTest)
+	{
+		std::vector<BoundingBox> bounds = CreateRandomBounds(1000);
+		BVH binary(bounds);
+		QuantizedBVH quantized(binary);
+		WideBVH<4> wide(binary);
+
+		// Same topology as the 4 wide tree in a quarter of the space
+		ASSERT_EQ(wide.Nodes().size(), quantized.Nodes().size());
+		ASSERT_LT(quantized.MemoryBytes(), wide.MemoryBytes());
+
+		// Every decoded child box contains the exact box of the child it was collapsed from
+		for (size_t node_index = 0; node_index < quantized.Nodes().size(); node_index++)
+		{
+			const QuantizedBVH::Node &node = quantized.Nodes()[node_index];
+			const WideBVH<4>::Node &wide_node = wide.Nodes()[node_index];
+			for (size_t child = 0; child < QuantizedBVH::Width; child++)
+			{
+				ASSERT_EQ(wide_node.child[child], node.child[child]);
+				if (QuantizedBVH::EmptyChild == node.child[child])
+				{
+					continue;
+				}
+
+				BoundingBox decoded = quantized.ChildBounds(node, child);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					ASSERT_LE(decoded.min[axis], wide_node.bounds[axis][child]);
+					ASSERT_GE(decoded.max[axis], wide_node.bounds[axis + 3][child]);
+				}
+			}
+		}
+	}
+
+	TEST(BVHTests, QuantizedBVHMatchesBruteForce)
+	{
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(8);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+
+		BVHBuildOptions options;
+		options.QuantizedNodes = true;
+		BVHAccelerator accelerator(spheres, options);
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			srand(7);
+			for (int i = 0; i < 1000; i++)
+			{
+				Ray ray(Vector3<float>((float)rand() / RAND_MAX * 8, (float)rand() / RAND_MAX * 8, -2.0f),
+					Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+				Intersection expected_intersection;
+				const IIntersectable *expected_object = nullptr;
+				bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+				Intersection intersection;
+				const IIntersectable *object = nullptr;
+				ASSERT_EQ(expected, accelerator.IntersectsRay(ray, intersection, object));
+				if (expected)
+				{
+					ASSERT_EQ(expected_object, object);
+					ASSERT_FLOAT_EQ(expected_intersection.Depth(), intersection.Depth());
+				}
+			}
+
+			// The second pass runs against requantized boxes
+			for (auto &sphere : sphere_grid)
+			{
+				sphere.SetPosition(sphere.Position() + Vector3<float>(0.5f, 0.0f, 0.25f));
+			}
+
+			ASSERT_FALSE(accelerator.Update());
+		}
+	}
+
+	TEST(BVHTests, BVHBuildTest_SBVH)
+	{
+		// Long, thin triangles running diagonally through the scene overlap badly with object splits
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> faces;
+		srand(11);
+		for (size_t i = 0; i < 500; i++)
+		{
+			Vector3<float> start((float)rand() / RAND_MAX * 10, (float)rand() / RAND_MAX * 10, (float)rand() / RAND_MAX * 10);
+			vertices.emplace_back(start);
+			vertices.emplace_back(start + Vector3<float>(6.0f, 6.0f, 0.0f));
+			vertices.emplace_back(start + Vector3<float>(0.05f, 0.0f, 0.05f));
+			faces.emplace_back(3 * i, 3 * i + 1, 3 * i + 2);
+		}
+
+		BVHBuildOptions object_options;
+		object_options.Width = 2;
+		BVHBuildOptions spatial_options = object_options;
+		spatial_options.Builder = BVHBuilder::SBVH;
+		MeshGeometry object_geometry(vertices, faces, object_options);
+		MeshGeometry spatial_geometry(vertices, faces, spatial_options);
+
+		// References are duplicated within the budget and buy a cheaper tree
+		BVH::Statistics object_statistics = object_geometry.Hierarchy().ComputeStatistics();
+		BVH::Statistics spatial_statistics = spatial_geometry.Hierarchy().ComputeStatistics();
+		ASSERT_EQ(faces.size(), object_statistics.ReferenceCount);
+		ASSERT_GT(spatial_statistics.ReferenceCount, faces.size());
+		ASSERT_LE(spatial_statistics.ReferenceCount, faces.size() + (size_t)(spatial_options.SpatialSplitBudget * faces.size()));
+		ASSERT_LT(spatial_statistics.SAHCost, object_statistics.SAHCost);
+		ASSERT_LE(spatial_statistics.MaxDepth, BVH::MaxDepth);
+
+		// Every primitive is still referenced and every child fits in its parent
+		const BVH &spatial_bvh = spatial_geometry.Hierarchy();
+		std::vector<bool> referenced(faces.size(), false);
+		for (const auto &index : spatial_bvh.PrimitiveIndices())
+		{
+			referenced[index] = true;
+		}
+
+		ASSERT_EQ(std::vector<bool>(faces.size(), true), referenced);
+		for (size_t i = 0; i < spatial_bvh.Nodes().size(); i++)
+		{
+			const BVH::Node &node = spatial_bvh.Nodes()[i];
+			if (!node.IsLeaf())
+			{
+				for (const BVH::Node &child : { spatial_bvh.Nodes()[i + 1], spatial_bvh.Nodes()[node.offset] })
+				{
+					for (int axis = 0; axis < 3; axis++)
+					{
+						ASSERT_LE(node.bounds.min[axis], child.bounds.min[axis]);
+						ASSERT_GE(node.bounds.max[axis], child.bounds.max[axis]);
+					}
+				}
+			}
+		}
+
+		// Clipped child boxes must not lose any hits
+		srand(12);
+		for (int i = 0; i < 2000; i++)
+		{
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 16, (float)rand() / RAND_MAX * 16, -2.0f),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+			Intersection object_intersection;
+			Intersection spatial_intersection;
+			bool object_hit = object_geometry.IntersectsRay(ray, object_intersection);
+			ASSERT_EQ(object_hit, spatial_geometry.IntersectsRay(ray, spatial_intersection));
+			if (object_hit)
+			{
+				ASSERT_FLOAT_EQ(object_intersection.Depth(), spatial_intersection.Depth());
+			}
+		}
+	}
+
+	TEST(BVHTests, BVHAcceleratorMatchesBruteForce_SBVH)
+	{
+		// A few large spheres overlapping the grid give the builder something to split
+		std::vector<Sphere> sphere_grid = CreateSphereGrid(6);
+		sphere_grid.emplace_back(Vector3<float>(2.5f, 2.5f, 2.5f), 2.0f);
+		sphere_grid.emplace_back(Vector3<float>(0.0f, 5.0f, 2.5f), 1.5f);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_grid);
+
+		BVHBuildOptions options;
+		options.Builder = BVHBuilder::SBVH;
+		options.Width = 2;
+		BVHAccelerator accelerator(spheres, options);
+		ASSERT_GT(accelerator.Hierarchy().PrimitiveIndices().size(), spheres.size());
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			srand(13);
+			for (int i = 0; i < 1000; i++)
+			{
+				Ray ray(Vector3<float>((float)rand() / RAND_MAX * 6, (float)rand() / RAND_MAX * 6, -2.0f),
+					Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+
+				Intersection expected_intersection;
+				const IIntersectable *expected_object = nullptr;
+				bool expected = BruteForceIntersection(spheres, ray, expected_intersection, expected_object);
+
+				Intersection intersection;
+				const IIntersectable *object = nullptr;
+				ASSERT_EQ(expected, accelerator.IntersectsRay(ray, intersection, object));
+				if (expected)
+				{
+					ASSERT_EQ(expected_object, object);
+				}
+			}
+
+			// Rebuilding starts again from each object once
+			accelerator.Rebuild(options);
+			ASSERT_LE(accelerator.Hierarchy().PrimitiveIndices().size(), spheres.size() + (size_t)(options.SpatialSplitBudget * spheres.size()));
+		}
+	}
+}
@@ -2,9 +2,11 @@
 #include "gtest/gtest.h"
 #include <Camera.h>
 #include <Vector3.h>
+#include <cmath>
 
 using RayTracer::Vector3;
 using RayTracer::Camera;
+using RayTracer::Ray;
 using RayTracer::ImageResolution;
 
 namespace CameraTests
@@ -33,4 +35,40 @@ namespace CameraTests
 			ASSERT_EQ(expected[i].Z, pixels[i].CentralRayDirection().Z);
 		}
 	}
+
+	TEST(CameraTests, CameraRayTest_02)
+	{
+		ImageResolution resolution(5, 3);
+		Camera camera(resolution, Vector3<float>(1, 2, 3), Vector3<float>(0.3f, -0.2f, 1), 20, 36);
+		Camera unjittered_camera(resolution, Vector3<float>(1, 2, 3), Vector3<float>(0.3f, -0.2f, 1), 20, 36, false);
+
+		auto pixels = camera.GetOutgoingPixels();
+		const float pixel_size_m = 0.036f / 5;
+
+		for (size_t y = 0; y < 3; y++)
+		{
+			for (size_t x = 0; x < 5; x++)
+			{
+				// Without jitter the ray goes through the center of the pixel
+				Ray central_ray = camera.GetRay(x, y, 0.0f, 0.0f);
+				ASSERT_EQ(camera.Position(), central_ray.Origin());
+				ASSERT_EQ(pixels[y * 5 + x].CentralRayDirection(), central_ray.Direction());
+				ASSERT_EQ(central_ray.Direction(), unjittered_camera.GetRay(x, y, 3).Direction());
+
+				for (unsigned int sample = 0; sample < 16; sample++)
+				{
+					// The same sample always gets the same ray, within half a pixel of the center
+					Ray ray = camera.GetRay(x, y, sample);
+					ASSERT_EQ(ray.Direction(), camera.GetRay(x, y, sample).Direction());
+
+					Vector3<float> offset = ray.Direction() - central_ray.Direction();
+					ASSERT_LE(std::abs(offset.Dot(camera.RightVector())), pixel_size_m * 0.5f + 1e-6f);
+					ASSERT_LE(std::abs(offset.Dot(camera.UpVector())), pixel_size_m * 0.5f + 1e-6f);
+					ASSERT_NEAR(0.0f, offset.Dot(camera.ForwardVector()), 1e-6f);
+				}
+
+				ASSERT_NE(camera.GetRay(x, y, 0).Direction(), camera.GetRay(x, y, 1).Direction());
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "FrameBuffer.h"
+#include "Random.h"
+
+using RayTracer::FrameBuffer;
+using RayTracer::SampleStatistics;
+using RayTracer::ImageResolution;
+using RayTracer::Image;
+using RayTracer::Color;
+using RayTracer::PCG32;
+
+namespace FrameBufferTests
+{
+	TEST(FrameBufferTests, RunningStatisticsTest)
+	{
+		// Compared with the mean and variance of all the samples computed in two passes
+		PCG32 random(7);
+		std::vector<float> values[4];
+		SampleStatistics statistics;
+		for (int sample = 0; sample < 1000; sample++)
+		{
+			Color color(random.NextFloat(), random.NextFloat() * 0.5f, 0.25f, random.NextFloat() * 4.0f);
+			values[0].emplace_back(color.R_float());
+			values[1].emplace_back(color.G_float());
+			values[2].emplace_back(color.B_float());
+			values[3].emplace_back(color.A_float());
+			statistics.Add(color);
+		}
+
+		ASSERT_EQ(statistics.count, 1000u);
+		for (int channel = 0; channel < 4; channel++)
+		{
+			double mean = 0.0;
+			for (float value : values[channel])
+			{
+				mean += value;
+			}
+			mean /= values[channel].size();
+
+			double variance = 0.0;
+			for (float value : values[channel])
+			{
+				variance += (value - mean) * (value - mean);
+			}
+			variance /= values[channel].size() - 1;
+
+			ASSERT_NEAR(mean, statistics.mean[channel], 1e-4);
+			ASSERT_NEAR(variance, statistics.Variance(channel), 1e-4);
+		}
+
+		// A single sample has no spread
+		SampleStatistics single;
+		single.Add(Color(0.5f, 0.5f, 0.5f, 1.0f));
+		ASSERT_EQ(single.mean[0], 0.5f);
+		ASSERT_EQ(single.Variance(0), 0.0f);
+	}
+
+	TEST(FrameBufferTests, WriteImageTest)
+	{
+		FrameBuffer frame_buffer(ImageResolution(3, 2));
+
+		SampleStatistics dim;
+		dim.Add(Color(0.2f, 0.4f, 0.6f, 1.0f));
+		dim.Add(Color(0.4f, 0.6f, 0.8f, 1.0f));
+		frame_buffer.SetPixel(2, 1, dim);
+
+		// Over exposed samples keep their mean in the frame buffer and only clamp in the image
+		SampleStatistics bright;
+		bright.Add(Color(3.0f, 1.0f, 0.0f, 1.0f));
+		frame_buffer.SetPixel(0, 1, bright);
+
+		ASSERT_FLOAT_EQ(frame_buffer.Mean(2, 1)[0], 0.3f);
+		ASSERT_FLOAT_EQ(frame_buffer.Variance(2, 1)[1], 0.02f);
+		ASSERT_EQ(frame_buffer.Mean(0, 1)[0], 3.0f);
+
+		Image image(ImageResolution(3, 2));
+		frame_buffer.WriteImage(image);
+		const auto &rows = image.GetColorRGBAValues();
+		ASSERT_EQ(rows[1][2 * 4 + 0], (png_byte)(frame_buffer.Mean(2, 1)[0] * Color::MAX_COLOR));
+		ASSERT_EQ(rows[1][2 * 4 + 2], (png_byte)(frame_buffer.Mean(2, 1)[2] * Color::MAX_COLOR));
+		ASSERT_EQ(rows[1][0], 255);
+		ASSERT_EQ(rows[1][2], 0);
+		ASSERT_EQ(rows[0][0], 0);
+	}
+}
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "GridAccelerator.h"
+#include "Sphere.h"
+
+using RayTracer::GridAccelerator;
+using RayTracer::GridBuildOptions;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Sphere;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+
+namespace GridAcceleratorTests
+{
+	// Same layout as CreatePresetSceneSphereArray
+	static std::vector<Sphere> CreateSphereArray(size_t count_per_axis)
+	{
+		std::vector<Sphere> spheres;
+		for (size_t i = 0; i < count_per_axis; i++)
+		{
+			for (size_t j = 0; j < count_per_axis; j++)
+			{
+				spheres.emplace_back(Vector3<float>((float)i, 0.0f, (float)j), 0.4f);
+			}
+		}
+
+		return spheres;
+	}
+
+	static std::vector<const IIntersectable *> GetObjects(const std::vector<Sphere> &spheres)
+	{
+		std::vector<const IIntersectable *> objects;
+		for (const auto &sphere : spheres)
+		{
+			objects.emplace_back(&sphere);
+		}
+
+		return objects;
+	}
+
+	static bool BruteForceIntersection(const std::vector<const IIntersectable *> &objects, const Ray &ray, Intersection &out_intersection, const IIntersectable *&out_object)
+	{
+		bool intersection_found = false;
+		for (const auto &object : objects)
+		{
+			Intersection current_intersection;
+			if (object->IntersectsRay(ray, current_intersection) && current_intersection.Depth() < out_intersection.Depth())
+			{
+				out_intersection = current_intersection;
+				out_object = object;
+				intersection_found = true;
+			}
+		}
+
+		return intersection_found;
+	}
+
+	static void ExpectMatchesBruteForce(const std::vector<const IIntersectable *> &objects, const GridAccelerator &grid, const Ray &ray)
+	{
+		Intersection expected_intersection;
+		const IIntersectable *expected_object = nullptr;
+		bool expected = BruteForceIntersection(objects, ray, expected_intersection, expected_object);
+
+		Intersection intersection;
+		const IIntersectable *object = nullptr;
+		ASSERT_EQ(expected, grid.IntersectsRay(ray, intersection, object));
+		if (expected)
+		{
+			ASSERT_EQ(expected_object, object);
+			ASSERT_FLOAT_EQ(expected_intersection.Depth(), intersection.Depth());
+		}
+	}
+
+	TEST(GridAcceleratorTests, GridMatchesBruteForce)
+	{
+		std::vector<Sphere> sphere_array = CreateSphereArray(15);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_array);
+		GridAccelerator grid(spheres);
+
+		GridAccelerator::Statistics statistics = grid.ComputeStatistics();
+		ASSERT_GT(statistics.CellCount, spheres.size());
+		ASSERT_GE(statistics.ReferenceCount, spheres.size());
+		ASSERT_LT(statistics.EmptyCellCount, statistics.CellCount);
+
+		srand(31);
+		for (int i = 0; i < 2000; i++)
+		{
+			// Rays from above the array like the preset camera, and rays grazing along it from outside
+			Ray from_above(Vector3<float>((float)rand() / RAND_MAX * 16 - 1, 10.0f, (float)rand() / RAND_MAX * 16 - 1),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, -1.0f, (float)rand() / RAND_MAX - 0.5f), Color());
+			ExpectMatchesBruteForce(spheres, grid, from_above);
+
+			Ray grazing(Vector3<float>(-3.0f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX * 14),
+				Vector3<float>(1.0f, 0.0f, (float)rand() / RAND_MAX - 0.5f), Color());
+			ExpectMatchesBruteForce(spheres, grid, grazing);
+		}
+
+		// Rays starting inside the grid, in every direction
+		for (int i = 0; i < 2000; i++)
+		{
+			Ray inside(Vector3<float>((float)rand() / RAND_MAX * 14, 0.0f, (float)rand() / RAND_MAX * 14),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f), Color());
+			ExpectMatchesBruteForce(spheres, grid, inside);
+		}
+
+		// Axis aligned rays have zero direction components
+		ExpectMatchesBruteForce(spheres, grid, Ray(Vector3<float>(3.0f, 5.0f, 4.0f), Vector3<float>(0.0f, -1.0f, 0.0f), Color()));
+		ExpectMatchesBruteForce(spheres, grid, Ray(Vector3<float>(-2.0f, 0.0f, 7.0f), Vector3<float>(1.0f, 0.0f, 0.0f), Color()));
+	}
+
+	TEST(GridAcceleratorTests, GridOccludedMatchesIntersection)
+	{
+		std::vector<Sphere> sphere_array = CreateSphereArray(15);
+		std::vector<const IIntersectable *> spheres = GetObjects(sphere_array);
+		GridAccelerator grid(spheres);
+
+		srand(32);
+		for (int i = 0; i < 2000; i++)
+		{
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 14, 0.0f, (float)rand() / RAND_MAX * 14),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f), Color());
+
+			Intersection intersection;
+			const IIntersectable *object = nullptr;
+			if (!grid.IntersectsRay(ray, intersection, object))
+			{
+				ASSERT_FALSE(grid.Occluded(ray, std::numeric_limits<float>::infinity()));
+				continue;
+			}
+
+			// Depths on either side of the closest hit
+			ASSERT_TRUE(grid.Occluded(ray, intersection.Depth() * 1.01f));
+			ASSERT_FALSE(grid.Occluded(ray, intersection.Depth() * 0.99f));
+		}
+	}
+
+	TEST(GridAcceleratorTests, GridEmptyTest)
+	{
+		GridAccelerator grid({});
+		Intersection intersection;
+		const IIntersectable *object = nullptr;
+		ASSERT_FALSE(grid.IntersectsRay(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), Color()), intersection, object));
+		ASSERT_EQ(0u, grid.ComputeStatistics().CellCount);
+	}
+
+	TEST(GridAcceleratorTests, GridResolutionTest)
+	{
+		GridBuildOptions options;
+		options.MaxResolution = 8;
+		std::vector<Sphere> sphere_array = CreateSphereArray(30);
+		GridAccelerator grid(GetObjects(sphere_array), options);
+
+		// The array is flat, so the cells are spread over the two long axes
+		GridAccelerator::Statistics statistics = grid.ComputeStatistics();
+		ASSERT_EQ(8u, statistics.Resolution[0]);
+		ASSERT_EQ(8u, statistics.Resolution[2]);
+		ASSERT_LT(statistics.Resolution[1], 3u);
+	}
+
+	TEST(GridAcceleratorTests, SuitsObjectsTest)
+	{
+		// A dense array of equal spheres suits a grid
+		std::vector<Sphere> sphere_array = CreateSphereArray(15);
+		ASSERT_TRUE(GridAccelerator::SuitsObjects(GetObjects(sphere_array)));
+
+		// Too few objects to be worth it
+		std::vector<Sphere> small_array = CreateSphereArray(4);
+		ASSERT_FALSE(GridAccelerator::SuitsObjects(GetObjects(small_array)));
+
+		// One huge object would land in every cell
+		std::vector<Sphere> with_floor = CreateSphereArray(15);
+		with_floor.emplace_back(Vector3<float>(7.0f, -100.0f, 7.0f), 99.0f);
+		ASSERT_FALSE(GridAccelerator::SuitsObjects(GetObjects(with_floor)));
+
+		// Two distant clusters leave the cells between them empty
+		std::vector<Sphere> clusters;
+		for (size_t i = 0; i < 200; i++)
+		{
+			float cluster_offset = (i % 2) ? 1000.0f : 0.0f;
+			clusters.emplace_back(Vector3<float>(cluster_offset + (float)(i % 5), (float)(i / 5 % 5), (float)(i / 25)), 0.4f);
+		}
+
+		ASSERT_FALSE(GridAccelerator::SuitsObjects(GetObjects(clusters)));
+	}
+}
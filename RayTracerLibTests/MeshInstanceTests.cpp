@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+#include "Mesh.h"
+#include "MeshInstance.h"
+#include "Transform.h"
+#include "BVHAccelerator.h"
+#include "CPURenderer.h"
+#include "PresetScenes.h"
+
+using RayTracer::Mesh;
+using RayTracer::MeshGeometry;
+using RayTracer::MeshInstance;
+using RayTracer::Transform;
+using RayTracer::BVHAccelerator;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+using RayTracer::IScene;
+using RayTracer::Camera;
+using RayTracer::CPURenderer;
+using RayTracer::IImage;
+using RayTracer::ImageResolution;
+
+namespace MeshInstanceTests
+{
+	static std::shared_ptr<const MeshGeometry> CreateUnitQuad()
+	{
+		// A unit quad in the z = 0 plane centered on the origin
+		return std::make_shared<const MeshGeometry>(
+			std::vector<Vector3<float>>
+			{
+				Vector3<float>(-0.5f, -0.5f, 0.0f),
+				Vector3<float>(0.5f, -0.5f, 0.0f),
+				Vector3<float>(-0.5f, 0.5f, 0.0f),
+				Vector3<float>(0.5f, 0.5f, 0.0f),
+			},
+			std::vector<Vector3<size_t>>
+			{
+				Vector3<size_t>(0, 1, 2),
+				Vector3<size_t>(2, 1, 3)
+			});
+	}
+
+	TEST(MeshInstanceTests, TransformInverseTest_01)
+	{
+		Transform transform = Transform::Translation(Vector3<float>(1, 2, 3)) *
+			Transform::Rotation(1, 0.7f) * Transform::Scale(Vector3<float>(2, 3, 4));
+		Transform inverse = transform.Inverse();
+
+		Vector3<float> point(0.3f, -1.2f, 5.0f);
+		Vector3<float> round_trip = inverse.TransformPoint(transform.TransformPoint(point));
+
+		ASSERT_NEAR(point.X, round_trip.X, 1e-5f);
+		ASSERT_NEAR(point.Y, round_trip.Y, 1e-5f);
+		ASSERT_NEAR(point.Z, round_trip.Z, 1e-5f);
+	}
+
+	TEST(MeshInstanceTests, MeshInstanceIntersectionTest_01)
+	{
+		// Scaled by 4 and moved to z = 10
+		MeshInstance instance(nullptr, CreateUnitQuad(),
+			Transform::Translation(Vector3<float>(0, 0, 10)) * Transform::Scale(Vector3<float>(4, 4, 4)));
+
+		Intersection intersection;
+		ASSERT_TRUE(instance.IntersectsRay(Ray(Vector3<float>(1.5f, 1.5f, 0), Vector3<float>(0, 0, 1), Color()), intersection));
+		ASSERT_FLOAT_EQ(10.0f, intersection.Depth());
+		ASSERT_FLOAT_EQ(1.5f, intersection.Location().X);
+		ASSERT_FLOAT_EQ(10.0f, intersection.Location().Z);
+
+		ASSERT_FALSE(instance.IntersectsRay(Ray(Vector3<float>(2.5f, 0, 0), Vector3<float>(0, 0, 1), Color()), intersection));
+	}
+
+	TEST(MeshInstanceTests, MeshInstanceOccludedTest)
+	{
+		// Scaled by 4 and moved to z = 10, the depth limit is in world units
+		MeshInstance instance(nullptr, CreateUnitQuad(),
+			Transform::Translation(Vector3<float>(0, 0, 10)) * Transform::Scale(Vector3<float>(4, 4, 4)));
+
+		Ray ray(Vector3<float>(1.5f, 1.5f, 0), Vector3<float>(0, 0, 2), Color());
+		ASSERT_TRUE(instance.Occluded(ray, 10.1f));
+		ASSERT_FALSE(instance.Occluded(ray, 9.9f));
+		ASSERT_FALSE(instance.Occluded(Ray(Vector3<float>(2.5f, 0, 0), Vector3<float>(0, 0, 1), Color()), 20.0f));
+	}
+
+	TEST(MeshInstanceTests, MeshInstanceIntersectionTest_Rotated)
+	{
+		// Rotating a quarter turn about Y puts the quad in the x = 5 plane
+		MeshInstance instance(nullptr, CreateUnitQuad(),
+			Transform::Translation(Vector3<float>(5, 0, 0)) * Transform::Rotation(1, 3.14159265f / 2));
+
+		Intersection intersection;
+		ASSERT_TRUE(instance.IntersectsRay(Ray(Vector3<float>(0, 0.25f, 0.25f), Vector3<float>(1, 0, 0), Color()), intersection));
+		ASSERT_NEAR(5.0f, intersection.Depth(), 1e-5f);
+		ASSERT_NEAR(0.0f, intersection.Normal().Normalize().Y, 1e-5f);
+		ASSERT_NEAR(1.0f, fabs(intersection.Normal().Normalize().X), 1e-5f);
+	}
+
+	TEST(MeshInstanceTests, SharedGeometryTopLevelRebuild)
+	{
+		std::shared_ptr<const MeshGeometry> quad = CreateUnitQuad();
+		MeshInstance near_instance(nullptr, quad, Transform::Translation(Vector3<float>(0, 0, 2)));
+		MeshInstance far_instance(nullptr, quad, Transform::Translation(Vector3<float>(0, 0, 4)));
+
+		BVHAccelerator accelerator({ &near_instance, &far_instance });
+
+		Ray ray(Vector3<float>(0.1f, 0.1f, 0), Vector3<float>(0, 0, 1), Color());
+		Intersection intersection;
+		const IIntersectable *object = nullptr;
+
+		ASSERT_TRUE(accelerator.IntersectsRay(ray, intersection, object));
+		ASSERT_EQ(&near_instance, object);
+
+		// Move the near instance behind the far one and only rebuild the top level
+		near_instance.SetTransform(Transform::Translation(Vector3<float>(0, 0, 6)));
+		accelerator.Rebuild();
+
+		ASSERT_TRUE(accelerator.IntersectsRay(ray, intersection, object));
+		ASSERT_EQ(&far_instance, object);
+		ASSERT_FLOAT_EQ(4.0f, intersection.Depth());
+	}
+
+	TEST(MeshInstanceTests, InstancedCubesPresetSceneTest)
+	{
+		IScene *scene = nullptr;
+		Camera *camera = nullptr;
+		RayTracer::CreatePresetSceneInstancedCubes(scene, camera, ImageResolution(16, 12));
+
+		// Every cube instances one geometry, the light is the only other object
+		const MeshInstance *first_instance = dynamic_cast<const MeshInstance *>(scene->Objects()[0]);
+		ASSERT_NE(nullptr, first_instance);
+		size_t instance_count = 0;
+		for (const auto &object : scene->Objects())
+		{
+			if (const MeshInstance *instance = dynamic_cast<const MeshInstance *>(object))
+			{
+				ASSERT_EQ(&first_instance->Geometry(), &instance->Geometry());
+				instance_count++;
+			}
+		}
+		ASSERT_EQ(400u, instance_count);
+		ASSERT_EQ(401u, scene->Objects().size());
+
+		// The camera looks down into the middle of the cubes
+		BVHAccelerator accelerator(scene->Objects());
+		Intersection intersection;
+		const IIntersectable *object = nullptr;
+		ASSERT_TRUE(accelerator.IntersectsRay(Ray(camera->Position(), camera->ForwardVector(), Color()), intersection, object));
+		ASSERT_NE(nullptr, dynamic_cast<const MeshInstance *>(object));
+
+		std::shared_ptr<IImage> image;
+		CPURenderer::CPURendererParameters parameters(*camera, *scene);
+		parameters.max_threads = 1;
+		CPURenderer().Render(parameters, image);
+		ASSERT_EQ(12u, image->GetColorRGBAValues().size());
+		ASSERT_EQ(16u * 4, image->GetColorRGBAValues()[0].size());
+	}
+}
@@ -6,6 +6,8 @@
 #include "Color.h"
 
 using RayTracer::Mesh;
+using RayTracer::MeshGeometry;
+using RayTracer::BVHBuildOptions;
 using RayTracer::Intersection;
 using RayTracer::Vector3;
 using RayTracer::Ray;
@@ -76,5 +78,162 @@ namespace MeshTests
 		ASSERT_TRUE(intersects);
 		ASSERT_FLOAT_EQ(intersection.Depth(), 1.0f);
 	}
-}
 
+	TEST(MeshTests, MeshIntersectionTest_TessellatedPlane)
+	{
+		// A 64x64 grid of quads in the z = 2 plane, covering [0, 64] x [0, 64]
+		const size_t grid_size = 64;
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> indices;
+		for (size_t y = 0; y <= grid_size; y++)
+		{
+			for (size_t x = 0; x <= grid_size; x++)
+			{
+				vertices.emplace_back(Vector3<float>((float)x, (float)y, 2.0f));
+			}
+		}
+
+		for (size_t y = 0; y < grid_size; y++)
+		{
+			for (size_t x = 0; x < grid_size; x++)
+			{
+				size_t bottom_left = y * (grid_size + 1) + x;
+				size_t top_left = bottom_left + grid_size + 1;
+				indices.emplace_back(Vector3<size_t>(bottom_left, bottom_left + 1, top_left));
+				indices.emplace_back(Vector3<size_t>(top_left, bottom_left + 1, top_left + 1));
+			}
+		}
+
+		Mesh mesh(std::shared_ptr<RayTracer::IMaterial>(nullptr), vertices, indices);
+
+		for (float y = 0.3f; y < grid_size; y += 1.7f)
+		{
+			for (float x = 0.6f; x < grid_size; x += 2.3f)
+			{
+				Ray ray(Vector3<float>(x, y, 0.0f), Vector3<float>(0.0f, 0.0f, 1.0f), Color());
+				Intersection intersection;
+
+				ASSERT_TRUE(mesh.IntersectsRay(ray, intersection));
+				ASSERT_FLOAT_EQ(intersection.Depth(), 2.0f);
+				ASSERT_FLOAT_EQ(intersection.Location().X, x);
+				ASSERT_FLOAT_EQ(intersection.Location().Y, y);
+			}
+		}
+
+		Ray missing_ray(Vector3<float>(-0.5f, 10.0f, 0.0f), Vector3<float>(0.0f, 0.0f, 1.0f), Color());
+		Intersection intersection;
+		ASSERT_FALSE(mesh.IntersectsRay(missing_ray, intersection));
+	}
+
+	TEST(MeshTests, WatertightSharedEdgeTest)
+	{
+		// A tilted, jittered 32x32 grid of quads, so the edge points below are not exactly representable
+		// and Moller-Trumbore rounds some of them outside both of their triangles
+		srand(19);
+		const size_t grid_size = 32;
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> indices;
+		for (size_t y = 0; y <= grid_size; y++)
+		{
+			for (size_t x = 0; x <= grid_size; x++)
+			{
+				float jittered_x = (float)x + ((float)rand() / RAND_MAX - 0.5f) * 0.3f;
+				float jittered_y = (float)y + ((float)rand() / RAND_MAX - 0.5f) * 0.3f;
+				vertices.emplace_back(Vector3<float>(jittered_x, jittered_y, 5.0f + 0.37f * jittered_x + 0.21f * jittered_y));
+			}
+		}
+
+		for (size_t y = 0; y < grid_size; y++)
+		{
+			for (size_t x = 0; x < grid_size; x++)
+			{
+				size_t bottom_left = y * (grid_size + 1) + x;
+				size_t top_left = bottom_left + grid_size + 1;
+				indices.emplace_back(Vector3<size_t>(bottom_left, bottom_left + 1, top_left));
+				indices.emplace_back(Vector3<size_t>(top_left, bottom_left + 1, top_left + 1));
+			}
+		}
+
+		BVHBuildOptions options;
+		options.WatertightTriangles = true;
+		MeshGeometry geometry(vertices, indices, options);
+
+		// Points on edges and vertices away from the border: the diagonal of each quad and the edges
+		// between neighboring quads
+		std::vector<std::pair<size_t, size_t>> shared_edges;
+		for (size_t y = 1; y < grid_size - 1; y++)
+		{
+			for (size_t x = 1; x < grid_size - 1; x++)
+			{
+				size_t bottom_left = y * (grid_size + 1) + x;
+				shared_edges.emplace_back(bottom_left + 1, bottom_left + grid_size + 1);
+				shared_edges.emplace_back(bottom_left, bottom_left + 1);
+				shared_edges.emplace_back(bottom_left, bottom_left + grid_size + 1);
+			}
+		}
+
+		for (const auto &edge : shared_edges)
+		{
+			for (float along_edge : { 0.0f, 0.25f, 0.5f, 0.77f })
+			{
+				Vector3<float> target = vertices[edge.first] + (vertices[edge.second] - vertices[edge.first]) * along_edge;
+				Vector3<float> origin(target.X * 0.5f + 3.0f, target.Y * 0.5f - 2.0f, -10.0f);
+				Ray ray(origin, target - origin, Color());
+
+				Intersection intersection;
+				ASSERT_TRUE(geometry.IntersectsRay(ray, intersection));
+				ASSERT_NEAR(sqrt((target - origin).MagnitudeSquared()), intersection.Depth(), 1e-3f);
+			}
+		}
+	}
+
+	TEST(MeshTests, MeshGeometryUpdateVerticesTest)
+	{
+		// A 16x16 grid of quads in the z = 2 plane that is then bent into a ramp
+		const size_t grid_size = 16;
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> indices;
+		for (size_t y = 0; y <= grid_size; y++)
+		{
+			for (size_t x = 0; x <= grid_size; x++)
+			{
+				vertices.emplace_back(Vector3<float>((float)x, (float)y, 2.0f));
+			}
+		}
+
+		for (size_t y = 0; y < grid_size; y++)
+		{
+			for (size_t x = 0; x < grid_size; x++)
+			{
+				size_t bottom_left = y * (grid_size + 1) + x;
+				size_t top_left = bottom_left + grid_size + 1;
+				indices.emplace_back(Vector3<size_t>(bottom_left, bottom_left + 1, top_left));
+				indices.emplace_back(Vector3<size_t>(top_left, bottom_left + 1, top_left + 1));
+			}
+		}
+
+		std::shared_ptr<MeshGeometry> geometry = std::make_shared<MeshGeometry>(vertices, indices);
+		Mesh mesh(std::shared_ptr<RayTracer::IMaterial>(nullptr), geometry);
+
+		for (auto &vertex : vertices)
+		{
+			vertex.Z = 2.0f + vertex.X;
+		}
+
+		// Raising every vertex keeps the tree shape reasonable, so it is refit rather than rebuilt
+		ASSERT_FALSE(geometry->UpdateVertices(vertices));
+		ASSERT_FLOAT_EQ(18.0f, mesh.Bounds().max[2]);
+
+		for (float y = 0.3f; y < grid_size; y += 1.7f)
+		{
+			for (float x = 0.6f; x < grid_size; x += 2.3f)
+			{
+				Intersection intersection;
+				ASSERT_TRUE(mesh.IntersectsRay(Ray(Vector3<float>(x, y, 0.0f), Vector3<float>(0.0f, 0.0f, 1.0f), Color()), intersection));
+				ASSERT_NEAR(2.0f + x, intersection.Depth(), 1e-4f);
+			}
+		}
+
+		ASSERT_THROW(geometry->UpdateVertices({ Vector3<float>(0, 0, 0) }), std::exception);
+	}
+}
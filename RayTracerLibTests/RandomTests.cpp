@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include "Random.h"
+
+#include <set>
+
+using RayTracer::PCG32;
+
+namespace RandomTests
+{
+	TEST(RandomTests, ReferenceSequenceTest)
+	{
+		// First outputs of the reference implementation's demo, seeded with 42 on stream 54
+		PCG32 random(42, 54);
+		const uint32_t expected[6] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+		for (uint32_t value : expected)
+		{
+			ASSERT_EQ(value, random.NextUInt());
+		}
+	}
+
+	TEST(RandomTests, PathGeneratorsTest)
+	{
+		// The same pixel, sample and bounce always draw the same numbers, changing any of them starts another sequence
+		std::set<uint32_t> first_draws;
+		for (uint32_t pixel_index = 0; pixel_index < 4; pixel_index++)
+		{
+			for (uint32_t sample = 0; sample < 4; sample++)
+			{
+				for (uint32_t bounce = 0; bounce < 4; bounce++)
+				{
+					PCG32 random = PCG32::ForPath(pixel_index, sample, bounce);
+					PCG32 same_random = PCG32::ForPath(pixel_index, sample, bounce);
+					const uint32_t first_draw = random.NextUInt();
+					ASSERT_EQ(first_draw, same_random.NextUInt());
+					first_draws.insert(first_draw);
+
+					for (int i = 0; i < 100; i++)
+					{
+						const float value = random.NextFloat();
+						ASSERT_GE(value, 0.0f);
+						ASSERT_LT(value, 1.0f);
+					}
+				}
+			}
+		}
+
+		ASSERT_EQ(first_draws.size(), 4u * 4u * 4u);
+	}
+}
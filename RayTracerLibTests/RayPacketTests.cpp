@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+#include "RayPacket.h"
+#include "BVHAccelerator.h"
+#include "GridAccelerator.h"
+#include "Camera.h"
+#include "Sphere.h"
+#include "Mesh.h"
+
+using RayTracer::RayPacket;
+using RayTracer::BVHAccelerator;
+using RayTracer::GridAccelerator;
+using RayTracer::IAccelerationStructure;
+using RayTracer::BoundingBox;
+using RayTracer::Camera;
+using RayTracer::ImageResolution;
+using RayTracer::Pixel;
+using RayTracer::PCG32;
+using RayTracer::Sphere;
+using RayTracer::Mesh;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+
+namespace RayPacketTests
+{
+	TEST(RayPacketTests, IntervalTestIsConservative)
+	{
+		srand(61);
+		for (int i = 0; i < 500; i++)
+		{
+			RayPacket packet;
+			// Far enough from the axes that the jitter never flips a direction sign
+			auto component = []() { return (rand() % 2 ? 1.0f : -1.0f) * (0.1f + (float)rand() / RAND_MAX * 0.4f); };
+			Vector3<float> base_direction(component(), component(), 1.0f);
+			for (size_t ray = 0; ray < RayPacket::MaxSize; ray++)
+			{
+				Vector3<float> origin((float)rand() / RAND_MAX * 0.2f, (float)rand() / RAND_MAX * 0.2f, -5.0f);
+				Vector3<float> jitter((float)rand() / RAND_MAX * 0.05f, (float)rand() / RAND_MAX * 0.05f, 0.0f);
+				packet.Add(Ray(origin, base_direction + jitter, Color()));
+			}
+
+			Vector3<float> corner((float)rand() / RAND_MAX * 6 - 3, (float)rand() / RAND_MAX * 6 - 3, (float)rand() / RAND_MAX * 6 - 3);
+			BoundingBox box(corner, corner + Vector3<float>(0.5f, 0.5f, 0.5f));
+			const float max_depth = (float)rand() / RAND_MAX * 10;
+
+			bool any_ray_hits = false;
+			float first_entry_depth = std::numeric_limits<float>::infinity();
+			for (size_t ray = 0; ray < packet.Size(); ray++)
+			{
+				float entry_depth = 0.0f;
+				if (packet.RayIntersectsBox(ray, box, max_depth, entry_depth))
+				{
+					any_ray_hits = true;
+					first_entry_depth = std::min(first_entry_depth, entry_depth);
+				}
+			}
+
+			ASSERT_TRUE(packet.Coherent());
+			float packet_entry_depth = 0.0f;
+			bool packet_hits = packet.IntersectsBox(box, max_depth, packet_entry_depth);
+			if (any_ray_hits)
+			{
+				ASSERT_TRUE(packet_hits);
+				ASSERT_LE(packet_entry_depth, first_entry_depth);
+			}
+		}
+	}
+
+	TEST(RayPacketTests, CoherenceTest)
+	{
+		RayPacket packet;
+		packet.Add(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0.1f, 0.1f, 1.0f), Color()));
+		packet.Add(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0.2f, 0.1f, 1.0f), Color()));
+		ASSERT_TRUE(packet.Coherent());
+
+		// Straddling an axis flips the direction sign
+		packet.Add(Ray(Vector3<float>(0, 0, 0), Vector3<float>(-0.1f, 0.1f, 1.0f), Color()));
+		ASSERT_FALSE(packet.Coherent());
+
+		// Zero direction components have no finite inverse
+		RayPacket axis_aligned;
+		axis_aligned.Add(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), Color()));
+		ASSERT_FALSE(axis_aligned.Coherent());
+
+		ASSERT_FALSE(RayPacket().Coherent());
+	}
+
+	static void ExpectPacketMatchesRays(const IAccelerationStructure &accelerator, const RayPacket &packet)
+	{
+		Intersection intersections[RayPacket::MaxSize];
+		const IIntersectable *objects[RayPacket::MaxSize];
+		accelerator.IntersectsPacket(packet, intersections, objects);
+
+		for (size_t ray = 0; ray < packet.Size(); ray++)
+		{
+			Intersection expected_intersection;
+			const IIntersectable *expected_object = nullptr;
+			if (!accelerator.IntersectsRay(packet[ray], expected_intersection, expected_object))
+			{
+				expected_object = nullptr;
+			}
+
+			ASSERT_EQ(expected_object, objects[ray]);
+			if (nullptr != expected_object)
+			{
+				ASSERT_FLOAT_EQ(expected_intersection.Depth(), intersections[ray].Depth());
+				ASSERT_FLOAT_EQ(expected_intersection.Normal().X, intersections[ray].Normal().X);
+			}
+		}
+	}
+
+	TEST(RayPacketTests, PacketMatchesSingleRays)
+	{
+		std::vector<Sphere> spheres;
+		for (size_t i = 0; i < 10; i++)
+		{
+			for (size_t j = 0; j < 10; j++)
+			{
+				spheres.emplace_back(Vector3<float>((float)i - 4.5f, (float)j - 4.5f, 10.0f + (float)((i * j) % 3)), 0.45f);
+			}
+		}
+
+		Mesh mesh(nullptr, { Vector3<float>(-6, -6, 11), Vector3<float>(6, -6, 11), Vector3<float>(-6, 6, 11) }, { Vector3<size_t>(0, 1, 2) });
+		std::vector<const IIntersectable *> objects = { &mesh };
+		for (const auto &sphere : spheres)
+		{
+			objects.emplace_back(&sphere);
+		}
+
+		BVHAccelerator bvh_accelerator(objects);
+		GridAccelerator grid_accelerator(objects);
+
+		// Every 8x8 tile of a camera looking at the objects, including the tiles around the view axis
+		// whose rays are not coherent
+		PCG32 random(62);
+		Camera camera(ImageResolution(64, 48), Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), 20.0f, 36.0f);
+		std::vector<Pixel> pixels = camera.GetOutgoingPixels();
+		for (size_t tile_y = 0; tile_y < 48; tile_y += 8)
+		{
+			for (size_t tile_x = 0; tile_x < 64; tile_x += 8)
+			{
+				RayPacket packet;
+				for (size_t y = tile_y; y < tile_y + 8; y++)
+				{
+					for (size_t x = tile_x; x < tile_x + 8; x++)
+					{
+						packet.Add(pixels[y * 64 + x].GetNextRay(random));
+					}
+				}
+
+				ExpectPacketMatchesRays(bvh_accelerator, packet);
+				ExpectPacketMatchesRays(grid_accelerator, packet);
+			}
+		}
+	}
+}
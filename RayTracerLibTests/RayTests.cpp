@@ -0,0 +1,38 @@
+#include "gtest/gtest.h"
+#include "Ray.h"
+
+using RayTracer::Ray;
+using RayTracer::Vector3;
+using RayTracer::Color;
+
+namespace RayTests
+{
+	TEST(RayTests, PrecomputedDirectionTest)
+	{
+		Ray ray(Vector3<float>(1, 2, 3), Vector3<float>(2, -6, 3), Color());
+
+		const Vector3<float> &direction = ray.NormalizedDirection();
+		ASSERT_FLOAT_EQ(direction.X, 2.0f / 7.0f);
+		ASSERT_FLOAT_EQ(direction.Y, -6.0f / 7.0f);
+		ASSERT_FLOAT_EQ(direction.Z, 3.0f / 7.0f);
+		ASSERT_FLOAT_EQ(ray.InverseDirection()[0], 7.0f / 2.0f);
+		ASSERT_FLOAT_EQ(ray.InverseDirection()[1], -7.0f / 6.0f);
+		ASSERT_FLOAT_EQ(ray.InverseDirection()[2], 7.0f / 3.0f);
+		ASSERT_EQ(ray.Octant(), 2u);
+		ASSERT_EQ(ray.DominantAxis(), 1u);
+
+		// Copies keep the color and the precomputed values, a new direction replaces them
+		ray.SetColor(Color(0.25f, 0.5f, 0.75f, 1.0f));
+		Ray copy(ray);
+		ASSERT_EQ(copy.RayColor().G_float(), 0.5f);
+		ASSERT_EQ(copy.Octant(), 2u);
+		ASSERT_FLOAT_EQ(copy.InverseDirection()[1], -7.0f / 6.0f);
+
+		copy.SetDirection(Vector3<float>(-4, 0, -4));
+		ASSERT_FLOAT_EQ(copy.NormalizedDirection().X, -std::sqrt(0.5f));
+		ASSERT_EQ(copy.InverseDirection()[1], std::numeric_limits<float>::infinity());
+		ASSERT_EQ(copy.Octant(), 5u);
+		// Ties go to the first axis
+		ASSERT_EQ(copy.DominantAxis(), 0u);
+	}
+}
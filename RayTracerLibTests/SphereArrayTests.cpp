@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "SphereArray.h"
+#include "Sphere.h"
+#include "Mesh.h"
+
+using RayTracer::SphereArray;
+using RayTracer::Sphere;
+using RayTracer::Mesh;
+using RayTracer::IIntersectable;
+using RayTracer::Intersection;
+using RayTracer::Vector3;
+using RayTracer::Ray;
+using RayTracer::Color;
+
+namespace SphereArrayTests
+{
+	TEST(SphereArrayTests, BatchMatchesSphere)
+	{
+		srand(51);
+		std::vector<Sphere> spheres;
+		for (size_t i = 0; i < 37; i++)
+		{
+			spheres.emplace_back(Vector3<float>((float)rand() / RAND_MAX * 4 - 2, (float)rand() / RAND_MAX * 4 - 2, (float)rand() / RAND_MAX * 6 + 1),
+				(float)rand() / RAND_MAX * 0.8f + 0.1f);
+		}
+
+		// Objects that are not spheres keep their entry but are never hit by the batch
+		Mesh mesh(nullptr, { Vector3<float>(-5, -5, 2), Vector3<float>(5, -5, 2), Vector3<float>(-5, 5, 2) }, { Vector3<size_t>(0, 1, 2) });
+		std::vector<const IIntersectable *> objects;
+		for (size_t i = 0; i < spheres.size(); i++)
+		{
+			objects.emplace_back(&spheres[i]);
+			if (i % 10 == 3)
+			{
+				objects.emplace_back(&mesh);
+			}
+		}
+
+		SphereArray sphere_array(objects);
+		ASSERT_EQ(spheres.size(), sphere_array.SphereCount());
+		ASSERT_FALSE(sphere_array.IsSphere(4));
+
+		for (int i = 0; i < 1000; i++)
+		{
+			// Some rays start inside a sphere, those only see the spheres around it
+			Ray ray(Vector3<float>((float)rand() / RAND_MAX * 4 - 2, (float)rand() / RAND_MAX * 4 - 2, (float)rand() / RAND_MAX * 3),
+				Vector3<float>((float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 1.0f), Color());
+			const Vector3<float> direction_vector = ray.Direction().Normalize();
+			const float origin[3] = { ray.Origin().X, ray.Origin().Y, ray.Origin().Z };
+			const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+			const uint32_t first_index = rand() % objects.size();
+			const uint32_t count = rand() % (objects.size() - first_index) + 1;
+
+			Intersection expected_intersection;
+			int64_t expected_index = -1;
+			for (uint32_t index = first_index; index < first_index + count; index++)
+			{
+				Intersection current_intersection;
+				if (&mesh != objects[index] && objects[index]->IntersectsRay(ray, current_intersection) && current_intersection.Depth() < expected_intersection.Depth())
+				{
+					expected_intersection = current_intersection;
+					expected_index = index;
+				}
+			}
+
+			float max_depth = std::numeric_limits<float>::infinity();
+			uint32_t index = 0;
+			ASSERT_EQ(expected_index >= 0, sphere_array.IntersectsRay(origin, direction, first_index, count, max_depth, index));
+			if (expected_index >= 0)
+			{
+				ASSERT_EQ(expected_index, index);
+				ASSERT_FLOAT_EQ(expected_intersection.Depth(), max_depth);
+
+				Intersection intersection = sphere_array.SurfaceIntersection(index, ray.Origin(), direction_vector, max_depth);
+				ASSERT_FLOAT_EQ(expected_intersection.Location().X, intersection.Location().X);
+				ASSERT_FLOAT_EQ(expected_intersection.Location().Z, intersection.Location().Z);
+				ASSERT_FLOAT_EQ(expected_intersection.Normal().Y, intersection.Normal().Y);
+			}
+		}
+	}
+
+	TEST(SphereArrayTests, EmptyTest)
+	{
+		SphereArray sphere_array(std::vector<const IIntersectable *>{});
+		ASSERT_EQ(0u, sphere_array.SphereCount());
+
+		const float origin[3] = { 0.0f, 0.0f, 0.0f };
+		const float direction[3] = { 0.0f, 0.0f, 1.0f };
+		float max_depth = std::numeric_limits<float>::infinity();
+		uint32_t index = 0;
+		ASSERT_FALSE(sphere_array.IntersectsRay(origin, direction, 0, 0, max_depth, index));
+	}
+}
@@ -64,4 +64,33 @@ namespace SphereTests
 		bool intersects = sphere.IntersectsRay(ray, intersection);
 		ASSERT_EQ(false, intersects);
 	}
+
+	TEST(SphereTests, SphereOccludedTest) {
+
+		Sphere sphere(Vector3<float>(0, 0, 0), 1);
+		Ray ray = Ray(Vector3<float>(-3, 0, 0), Vector3<float>(2, 0, 0), Color());
+
+		// The hit is at depth 2 along the normalized direction
+		ASSERT_TRUE(sphere.Occluded(ray, 2.1f));
+		ASSERT_FALSE(sphere.Occluded(ray, 1.9f));
+
+		// Backface, nothing occludes
+		ASSERT_FALSE(sphere.Occluded(Ray(Vector3<float>(0, 0, 0), Vector3<float>(0, 1, 0), Color()), 10.0f));
+	}
+
+	TEST(SphereTests, SphereMaxDepthTest) {
+
+		Sphere sphere(Vector3<float>(0, 0, 0), 1);
+		Ray ray = Ray(Vector3<float>(-3, 0, 0), Vector3<float>(2, 0, 0), Color());
+		Intersection intersection;
+
+		// The hit is at depth 2, the limit is inclusive
+		ray.SetMaxDepth(2.0f);
+		ASSERT_TRUE(sphere.IntersectsRay(ray, intersection));
+		ASSERT_FLOAT_EQ(2.0f, intersection.Depth());
+		ASSERT_FLOAT_EQ(2.0f, ray.MaxDepth());
+
+		ray.SetMaxDepth(1.9f);
+		ASSERT_FALSE(sphere.IntersectsRay(ray, intersection));
+	}
 }
\ No newline at end of file
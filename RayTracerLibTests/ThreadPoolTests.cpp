@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "ThreadPool.h"
+#include "ElapsedTimer.h"
+
+#include <functional>
+
+using RayTracer::ThreadPool;
+using RayTracer::ElapsedTimer;
+
+namespace ThreadPoolTests
+{
+	class FunctionTask : public ThreadPool::IThreadPoolTask
+	{
+	public:
+		FunctionTask(std::function<void()> &&work) : work(std::move(work)) {}
+
+		void Execute() override
+		{
+			work();
+		}
+
+	private:
+		std::function<void()> work;
+	};
+
+	TEST(ThreadPoolTests, RunsEveryTaskTest)
+	{
+		// A queue much smaller than the task count, so EnqueueTask has to wait for the workers
+		ThreadPool pool(4, 16);
+		std::atomic<size_t> executed(0);
+		std::atomic<size_t> sum(0);
+
+		for (size_t round = 0; round < 3; round++)
+		{
+			executed = 0;
+			sum = 0;
+			for (size_t i = 0; i < 2000; i++)
+			{
+				pool.EnqueueTask(std::make_shared<FunctionTask>([&executed, &sum, i]()
+					{
+						sum += i;
+						executed++;
+					}));
+			}
+
+			pool.BlockUntilComplete();
+			ASSERT_EQ(executed, 2000u);
+			ASSERT_EQ(sum, 2000u * 1999u / 2);
+		}
+	}
+
+	TEST(ThreadPoolTests, TasksEnqueuedFromTasksTest)
+	{
+		// Each task enqueues two children until the tree is 10 levels deep, the children go to the
+		// worker's own deque and are stolen from there by the others
+		ThreadPool pool(4, 4096);
+		std::atomic<size_t> executed(0);
+
+		std::function<void(size_t)> spawn = [&](size_t level)
+		{
+			executed++;
+			if (level < 10)
+			{
+				pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn, level]() { spawn(level + 1); }));
+				pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn, level]() { spawn(level + 1); }));
+			}
+		};
+
+		pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn]() { spawn(0); }));
+		pool.BlockUntilComplete();
+
+		ASSERT_EQ(executed, (1u << 11) - 1);
+	}
+
+	TEST(ThreadPoolTests, TasksEnqueuedFromTasksOverflowQueueTest)
+	{
+		// The same tree of 2047 tasks through a queue of 4, every worker enqueues while the queue is full
+		ThreadPool pool(4, 4);
+		std::atomic<size_t> executed(0);
+
+		std::function<void(size_t)> spawn = [&](size_t level)
+		{
+			executed++;
+			if (level < 10)
+			{
+				pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn, level]() { spawn(level + 1); }));
+				pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn, level]() { spawn(level + 1); }));
+			}
+		};
+
+		pool.EnqueueTask(std::make_shared<FunctionTask>([&spawn]() { spawn(0); }));
+		pool.BlockUntilComplete();
+
+		ASSERT_EQ(executed, (1u << 11) - 1);
+	}
+
+	TEST(ThreadPoolTests, BlockUntilCompleteReturnsPromptlyTest)
+	{
+		// The workers park while idle and are woken by new tasks, so small batches do not wait out any
+		// polling interval
+		ThreadPool pool(4, 1000);
+		std::atomic<size_t> executed(0);
+
+		ElapsedTimer timer;
+		for (size_t round = 0; round < 200; round++)
+		{
+			pool.EnqueueTask(std::make_shared<FunctionTask>([&executed]() { executed++; }));
+			pool.BlockUntilComplete();
+		}
+
+		ASSERT_EQ(executed, 200u);
+		ASSERT_LT(timer.Poll().count(), 1000.0);
+	}
+
+	TEST(ThreadPoolTests, BlockUntilCompleteWithoutTasksTest)
+	{
+		ThreadPool pool(2, 10);
+		pool.BlockUntilComplete();
+	}
+}
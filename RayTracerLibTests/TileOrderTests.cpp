@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "TileOrder.h"
+
+using RayTracer::TileOrder;
+using RayTracer::ImageTile;
+using RayTracer::OrderTiles;
+
+namespace TileOrderTests
+{
+	TEST(TileOrderTests, EveryPixelOnceTest)
+	{
+		// Partial tiles on the right and at the bottom
+		const size_t resolution_x = 100;
+		const size_t resolution_y = 37;
+		for (TileOrder order : { TileOrder::Scanline, TileOrder::Spiral, TileOrder::Hilbert })
+		{
+			std::vector<int> coverage(resolution_x * resolution_y, 0);
+			std::vector<ImageTile> tiles = OrderTiles(resolution_x, resolution_y, 16, order);
+			ASSERT_EQ(tiles.size(), 7u * 3u);
+
+			for (const ImageTile &tile : tiles)
+			{
+				ASSERT_LE(tile.x + tile.width, resolution_x);
+				ASSERT_LE(tile.y + tile.height, resolution_y);
+				for (size_t y = tile.y; y < tile.y + tile.height; y++)
+				{
+					for (size_t x = tile.x; x < tile.x + tile.width; x++)
+					{
+						coverage[y * resolution_x + x]++;
+					}
+				}
+			}
+
+			for (int count : coverage)
+			{
+				ASSERT_EQ(count, 1);
+			}
+		}
+	}
+
+	TEST(TileOrderTests, OrderShapesTest)
+	{
+		std::vector<ImageTile> scanline = OrderTiles(64, 64, 8, TileOrder::Scanline);
+		ASSERT_EQ(scanline[1].x, 8u);
+		ASSERT_EQ(scanline[1].y, 0u);
+		ASSERT_EQ(scanline[8].x, 0u);
+		ASSERT_EQ(scanline[8].y, 8u);
+
+		// The spiral starts at the center and moves outward, never farther than the next ring
+		std::vector<ImageTile> spiral = OrderTiles(72, 72, 8, TileOrder::Spiral);
+		ASSERT_EQ(spiral[0].x, 32u);
+		ASSERT_EQ(spiral[0].y, 32u);
+		size_t previous_ring = 0;
+		for (const ImageTile &tile : spiral)
+		{
+			const size_t ring = std::max(std::max(tile.x, (size_t)32) - std::min(tile.x, (size_t)32), std::max(tile.y, (size_t)32) - std::min(tile.y, (size_t)32)) / 8;
+			ASSERT_GE(ring, previous_ring);
+			ASSERT_LE(ring, previous_ring + 1);
+			previous_ring = ring;
+		}
+
+		// On a power of two grid consecutive Hilbert tiles share an edge
+		std::vector<ImageTile> hilbert = OrderTiles(64, 64, 8, TileOrder::Hilbert);
+		ASSERT_EQ(hilbert[0].x, 0u);
+		ASSERT_EQ(hilbert[0].y, 0u);
+		for (size_t i = 1; i < hilbert.size(); i++)
+		{
+			const size_t distance = std::max(hilbert[i].x, hilbert[i - 1].x) - std::min(hilbert[i].x, hilbert[i - 1].x) +
+				std::max(hilbert[i].y, hilbert[i - 1].y) - std::min(hilbert[i].y, hilbert[i - 1].y);
+			ASSERT_EQ(distance, 8u);
+		}
+	}
+}
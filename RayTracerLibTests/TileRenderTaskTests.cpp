@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "TileRenderTask.h"
+#include "PixelRenderTask.h"
+#include "BVHAccelerator.h"
+#include "FrameBuffer.h"
+#include "Camera.h"
+#include "Sphere.h"
+#include "GlossyBSDF.h"
+#include "EmissiveBSDF.h"
+#include "DiffuseBSDF.h"
+#include "WavefrontRenderTask.h"
+#include "ThreadPool.h"
+
+using RayTracer::TileRenderTask;
+using RayTracer::PixelRenderTask;
+using RayTracer::WavefrontRenderTask;
+using RayTracer::ThreadPool;
+using RayTracer::BVHAccelerator;
+using RayTracer::FrameBuffer;
+using RayTracer::ImageResolution;
+using RayTracer::ImageTile;
+using RayTracer::TileOrder;
+using RayTracer::Camera;
+using RayTracer::Scene;
+using RayTracer::Sphere;
+using RayTracer::GlossyBSDF;
+using RayTracer::EmissiveBSDF;
+using RayTracer::DiffuseBSDF;
+using RayTracer::IMaterial;
+using RayTracer::Vector3;
+using RayTracer::Color;
+
+namespace TileRenderTaskTests
+{
+	TEST(TileRenderTaskTests, MatchesPixelRenderTask)
+	{
+		// Mirrors and lights only, so every path is deterministic
+		std::shared_ptr<const IMaterial> mirror = std::make_shared<GlossyBSDF>(Color(0.9f, 0.8f, 0.7f, 1.0f), 0.0f);
+		std::shared_ptr<const IMaterial> light = std::make_shared<EmissiveBSDF>(Color(1.0f, 0.5f, 0.25f, 1.0f), 2.0f);
+		Sphere front_mirror(Vector3<float>(0, 0, 1010), 1000.0f, mirror);
+		Sphere back_mirror(Vector3<float>(0, 0, -1010), 1000.0f, mirror);
+		Sphere lamp(Vector3<float>(3, 2, 5), 1.5f, light);
+
+		Scene scene;
+		scene.AddObject(&front_mirror);
+		scene.AddObject(&back_mirror);
+		scene.AddObject(&lamp);
+		BVHAccelerator accelerator(scene.Objects());
+
+		// A camera without jitter. The tiles are not a multiple of the packet blocks and the ones at the edges
+		// are partial.
+		const size_t resolution_x = 23;
+		const size_t resolution_y = 17;
+		Camera camera(ImageResolution(resolution_x, resolution_y), Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), 20.0f, 36.0f, false);
+
+		FrameBuffer pixel_frame(ImageResolution(resolution_x, resolution_y));
+		for (size_t y = 0; y < resolution_y; y++)
+		{
+			for (size_t x = 0; x < resolution_x; x++)
+			{
+				PixelRenderTask(camera, x, y, 2, scene, accelerator, pixel_frame).Execute();
+			}
+		}
+
+		for (bool packet_tracing : { true, false })
+		{
+			FrameBuffer tile_frame(ImageResolution(resolution_x, resolution_y));
+			for (const ImageTile &tile : RayTracer::OrderTiles(resolution_x, resolution_y, 12, TileOrder::Hilbert))
+			{
+				TileRenderTask(camera, tile, 2, scene, accelerator, tile_frame, packet_tracing).Execute();
+			}
+
+			ASSERT_EQ(pixel_frame.Means(), tile_frame.Means());
+			ASSERT_EQ(pixel_frame.Variances(), tile_frame.Variances());
+		}
+	}
+
+	TEST(TileRenderTaskTests, SameImageOnAnyThreadCount)
+	{
+		// Rough materials draw random numbers at every bounce and the camera jitters every sample
+		std::shared_ptr<const IMaterial> rough_mirror = std::make_shared<GlossyBSDF>(Color(0.9f, 0.8f, 0.7f, 1.0f), 0.3f);
+		std::shared_ptr<const IMaterial> diffuse = std::make_shared<DiffuseBSDF>(Color(0.5f, 0.7f, 0.9f, 1.0f), 1.0f);
+		std::shared_ptr<const IMaterial> light = std::make_shared<EmissiveBSDF>(Color(1.0f, 0.5f, 0.25f, 1.0f), 2.0f);
+		Sphere floor(Vector3<float>(0, -1002, 10), 1000.0f, diffuse);
+		Sphere ball(Vector3<float>(-1, 0, 8), 1.5f, rough_mirror);
+		Sphere lamp(Vector3<float>(3, 2, 5), 1.5f, light);
+
+		Scene scene;
+		scene.AddObject(&floor);
+		scene.AddObject(&ball);
+		scene.AddObject(&lamp);
+		BVHAccelerator accelerator(scene.Objects());
+
+		const size_t resolution_x = 40;
+		const size_t resolution_y = 30;
+		Camera camera(ImageResolution(resolution_x, resolution_y), Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), 20.0f, 36.0f);
+		std::vector<ImageTile> tiles = RayTracer::OrderTiles(resolution_x, resolution_y, 8, TileOrder::Spiral);
+
+		FrameBuffer wavefront_frame(ImageResolution(resolution_x, resolution_y));
+		WavefrontRenderTask(camera, tiles, 4, scene, accelerator, wavefront_frame).Execute();
+
+		for (size_t thread_count : { 1, 3 })
+		{
+			for (bool packet_tracing : { true, false })
+			{
+				FrameBuffer tile_frame(ImageResolution(resolution_x, resolution_y));
+				ThreadPool pool(thread_count, 1000);
+				for (const ImageTile &tile : tiles)
+				{
+					pool.EnqueueTask(std::make_shared<TileRenderTask>(camera, tile, 4, scene, accelerator, tile_frame, packet_tracing));
+				}
+				pool.BlockUntilComplete();
+
+				ASSERT_EQ(wavefront_frame.Means(), tile_frame.Means());
+				ASSERT_EQ(wavefront_frame.Variances(), tile_frame.Variances());
+			}
+		}
+	}
+}
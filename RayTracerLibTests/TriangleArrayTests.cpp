@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+#include "TriangleArray.h"
+
+#include <cmath>
+
+using RayTracer::TriangleArray;
+using RayTracer::Vector3;
+
+namespace TriangleArrayTests
+{
+	// Reference Moller-Trumbore on one triangle, returns the depth or infinity
+	static float ReferenceDepth(const Vector3<float> vertices[3], const float origin_components[3], const float direction_components[3])
+	{
+		Vector3<float> origin(origin_components[0], origin_components[1], origin_components[2]);
+		Vector3<float> direction(direction_components[0], direction_components[1], direction_components[2]);
+		Vector3<float> edge_1 = vertices[1] - vertices[0];
+		Vector3<float> edge_2 = vertices[2] - vertices[0];
+		Vector3<float> h = direction.Cross(edge_2);
+		float a = edge_1.Dot(h);
+		if (0 == a)
+		{
+			return std::numeric_limits<float>::infinity();
+		}
+
+		float f = 1.0f / a;
+		Vector3<float> s = origin - vertices[0];
+		float u = f * s.Dot(h);
+		Vector3<float> q = s.Cross(edge_1);
+		float v = f * direction.Dot(q);
+		float t = f * edge_2.Dot(q);
+		if (0.0f > u || 1.0f < u || 0.0f > v || 1.0f < (u + v) || 0 >= t)
+		{
+			return std::numeric_limits<float>::infinity();
+		}
+
+		return t;
+	}
+
+	TEST(TriangleArrayTests, BatchMatchesReference)
+	{
+		srand(41);
+		const size_t triangle_count = 45;
+		std::vector<Vector3<float>> vertices;
+		TriangleArray triangles(triangle_count);
+		for (size_t i = 0; i < triangle_count; i++)
+		{
+			// Overlapping triangles facing the ray at different depths
+			Vector3<float> corner((float)rand() / RAND_MAX - 1.0f, (float)rand() / RAND_MAX - 1.0f, 1.0f + (float)rand() / RAND_MAX * 4);
+			vertices.emplace_back(corner);
+			vertices.emplace_back(corner + Vector3<float>(1.5f, (float)rand() / RAND_MAX * 0.2f, (float)rand() / RAND_MAX - 0.5f));
+			vertices.emplace_back(corner + Vector3<float>((float)rand() / RAND_MAX * 0.2f, 1.5f, (float)rand() / RAND_MAX - 0.5f));
+			triangles.Set(i, vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+		}
+
+		for (int ray = 0; ray < 500; ray++)
+		{
+			const float origin[3] = { (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, 0.0f };
+			Vector3<float> direction_vector = Vector3<float>((float)rand() / RAND_MAX * 0.4f - 0.2f, (float)rand() / RAND_MAX * 0.4f - 0.2f, 1.0f).Normalize();
+			const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+			// Ranges that start and end inside a batch, and ranges shorter than a batch
+			const uint32_t first_index = rand() % triangle_count;
+			const uint32_t count = rand() % (triangle_count - first_index) + 1;
+
+			float expected_depth = std::numeric_limits<float>::infinity();
+			uint32_t expected_index = 0;
+			for (uint32_t index = first_index; index < first_index + count; index++)
+			{
+				float depth = ReferenceDepth(&vertices[3 * index], origin, direction);
+				if (depth < expected_depth)
+				{
+					expected_depth = depth;
+					expected_index = index;
+				}
+			}
+
+			float max_depth = std::numeric_limits<float>::infinity();
+			uint32_t index = 0;
+			ASSERT_EQ(std::isfinite(expected_depth), triangles.IntersectsRay(origin, direction, first_index, count, max_depth, index));
+			if (std::isfinite(expected_depth))
+			{
+				ASSERT_EQ(expected_index, index);
+				ASSERT_FLOAT_EQ(expected_depth, max_depth);
+
+				// Nothing is reported behind a closer hit found earlier
+				float closer_depth = expected_depth * 0.5f;
+				ASSERT_FALSE(triangles.IntersectsRay(origin, direction, first_index, count, closer_depth, index));
+				ASSERT_FLOAT_EQ(expected_depth * 0.5f, closer_depth);
+			}
+		}
+	}
+
+	TEST(TriangleArrayTests, WatertightMatchesReference)
+	{
+		srand(42);
+		const size_t triangle_count = 45;
+		std::vector<Vector3<float>> vertices;
+		TriangleArray triangles(triangle_count, true);
+		for (size_t i = 0; i < triangle_count; i++)
+		{
+			// Both windings, facing the rays at different depths
+			Vector3<float> corner((float)rand() / RAND_MAX - 1.0f, (float)rand() / RAND_MAX - 1.0f, 1.0f + (float)rand() / RAND_MAX * 4);
+			Vector3<float> side_1(1.5f, (float)rand() / RAND_MAX * 0.2f, (float)rand() / RAND_MAX - 0.5f);
+			Vector3<float> side_2((float)rand() / RAND_MAX * 0.2f, 1.5f, (float)rand() / RAND_MAX - 0.5f);
+			vertices.emplace_back(corner);
+			vertices.emplace_back(corner + (i % 2 ? side_1 : side_2));
+			vertices.emplace_back(corner + (i % 2 ? side_2 : side_1));
+			triangles.Set(i, vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+		}
+
+		for (int ray = 0; ray < 500; ray++)
+		{
+			// Any direction sign, so every permutation of the axes is used
+			const float origin[3] = { (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, ray % 2 ? 0.0f : 8.0f };
+			Vector3<float> direction_vector = Vector3<float>((float)rand() / RAND_MAX * 0.4f - 0.2f, (float)rand() / RAND_MAX * 0.4f - 0.2f, ray % 2 ? 1.0f : -1.0f).Normalize();
+			if (ray % 3 == 0)
+			{
+				direction_vector = Vector3<float>(direction_vector.Z, direction_vector.X, direction_vector.Y);
+			}
+			const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+			const TriangleArray::WatertightRay watertight_ray(origin, direction);
+
+			const uint32_t first_index = rand() % triangle_count;
+			const uint32_t count = rand() % (triangle_count - first_index) + 1;
+
+			float expected_depth = std::numeric_limits<float>::infinity();
+			uint32_t expected_index = 0;
+			for (uint32_t index = first_index; index < first_index + count; index++)
+			{
+				float depth = ReferenceDepth(&vertices[3 * index], origin, direction);
+				if (depth < expected_depth)
+				{
+					expected_depth = depth;
+					expected_index = index;
+				}
+			}
+
+			float max_depth = std::numeric_limits<float>::infinity();
+			uint32_t index = 0;
+			ASSERT_EQ(std::isfinite(expected_depth), triangles.IntersectsRayWatertight(watertight_ray, first_index, count, max_depth, index));
+			if (std::isfinite(expected_depth))
+			{
+				ASSERT_EQ(expected_index, index);
+				ASSERT_NEAR(expected_depth, max_depth, expected_depth * 1e-5f);
+			}
+		}
+	}
+
+	TEST(TriangleArrayTests, ParallelAndEdgeTest)
+	{
+		TriangleArray triangles(2);
+		triangles.Set(0, Vector3<float>(0, 0, 1), Vector3<float>(1, 0, 1), Vector3<float>(0, 1, 1));
+		// Contains the ray, so the ray is parallel to it
+		triangles.Set(1, Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 2), Vector3<float>(0, 1, 0));
+
+		const float origin[3] = { 0.0f, 0.25f, 0.0f };
+		const float direction[3] = { 0.0f, 0.0f, 1.0f };
+		float max_depth = std::numeric_limits<float>::infinity();
+		uint32_t index = 7;
+		ASSERT_TRUE(triangles.IntersectsRay(origin, direction, 0, 2, max_depth, index));
+		ASSERT_EQ(0u, index);
+		ASSERT_FLOAT_EQ(1.0f, max_depth);
+
+		max_depth = std::numeric_limits<float>::infinity();
+		ASSERT_FALSE(triangles.IntersectsRay(origin, direction, 1, 1, max_depth, index));
+
+		TriangleArray watertight_triangles(2, true);
+		watertight_triangles.Set(0, Vector3<float>(0, 0, 1), Vector3<float>(1, 0, 1), Vector3<float>(0, 1, 1));
+		watertight_triangles.Set(1, Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 2), Vector3<float>(0, 1, 0));
+
+		const TriangleArray::WatertightRay watertight_ray(origin, direction);
+		max_depth = std::numeric_limits<float>::infinity();
+		ASSERT_TRUE(watertight_triangles.IntersectsRayWatertight(watertight_ray, 0, 2, max_depth, index));
+		ASSERT_EQ(0u, index);
+		ASSERT_FLOAT_EQ(1.0f, max_depth);
+
+		max_depth = std::numeric_limits<float>::infinity();
+		ASSERT_FALSE(watertight_triangles.IntersectsRayWatertight(watertight_ray, 1, 1, max_depth, index));
+		ASSERT_EQ(Vector3<float>(0, 0, 1), watertight_triangles.Normal(0));
+
+		ASSERT_EQ(Vector3<float>(0, 0, 1), triangles.Normal(0));
+	}
+}
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "WavefrontRenderTask.h"
+#include "PixelRenderTask.h"
+#include "BVHAccelerator.h"
+#include "FrameBuffer.h"
+#include "Camera.h"
+#include "Sphere.h"
+#include "GlossyBSDF.h"
+#include "EmissiveBSDF.h"
+
+using RayTracer::WavefrontRenderTask;
+using RayTracer::PixelRenderTask;
+using RayTracer::BVHAccelerator;
+using RayTracer::FrameBuffer;
+using RayTracer::ImageResolution;
+using RayTracer::Camera;
+using RayTracer::ImageTile;
+using RayTracer::Scene;
+using RayTracer::Sphere;
+using RayTracer::GlossyBSDF;
+using RayTracer::EmissiveBSDF;
+using RayTracer::IMaterial;
+using RayTracer::Vector3;
+using RayTracer::Color;
+
+namespace WavefrontRenderTaskTests
+{
+	TEST(WavefrontRenderTaskTests, MatchesPixelRenderTask)
+	{
+		// Mirrors and lights only, so every path is deterministic. Between the two nearly flat mirrors
+		// the rays bounce until they run out of bounces, unless they hit the light or the sphere without
+		// a material on the way.
+		std::shared_ptr<const IMaterial> mirror = std::make_shared<GlossyBSDF>(Color(0.9f, 0.8f, 0.7f, 1.0f), 0.0f);
+		std::shared_ptr<const IMaterial> light = std::make_shared<EmissiveBSDF>(Color(1.0f, 0.5f, 0.25f, 1.0f), 2.0f);
+		Sphere front_mirror(Vector3<float>(0, 0, 1010), 1000.0f, mirror);
+		Sphere back_mirror(Vector3<float>(0, 0, -1010), 1000.0f, mirror);
+		Sphere lamp(Vector3<float>(3, 2, 5), 1.5f, light);
+		Sphere unlit(Vector3<float>(-3, -2, -5), 1.5f, nullptr);
+
+		Scene scene;
+		scene.AddObject(&front_mirror);
+		scene.AddObject(&back_mirror);
+		scene.AddObject(&lamp);
+		scene.AddObject(&unlit);
+		BVHAccelerator accelerator(scene.Objects());
+
+		// A camera without jitter and one batch of tiles like CPURenderer makes them
+		const size_t resolution = 16;
+		Camera camera(ImageResolution(resolution, resolution), Vector3<float>(0, 0, 0), Vector3<float>(0, 0, 1), 20.0f, 36.0f, false);
+		std::vector<ImageTile> tiles = { { 0, 0, 8, 8 }, { 8, 0, 8, 8 }, { 0, 8, 8, 8 }, { 8, 8, 8, 8 } };
+
+		FrameBuffer wavefront_frame(ImageResolution(resolution, resolution));
+		WavefrontRenderTask(camera, tiles, 3, scene, accelerator, wavefront_frame).Execute();
+
+		FrameBuffer pixel_frame(ImageResolution(resolution, resolution));
+		for (size_t y = 0; y < resolution; y++)
+		{
+			for (size_t x = 0; x < resolution; x++)
+			{
+				PixelRenderTask(camera, x, y, 3, scene, accelerator, pixel_frame).Execute();
+			}
+		}
+
+		ASSERT_EQ(pixel_frame.Means(), wavefront_frame.Means());
+		ASSERT_EQ(pixel_frame.Variances(), wavefront_frame.Variances());
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BVH.h"
+#include "MeshGeometry.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RayTracer
+{
+	// Versioned binary cache of the mesh geometry loaded from a model file together with the binary BVHs
+	// built over it. A cache is only used when its version, the hash of the source file and the options
+	// that shape the BVH all match, so a stale cache is rebuilt rather than trusted. Cache files are
+	// memory mapped on load and every array is copied out of the mapping in one piece.
+	// The format is native endian, caches are not meant to move between architectures.
+	class AccelerationStructureCache
+	{
+	public:
+		static constexpr uint32_t Version = 1;
+
+		// FNV-1a hash of the file's contents. Throws when the file cannot be read.
+		static uint64_t HashFile(const std::string &file_path);
+
+		// Fills out_geometry from the cache file. Returns false, leaving out_geometry empty, when the file
+		// is missing, was made from a different source or with different options, or is malformed.
+		static bool Load(const std::string &cache_path, uint64_t source_hash, const BVHBuildOptions &options,
+			std::vector<std::shared_ptr<const MeshGeometry>> &out_geometry);
+
+		// Writes the cache through a temporary file that is renamed into place, so concurrent jobs never
+		// see a partial cache. Throws when the file cannot be written.
+		static void Save(const std::string &cache_path, uint64_t source_hash, const BVHBuildOptions &options,
+			const std::vector<std::shared_ptr<const MeshGeometry>> &geometry);
+	};
+}
@@ -0,0 +1,417 @@
+#pragma once
+
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace RayTracer
+{
+	enum class BVHBuilder
+	{
+		// Evaluates every split position, best trees but O(n log^2 n) and always single threaded
+		SweepSAH,
+		// Evaluates BinCount planes per axis, builds large subtrees in parallel
+		BinnedSAH,
+		// Sorts centroids along a Morton curve and splits on the code bits, much faster to build
+		// than the SAH builders but the trees are slower to trace, meant for previews
+		LBVH,
+		// Binned SAH that can also split nodes with a plane, clipping the primitives that straddle it
+		// into both children. Best trees for long, thin or overlapping primitives, single threaded.
+		SBVH
+	};
+
+	struct BVHBuildOptions
+	{
+		BVHBuildOptions()
+		{
+			MaxLeafSize = 4;
+			TraversalCost = 1.0f;
+			IntersectionCost = 1.0f;
+			Builder = BVHBuilder::BinnedSAH;
+			BinCount = 16;
+			ParallelBuildThreshold = 16384;
+			MortonCodeBits = 63;
+			RefitRebuildThreshold = 1.5f;
+#if defined(__AVX__)
+			Width = 8;
+#else
+			Width = 4;
+#endif
+			QuantizedNodes = false;
+			WatertightTriangles = false;
+			SpatialSplitBudget = 0.3f;
+			SpatialSplitOverlap = 1e-5f;
+			Pool = nullptr;
+		}
+
+		// Leaves can only exceed this size when their primitives cannot be separated
+		uint32_t MaxLeafSize;
+		// Relative costs used by the surface area heuristic
+		float TraversalCost;
+		float IntersectionCost;
+		BVHBuilder Builder;
+		// Number of bins per axis for the binned builder, at most 64
+		uint32_t BinCount;
+		// Length of the LBVH Morton codes, rounded down to a multiple of 3 (e.g. 30 or 63)
+		uint32_t MortonCodeBits;
+		// Owners that refit their hierarchy rebuild it once its SAH cost exceeds this multiple of the built cost
+		float RefitRebuildThreshold;
+		// Children per node of the tree rays traverse: 2 walks the binary tree, 4 or 8 collapse it
+		// into a wide tree whose child boxes are tested together with SSE or AVX
+		uint32_t Width;
+		// Traverse a 4 wide tree of 64-byte nodes with 8-bit child boxes instead, for scenes whose
+		// hierarchy does not fit in cache. Takes precedence over Width.
+		bool QuantizedNodes;
+		// Meshes test their triangles with the watertight test instead of Moller-Trumbore, so rays
+		// through the edges shared by adjacent triangles cannot leak through the mesh
+		bool WatertightTriangles;
+		// SBVH: at most this fraction of the primitive count is added as duplicate references
+		float SpatialSplitBudget;
+		// SBVH: spatial splits are only tried where the object split children overlap by more than this
+		// fraction of the root's surface area
+		float SpatialSplitOverlap;
+		// Builds over at least this many primitives are split into subtree tasks
+		size_t ParallelBuildThreshold;
+		// Pool to run subtree tasks on, a temporary pool is created when this is null.
+		// The pool must be idle: the build waits for every task in it to complete.
+		ThreadPool *Pool;
+	};
+
+	// Binary bounding volume hierarchy over an arbitrary set of primitive bounds.
+	// The hierarchy only knows about boxes: callers keep their primitives in the order
+	// given by PrimitiveIndices() and intersect them in the callback passed to Traverse().
+	class BVH
+	{
+	public:
+		struct Node
+		{
+			BoundingBox bounds;
+			// Interior nodes: index of the second child, the first child always directly follows its parent
+			// Leaf nodes: index of the first primitive slot of the leaf
+			uint32_t offset;
+			// Zero for interior nodes
+			uint32_t primitive_count;
+
+			bool IsLeaf() const
+			{
+				return primitive_count > 0;
+			}
+		};
+
+		struct Statistics
+		{
+			// Expected cost of a random ray relative to the root, using the costs the tree was built with
+			float SAHCost = 0.0f;
+			uint32_t MaxDepth = 0;
+			size_t NodeCount = 0;
+			size_t LeafCount = 0;
+			// Primitive slots referenced by the leaves, more than the primitive count when the SBVH duplicated some
+			size_t ReferenceCount = 0;
+			// Number of leaves indexed by primitive count
+			std::vector<size_t> LeafSizeHistogram;
+			double BuildTimeMilliseconds = 0.0;
+		};
+
+		// Depth of the traversal stack, the builder never produces a deeper tree than this
+		static constexpr size_t MaxDepth = 128;
+
+		// max_depth a traversal callback sets to end the traversal early, see Traverse()
+		static constexpr float StopTraversal = -std::numeric_limits<float>::infinity();
+
+		// Returns the bounds of the part of a primitive inside clip_bounds. Lets the SBVH builder fit
+		// child boxes to the pieces of a split primitive, without one the boxes themselves are clipped.
+		using PrimitiveClipper = std::function<BoundingBox(uint32_t primitive_index, const BoundingBox &clip_bounds)>;
+
+		BVH() = default;
+		BVH(const std::vector<BoundingBox> &primitive_bounds, const BVHBuildOptions &options = BVHBuildOptions(),
+			const PrimitiveClipper &clip_primitive = nullptr);
+		// Adopts the nodes and slots of a hierarchy built earlier with the same options, e.g. one loaded
+		// from a cache file. Throws when they do not form a valid depth-first tree.
+		BVH(std::span<const Node> built_nodes, std::span<const uint32_t> built_primitive_indices, const BVHBuildOptions &options = BVHBuildOptions());
+
+		const std::vector<Node> &Nodes() const
+		{
+			return nodes;
+		}
+
+		// Maps each primitive slot referenced by the leaves to the index of the primitive it was built from.
+		// The SBVH builder can reference a primitive from several slots.
+		const std::vector<uint32_t> &PrimitiveIndices() const
+		{
+			return primitive_indices;
+		}
+
+		bool Empty() const
+		{
+			return nodes.empty();
+		}
+
+		BoundingBox Bounds() const
+		{
+			return nodes.empty() ? BoundingBox() : nodes[0].bounds;
+		}
+
+		Statistics ComputeStatistics() const;
+
+		size_t MemoryBytes() const
+		{
+			return nodes.size() * sizeof(Node);
+		}
+
+		// Recomputes every node's bounds bottom-up for primitives that moved, keeping the topology.
+		// slot_bounds holds the new bounds of each primitive slot, i.e. in PrimitiveIndices() order.
+		// Spatial splits are not redone, so a refit SBVH uses whole primitive bounds in every slot.
+		// Independent subtrees are refit on the pool when one is given. Returns the new SAH cost.
+		float Refit(const std::vector<BoundingBox> &slot_bounds, ThreadPool *pool = nullptr);
+
+		// Current SAH cost, relative to the root like Statistics::SAHCost
+		float SAHCost() const
+		{
+			return sah_cost;
+		}
+
+		// True when refitting has degraded the tree past threshold times its cost right after the build
+		bool NeedsRebuild(float threshold) const
+		{
+			return sah_cost > threshold * build_sah_cost;
+		}
+
+		// Runs the Traverse() callback on the slots of one leaf, see Traverse()
+		template <class PrimitiveIntersector>
+		static bool IntersectLeaf(PrimitiveIntersector &intersect_primitive, uint32_t first_slot, uint32_t slot_count, float &max_depth)
+		{
+			if constexpr (std::is_invocable_r_v<bool, PrimitiveIntersector &, uint32_t, uint32_t, float &>)
+			{
+				return intersect_primitive(first_slot, slot_count, max_depth);
+			}
+			else
+			{
+				bool intersection_found = false;
+				for (uint32_t slot = first_slot; slot < first_slot + slot_count; slot++)
+				{
+					if (intersect_primitive(slot, max_depth))
+					{
+						intersection_found = true;
+					}
+
+					// An any-hit query has stopped the traversal, see Traverse()
+					if (max_depth < 0.0f)
+					{
+						break;
+					}
+				}
+
+				return intersection_found;
+			}
+		}
+
+		// Closest-hit traversal. intersect_primitive(slot, max_depth) is called for every primitive slot
+		// in a leaf the ray reaches; it must return true and shrink max_depth when it finds a closer hit.
+		// A callback taking (first_slot, slot_count, max_depth) is called once per leaf instead, so it can
+		// test the primitives of the leaf together. An any-hit query stops the traversal by setting
+		// max_depth to StopTraversal once it finds a hit, since no node can be entered before depth zero.
+		template <class PrimitiveIntersector>
+		bool Traverse(const Ray &ray, float &max_depth, PrimitiveIntersector &&intersect_primitive) const
+		{
+			if (nodes.empty())
+			{
+				return false;
+			}
+
+			const Vector3<float> &origin = ray.Origin();
+			const float *inverse_direction = ray.InverseDirection();
+
+			float entry_depth = 0.0f;
+			if (!nodes[0].bounds.IntersectsRay(origin, inverse_direction, max_depth, entry_depth))
+			{
+				return false;
+			}
+
+			struct StackEntry
+			{
+				uint32_t node_index;
+				float entry_depth;
+			};
+
+			StackEntry stack[MaxDepth];
+			size_t stack_size = 0;
+			uint32_t node_index = 0;
+			bool intersection_found = false;
+
+			while (true)
+			{
+				const Node &node = nodes[node_index];
+				if (node.IsLeaf())
+				{
+					if (IntersectLeaf(intersect_primitive, node.offset, node.primitive_count, max_depth))
+					{
+						intersection_found = true;
+					}
+				}
+				else
+				{
+					uint32_t near_child = node_index + 1;
+					uint32_t far_child = node.offset;
+					float near_depth = 0.0f;
+					float far_depth = 0.0f;
+					bool near_hit = nodes[near_child].bounds.IntersectsRay(origin, inverse_direction, max_depth, near_depth);
+					bool far_hit = nodes[far_child].bounds.IntersectsRay(origin, inverse_direction, max_depth, far_depth);
+
+					if (near_hit && far_hit)
+					{
+						if (far_depth < near_depth)
+						{
+							std::swap(near_child, far_child);
+							std::swap(near_depth, far_depth);
+						}
+
+						stack[stack_size++] = { far_child, far_depth };
+						node_index = near_child;
+						continue;
+					}
+					else if (near_hit || far_hit)
+					{
+						node_index = near_hit ? near_child : far_child;
+						continue;
+					}
+				}
+
+				// Pop until a node that can still contain a closer hit is found
+				bool found_next = false;
+				while (stack_size > 0)
+				{
+					const StackEntry &entry = stack[--stack_size];
+					if (entry.entry_depth <= max_depth)
+					{
+						node_index = entry.node_index;
+						found_next = true;
+						break;
+					}
+				}
+
+				if (!found_next)
+				{
+					break;
+				}
+			}
+
+			return intersection_found;
+		}
+
+		// Closest-hit traversal of a Coherent() packet. Nodes are culled for the whole packet with one
+		// interval slab test against the farthest current hit, so a coherent packet pays for one box test
+		// per node instead of one per ray. At a leaf, every ray that hits the leaf box is tested on its own:
+		// intersect_leaf(ray_index, first_slot, slot_count, max_depths[ray_index]) follows the leaf
+		// callback contract of Traverse(). max_depths holds the current depth of every ray.
+		template <class PacketLeafIntersector>
+		void TraversePacket(const RayPacket &packet, float max_depths[], PacketLeafIntersector &&intersect_leaf) const
+		{
+			if (nodes.empty() || 0 == packet.Size())
+			{
+				return;
+			}
+
+			auto farthest_depth = [&]() { return *std::max_element(max_depths, max_depths + packet.Size()); };
+			float packet_max_depth = farthest_depth();
+
+			float entry_depth = 0.0f;
+			if (!packet.IntersectsBox(nodes[0].bounds, packet_max_depth, entry_depth))
+			{
+				return;
+			}
+
+			struct StackEntry
+			{
+				uint32_t node_index;
+				float entry_depth;
+			};
+
+			StackEntry stack[MaxDepth];
+			size_t stack_size = 0;
+			uint32_t node_index = 0;
+
+			while (true)
+			{
+				const Node &node = nodes[node_index];
+				if (node.IsLeaf())
+				{
+					for (size_t ray_index = 0; ray_index < packet.Size(); ray_index++)
+					{
+						float ray_entry_depth = 0.0f;
+						if (packet.RayIntersectsBox(ray_index, node.bounds, max_depths[ray_index], ray_entry_depth))
+						{
+							intersect_leaf(ray_index, node.offset, node.primitive_count, max_depths[ray_index]);
+						}
+					}
+
+					packet_max_depth = farthest_depth();
+				}
+				else
+				{
+					uint32_t near_child = node_index + 1;
+					uint32_t far_child = node.offset;
+					float near_depth = 0.0f;
+					float far_depth = 0.0f;
+					bool near_hit = packet.IntersectsBox(nodes[near_child].bounds, packet_max_depth, near_depth);
+					bool far_hit = packet.IntersectsBox(nodes[far_child].bounds, packet_max_depth, far_depth);
+
+					if (near_hit && far_hit)
+					{
+						if (far_depth < near_depth)
+						{
+							std::swap(near_child, far_child);
+							std::swap(near_depth, far_depth);
+						}
+
+						stack[stack_size++] = { far_child, far_depth };
+						node_index = near_child;
+						continue;
+					}
+					else if (near_hit || far_hit)
+					{
+						node_index = near_hit ? near_child : far_child;
+						continue;
+					}
+				}
+
+				bool found_next = false;
+				while (stack_size > 0)
+				{
+					const StackEntry &entry = stack[--stack_size];
+					if (entry.entry_depth <= packet_max_depth)
+					{
+						node_index = entry.node_index;
+						found_next = true;
+						break;
+					}
+				}
+
+				if (!found_next)
+				{
+					break;
+				}
+			}
+		}
+
+	private:
+		std::vector<Node> nodes;
+		std::vector<uint32_t> primitive_indices;
+		double build_time_ms = 0.0;
+		float traversal_cost = 1.0f;
+		float intersection_cost = 1.0f;
+		float sah_cost = 0.0f;
+		float build_sah_cost = 0.0f;
+
+		float ComputeSAHCost() const;
+		void RefitNode(uint32_t node_index, const std::vector<BoundingBox> &slot_bounds);
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "IAccelerationStructure.h"
+#include "TraversalHierarchy.h"
+#include "SphereArray.h"
+#include <vector>
+
+namespace RayTracer
+{
+	// Top-level BVH over the objects of a scene, built from IIntersectable::Bounds(). The spheres of a
+	// leaf are tested together through a SphereArray, other objects through IIntersectable.
+	class BVHAccelerator : public IAccelerationStructure
+	{
+	public:
+		BVHAccelerator(const std::vector<const IIntersectable *> &objects, const BVHBuildOptions &options = BVHBuildOptions());
+
+		virtual bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info, const IIntersectable *&out_object) const override;
+
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const override;
+
+		// Coherent packets are culled a node at a time with BVH::TraversePacket, others are traced ray by ray.
+		// Packets always walk the binary tree, whatever layout BVHBuildOptions selects for single rays: its box
+		// test is vectorized over the rays of the packet, the wide and quantized nodes over the children of a node.
+		virtual void IntersectsPacket(const RayPacket &packet, Intersection out_intersections[], const IIntersectable *out_objects[]) const override;
+
+		// Rebuilds the hierarchy from the current object bounds, e.g. after mesh instances were moved.
+		// This only touches the top level, the per-geometry BVHs are left alone.
+		void Rebuild(const BVHBuildOptions &options = BVHBuildOptions());
+
+		// Per-frame update for objects that moved: refits the hierarchy to the current object bounds and
+		// only rebuilds it, with the options it was last built with, once the refit tree has degraded
+		// past their RefitRebuildThreshold. Returns true when the hierarchy was rebuilt.
+		bool Update(ThreadPool *pool = nullptr);
+
+		const BVH &Hierarchy() const
+		{
+			return bvh.Binary();
+		}
+
+	private:
+		struct ClosestHit;
+
+		// Tests one ray against the objects of a leaf, see BVH::Traverse
+		bool IntersectSlots(const Ray &ray, const float origin[3], const float direction[3], uint32_t first_slot, uint32_t slot_count,
+			float &max_depth, ClosestHit &closest_hit) const;
+		bool FinishClosestHit(const Ray &ray, const float direction[3], float depth, ClosestHit &closest_hit,
+			Intersection &out_intersection_info, const IIntersectable *&out_object) const;
+
+		TraversalHierarchy bvh;
+		BVHBuildOptions build_options;
+		// Objects in the order the BVH leaves reference them
+		std::vector<const IIntersectable *> ordered_objects;
+		// Spheres of ordered_objects, repacked whenever the hierarchy is refit or rebuilt
+		SphereArray spheres;
+	};
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "IScene.h"
+#include "Camera.h"
+#include "BVH.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace RayTracer
+{
+	// Measures the CPU acceleration structures on the triangles of a scene. Every mesh and mesh
+	// instance is flattened into one world space triangle soup, then one primary ray per pixel of
+	// the camera is traced through it on a single thread.
+	class Benchmark
+	{
+	public:
+		struct Result
+		{
+			std::string name;
+			double build_time_ms;
+			// Size of the nodes the rays traverse
+			size_t memory_bytes;
+			double million_rays_per_second;
+			size_t hit_count;
+		};
+
+		Benchmark(const IScene &scene, const Camera &camera);
+
+		size_t TriangleCount() const
+		{
+			return faces.size();
+		}
+
+		size_t RayCount() const
+		{
+			return rays.size();
+		}
+
+		// Builds the triangles into a MeshGeometry with the given options and traces every ray through it
+		Result MeasureMeshHierarchy(const std::string &name, const BVHBuildOptions &options) const;
+
+		// The binary, 4 wide, 8 wide and quantized node layouts
+		std::vector<Result> MeasureHierarchyLayouts() const;
+
+		// Every BVH builder with the default layout
+		std::vector<Result> MeasureBuilders() const;
+
+		// Moller-Trumbore and the watertight triangle test with the default layout, rays leaking through
+		// shared edges show up as fewer hits
+		std::vector<Result> MeasureTriangleTests() const;
+
+		void PrintResults(const std::vector<Result> &results, std::ostream &stream) const;
+
+	private:
+		std::vector<Vector3<float>> vertices;
+		std::vector<Vector3<size_t>> faces;
+		std::vector<Ray> rays;
+	};
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Vector3.h"
+
+#include <limits>
+
+namespace RayTracer
+{
+	// Axis-aligned bounding box stored as plain floats so it stays small inside acceleration structure nodes
+	class BoundingBox
+	{
+	public:
+		float min[3];
+		float max[3];
+
+		// Slab tests scale the exit depth of each slab by 1 + 2 gamma(3), so their rounding cannot reject a
+		// ray that only grazes the box, e.g. one through a vertex shared by triangles in different leaves.
+		// See Ize, "Robust BVH Ray Traversal" (JCGT 2013).
+		static constexpr float RobustExitScale = 1.0f + 2.0f * (1.5f * std::numeric_limits<float>::epsilon()) / (1.0f - 1.5f * std::numeric_limits<float>::epsilon());
+
+		// An empty box has inverted extents so that expanding it by anything yields that thing
+		BoundingBox()
+		{
+			min[0] = min[1] = min[2] = std::numeric_limits<float>::infinity();
+			max[0] = max[1] = max[2] = -std::numeric_limits<float>::infinity();
+		}
+
+		BoundingBox(const Vector3<float> &minimum, const Vector3<float> &maximum)
+		{
+			min[0] = minimum.X;
+			min[1] = minimum.Y;
+			min[2] = minimum.Z;
+			max[0] = maximum.X;
+			max[1] = maximum.Y;
+			max[2] = maximum.Z;
+		}
+
+		Vector3<float> Min() const
+		{
+			return Vector3<float>(min[0], min[1], min[2]);
+		}
+
+		Vector3<float> Max() const
+		{
+			return Vector3<float>(max[0], max[1], max[2]);
+		}
+
+		bool IsEmpty() const
+		{
+			return min[0] > max[0] || min[1] > max[1] || min[2] > max[2];
+		}
+
+		float Centroid(int axis) const
+		{
+			return 0.5f * (min[axis] + max[axis]);
+		}
+
+		float Extent(int axis) const
+		{
+			return max[axis] - min[axis];
+		}
+
+		int LargestAxis() const
+		{
+			float x = Extent(0);
+			float y = Extent(1);
+			float z = Extent(2);
+			if (x >= y && x >= z)
+			{
+				return 0;
+			}
+
+			return y >= z ? 1 : 2;
+		}
+
+		float SurfaceArea() const
+		{
+			if (IsEmpty())
+			{
+				return 0.0f;
+			}
+
+			float x = Extent(0);
+			float y = Extent(1);
+			float z = Extent(2);
+			return 2.0f * (x * y + y * z + z * x);
+		}
+
+		void Expand(const Vector3<float> &point)
+		{
+			min[0] = std::min<float>(min[0], point.X);
+			min[1] = std::min<float>(min[1], point.Y);
+			min[2] = std::min<float>(min[2], point.Z);
+			max[0] = std::max<float>(max[0], point.X);
+			max[1] = std::max<float>(max[1], point.Y);
+			max[2] = std::max<float>(max[2], point.Z);
+		}
+
+		void Expand(const BoundingBox &other)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min<float>(min[axis], other.min[axis]);
+				max[axis] = std::max<float>(max[axis], other.max[axis]);
+			}
+		}
+
+		// Box shared by both, empty when they do not touch
+		BoundingBox Overlap(const BoundingBox &other) const
+		{
+			BoundingBox overlap;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				overlap.min[axis] = std::max<float>(min[axis], other.min[axis]);
+				overlap.max[axis] = std::min<float>(max[axis], other.max[axis]);
+			}
+
+			return overlap;
+		}
+
+		// Slab test, inverse_direction must be the reciprocal of the normalized ray direction.
+		// NaNs from 0 * inf (a ray in a slab plane) fail every comparison and are ignored.
+		bool IntersectsRay(const Vector3<float> &origin, const float inverse_direction[3], float max_depth, float &out_entry_depth) const
+		{
+			float near_depth = 0.0f;
+			float far_depth = max_depth;
+
+			const float ray_origin[3] = { origin.X, origin.Y, origin.Z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (min[axis] - ray_origin[axis]) * inverse_direction[axis];
+				float t1 = (max[axis] - ray_origin[axis]) * inverse_direction[axis];
+				if (t0 > t1)
+				{
+					std::swap(t0, t1);
+				}
+
+				t1 *= RobustExitScale;
+				near_depth = t0 > near_depth ? t0 : near_depth;
+				far_depth = t1 < far_depth ? t1 : far_depth;
+			}
+
+			out_entry_depth = near_depth;
+			return near_depth <= far_depth;
+		}
+	};
+}
@@ -3,14 +3,43 @@
 #include "IImage.h"
 #include "IScene.h"
 #include "Camera.h"
+#include "BVH.h"
+#include "GridAccelerator.h"
+#include "TileOrder.h"
 
 namespace RayTracer
 {
 	class CPURenderer
 	{
 	public:
-		void Render(size_t max_threads, const Camera& camera, unsigned int samples, 
-			const IScene &scene, std::shared_ptr<IImage> &out_image);
+		struct CPURendererParameters
+		{
+			const Camera &camera;
+			unsigned int samples;
+			const IScene &scene;
+			size_t max_threads;
+			bool trace_performance;
+			// Structure over the scene objects, Automatic asks GridAccelerator::SuitsObjects
+			AccelerationStructureType acceleration_structure;
+			// Used for the top level hierarchy over the scene objects, the pool is provided by the renderer
+			BVHBuildOptions bvh_build_options;
+			GridBuildOptions grid_build_options;
+			// Trace the camera rays of 8x8 pixel blocks as one packet, instead of one ray at a time
+			bool packet_tracing;
+			// Render batches of tiles breadth-first, one bounce of all their rays at a time. Takes precedence over packet_tracing
+			bool wavefront;
+			// Width and height of the pixel tiles each render task covers, and the order the tasks are enqueued in
+			size_t tile_size;
+			TileOrder tile_order;
+
+			CPURendererParameters(const Camera &camera, const IScene &scene)
+				: camera(camera), samples(1), scene(scene), max_threads(0), trace_performance(false),
+				acceleration_structure(AccelerationStructureType::Automatic), packet_tracing(true), wavefront(false),
+				tile_size(16), tile_order(TileOrder::Scanline)
+			{}
+		};
+
+		void Render(const CPURendererParameters &params, std::shared_ptr<IImage> &out_image);
 	};
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "Pixel.h"
 #include "Image.h"
+#include "Random.h"
+#include <cstdint>
 
 namespace RayTracer
 {
@@ -16,11 +18,20 @@ namespace RayTracer
 		Vector3<float> upVector;
 		const float focalLengthMM;
 		const float sensorWidthMM;
+
+		// Constants of the sensor the camera rays are generated from
+		Vector3<float> centerOfNearClipPlane;
+		float sensorWidthM;
+		float sensorHeightM;
+		float pixelSizeM;
+
+		// Without jitter every sample of a pixel goes through its center
+		const bool jitterSamples;
 	public:
 		Camera(const ImageResolution &resolution, const Vector3<float> &position, 
-			const Vector3<float> &forwardVector, float focalLength, float sensorWidthMM) :
+			const Vector3<float> &forwardVector, float focalLength, float sensorWidthMM, bool jitterSamples = true) :
 			resolution(resolution), position(position), forwardVector(forwardVector.Normalize()), 
-			focalLengthMM(focalLength), sensorWidthMM(sensorWidthMM)
+			focalLengthMM(focalLength), sensorWidthMM(sensorWidthMM), jitterSamples(jitterSamples)
 		{
 			Vector3<float> camera_right_vector;
 			Vector3<float> camera_up_vector;
@@ -40,6 +51,12 @@ namespace RayTracer
 				rightVector = forwardVector.Cross(Vector3<float>(0, 1, 0)).Normalize();
 				upVector = rightVector.Cross(forwardVector).Normalize();
 			}
+
+			// Take the center of the near clip plane and offset left/right and up/down
+			centerOfNearClipPlane = Vector3<float>(position + (this->forwardVector * (focalLengthMM / MM_in_M)));
+			sensorHeightM = sensorWidthMM * resolution.Y / MM_in_M / resolution.X;
+			sensorWidthM = sensorWidthMM / MM_in_M;
+			pixelSizeM = sensorWidthMM / resolution.X / MM_in_M;
 		}
 
 		Vector3<float> Position() const
@@ -77,31 +94,56 @@ namespace RayTracer
 			return sensorWidthMM;
 		}
 
-		std::vector<Pixel> GetOutgoingPixels() const
+		// Index of pixel (x, y) in the image, row by row. The random draws of its samples are seeded with it.
+		uint32_t PixelIndex(size_t x, size_t y) const
 		{
-			std::vector<Pixel> pixels;
+			return static_cast<uint32_t>(y * resolution.X + x);
+		}
 
-			pixels.reserve(resolution.X * resolution.Y);
+		// Direction from the camera position through the center of pixel (x, y), row 0 is the top of the image
+		Vector3<float> PixelDirection(size_t x, size_t y) const
+		{
+			float vertical_scalar = (((float)(-1 * ((2 * (int)y) + 1)) / resolution.Y) + 1) * sensorHeightM;
+			float horizontal_scalar = (((float)((2 * (int)x) + 1) / resolution.X) - 1) * sensorWidthM;
 
-			const Vector3<float> center_of_near_clip_plane = Vector3<float>(position + (forwardVector * (focalLengthMM / MM_in_M)));
+			return centerOfNearClipPlane + (rightVector * horizontal_scalar) + (upVector * vertical_scalar) - position;
+		}
 
-			// Take the center of the near clip plane and offset left/right and up/down
-			float sensor_height_m = sensorWidthMM * resolution.Y / MM_in_M / resolution.X;
-			float sensor_width_m = sensorWidthMM / MM_in_M;
+		// Ray through pixel (x, y), offset from its center by jitter_x pixels to the right and jitter_y pixels up
+		Ray GetRay(size_t x, size_t y, float jitter_x, float jitter_y) const
+		{
+			Vector3<float> jittered_direction = PixelDirection(x, y) + (rightVector * jitter_x * pixelSizeM) + (upVector * jitter_y * pixelSizeM);
 
-			float pixel_size_m = sensorWidthMM / resolution.X / MM_in_M;
+			return Ray(position, jittered_direction, Color());
+		}
 
-			for (int y = 0; y < resolution.Y; y++)
+		// Ray of a sample of pixel (x, y), jittered by up to half a pixel. The jitter is drawn from the generator
+		// of the sample's camera ray, so the ray is the same whichever thread renders it and in whatever order.
+		Ray GetRay(size_t x, size_t y, unsigned int sample) const
+		{
+			if (!jitterSamples)
 			{
-				float vertical_scalar = (((float)(-1 * ((2 * y) + 1)) / resolution.Y) + 1) * sensor_height_m;
+				return GetRay(x, y, 0.0f, 0.0f);
+			}
 
-				for (int x = 0; x < resolution.X; x++)
-				{
-					float horizontal_scalar = (((float)((2 * x) + 1) / resolution.X) - 1) * sensor_width_m;
+			PCG32 random = PCG32::ForPath(PixelIndex(x, y), sample, 0);
+			const float jitter_x = random.NextFloat() - 0.5f;
+			const float jitter_y = random.NextFloat() - 0.5f;
+
+			return GetRay(x, y, jitter_x, jitter_y);
+		}
+
+		std::vector<Pixel> GetOutgoingPixels() const
+		{
+			std::vector<Pixel> pixels;
 
-					Vector3<float> ray = center_of_near_clip_plane + (rightVector * horizontal_scalar) + (upVector * vertical_scalar) - position;
+			pixels.reserve(resolution.X * resolution.Y);
 
-					pixels.emplace_back(Pixel(position, ray, x, y, pixel_size_m, pixel_size_m));
+			for (size_t y = 0; y < resolution.Y; y++)
+			{
+				for (size_t x = 0; x < resolution.X; x++)
+				{
+					pixels.emplace_back(Pixel(position, PixelDirection(x, y), x, y, pixelSizeM, pixelSizeM));
 				}
 			}
 
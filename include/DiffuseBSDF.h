@@ -12,7 +12,7 @@ namespace RayTracer
 		virtual const Color SurfaceColor() const override;
 		virtual float Roughness() const override;
 		virtual void GetResultantRay(const Intersection &intersection,
-			const Ray &incoming_ray, Ray &outgoing_ray) const override;
+			const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const override;
 	private:
 		Color color;
 		float roughness;
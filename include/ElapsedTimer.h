@@ -17,7 +17,7 @@ namespace RayTracer
 		}
 
 	private:
-		std::chrono::steady_clock::time_point last_poll_time;
+		std::chrono::high_resolution_clock::time_point last_poll_time;
 	};
 }
 
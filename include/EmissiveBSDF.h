@@ -13,7 +13,7 @@ namespace RayTracer
 		virtual const Color SurfaceColor() const override;
 		virtual float Roughness() const override;
 		virtual void GetResultantRay(const Intersection &intersection,
-			const Ray &incoming_ray, Ray &outgoing_ray) const override;
+			const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const override;
 		float Strength() const { return strength; }
 	private:
 		Color color;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Color.h"
+#include "Image.h"
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+	// Running mean and variance of the sample colors of a pixel, updated one sample at a time with Welford's
+	// algorithm so no sample has to be kept and large sums do not lose precision
+	struct SampleStatistics
+	{
+		uint32_t count = 0;
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		// Sum of the squared differences from the mean of each channel
+		float squared_deviations[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		void Add(const Color &color)
+		{
+			const float value[4] = { color.R_float(), color.G_float(), color.B_float(), color.A_float() };
+
+			count++;
+			const float weight = 1.0f / count;
+			for (int channel = 0; channel < 4; channel++)
+			{
+				const float deviation = value[channel] - mean[channel];
+				mean[channel] += deviation * weight;
+				squared_deviations[channel] += deviation * (value[channel] - mean[channel]);
+			}
+		}
+
+		// Unbiased variance of the samples of a channel
+		float Variance(int channel) const
+		{
+			return count > 1 ? squared_deviations[channel] / (count - 1) : 0.0f;
+		}
+	};
+
+	// Float RGBA image the render tasks write the statistics of their pixels to. Each pixel keeps the mean of
+	// its samples and their variance, the bytes of the output image are only made from the means at the end.
+	class FrameBuffer
+	{
+	private:
+		ImageResolution resolution;
+
+		std::vector<float> means;
+		std::vector<float> variances;
+	public:
+		FrameBuffer(const ImageResolution &resolution)
+			: resolution(resolution), means(4 * resolution.X * resolution.Y, 0.0f), variances(4 * resolution.X * resolution.Y, 0.0f)
+		{
+		}
+
+		ImageResolution Resolution() const
+		{
+			return resolution;
+		}
+
+		void SetPixel(size_t x, size_t y, const SampleStatistics &statistics)
+		{
+			const size_t offset = 4 * (y * resolution.X + x);
+			for (int channel = 0; channel < 4; channel++)
+			{
+				means[offset + channel] = statistics.mean[channel];
+				variances[offset + channel] = statistics.Variance(channel);
+			}
+		}
+
+		// Four channels per pixel, row by row
+		const std::vector<float> &Means() const
+		{
+			return means;
+		}
+
+		const std::vector<float> &Variances() const
+		{
+			return variances;
+		}
+
+		// Red, green, blue and alpha of pixel (x, y)
+		const float *Mean(size_t x, size_t y) const
+		{
+			return &means[4 * (y * resolution.X + x)];
+		}
+
+		const float *Variance(size_t x, size_t y) const
+		{
+			return &variances[4 * (y * resolution.X + x)];
+		}
+
+		// Writes the means to an image of the same resolution, clamped to the brightest byte
+		void WriteImage(IImage &image) const
+		{
+			for (size_t y = 0; y < resolution.Y; y++)
+			{
+				for (size_t x = 0; x < resolution.X; x++)
+				{
+					const float *mean = Mean(x, y);
+					image.SetPixelColor(x, y, Color(
+						(png_byte)(std::min<float>(1.0f, mean[0]) * Color::MAX_COLOR),
+						(png_byte)(std::min<float>(1.0f, mean[1]) * Color::MAX_COLOR),
+						(png_byte)(std::min<float>(1.0f, mean[2]) * Color::MAX_COLOR),
+						(png_byte)(std::min<float>(1.0f, mean[3]) * Color::MAX_COLOR)));
+				}
+			}
+		}
+	};
+}
@@ -14,7 +14,7 @@ namespace RayTracer
 	class GPURayIntersector
 	{
 	public:
-		GPURayIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_gpu_sphere_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session);
+		GPURayIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer, vk::Buffer input_gpu_sphere_buffer, vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, bool watertight_triangles, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session);
 		void WriteCommandBuffers(const std::vector<std::reference_wrapper<vk::CommandBuffer>> &buffers, size_t incoming_ray_count);
 
 		uint32_t RequiredCommandBuffers() const 
@@ -50,9 +50,20 @@ namespace RayTracer
 		{
 		public:
 			GPUMeshIntersector(vk::Device device, uint32_t compute_queue_index, vk::Buffer input_gpu_ray_buffer, vk::Buffer output_gpu_intersection_buffer,
-				vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session);
+				vk::Buffer input_vertex_buffer, vk::Buffer input_face_buffer, bool watertight_triangles, const std::unique_ptr<PerformanceTracking::PerformanceSession> &session);
 			void WriteCommandBuffer(vk::CommandBuffer &buffer, size_t incoming_ray_count);
 		private:
+			struct push_constants
+			{
+				push_constants()
+				{
+					watertight_triangles = 0;
+				}
+
+				// Selects the face test in the shader, a bool is 32 bits there
+				uint32_t watertight_triangles;
+			} MeshIntersectorPushConstants;
+
 			const std::unique_ptr<PerformanceTracking::PerformanceSession> &performance_session;
 		};
 
@@ -18,9 +18,11 @@ namespace RayTracer
 			size_t max_bounces;
 			const IScene &scene;
 			bool trace_performance;
+			// Intersect mesh faces with the watertight test instead of Moller-Trumbore
+			bool watertight_triangles;
 
 			GPURendererInitParameters(const Camera &camera, const IScene &scene)
-				: camera(camera), scene(scene), samples(1), max_bounces(8), trace_performance(false)
+				: camera(camera), scene(scene), samples(1), max_bounces(8), trace_performance(false), watertight_triangles(false)
 			{}
 		};
 
@@ -71,6 +73,7 @@ namespace RayTracer
 		Camera camera;
 		unsigned int samples;
 		size_t max_bounces;
+		bool watertight_triangles;
 		const IScene &scene;
 
 		std::vector<BufferCreationAndMappingData> BufferData;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "IAccelerationStructure.h"
+#include "BoundingBox.h"
+#include "SphereArray.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+	struct GridBuildOptions
+	{
+		GridBuildOptions()
+		{
+			CellsPerObject = 3.0f;
+			MaxResolution = 128;
+		}
+
+		// Target cell count relative to the object count, cells are kept close to cubes
+		float CellsPerObject;
+		// Upper bound on the number of cells along any axis
+		uint32_t MaxResolution;
+	};
+
+	// Uniform grid over the objects of a scene, traversed cell by cell with a 3D-DDA. It builds in
+	// linear time and beats a BVH on dense arrays of similarly sized objects, but a few large objects
+	// or objects clustered in a small part of the scene make it slow; SuitsObjects() checks for both.
+	class GridAccelerator : public IAccelerationStructure
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t Resolution[3] = {};
+			size_t CellCount = 0;
+			size_t EmptyCellCount = 0;
+			// Object references stored over all cells, objects overlapping several cells are counted in each
+			size_t ReferenceCount = 0;
+			double BuildTimeMilliseconds = 0.0;
+		};
+
+		GridAccelerator(const std::vector<const IIntersectable *> &objects, const GridBuildOptions &options = GridBuildOptions());
+
+		virtual bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info, const IIntersectable *&out_object) const override;
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const override;
+
+		// Heuristic that prefers the grid over a BVH: enough objects, no object much larger than the
+		// typical one, and object centers spread over the cells the grid would have
+		static bool SuitsObjects(const std::vector<const IIntersectable *> &objects, const GridBuildOptions &options = GridBuildOptions());
+
+		Statistics ComputeStatistics() const;
+
+		BoundingBox Bounds() const
+		{
+			return bounds;
+		}
+
+	private:
+		BoundingBox bounds;
+		uint32_t resolution[3] = { 0, 0, 0 };
+		float cell_size[3] = { 0.0f, 0.0f, 0.0f };
+		float inverse_cell_size[3] = { 0.0f, 0.0f, 0.0f };
+		// The objects of cell c are cell_objects[cell_offsets[c]] up to cell_objects[cell_offsets[c + 1]]
+		std::vector<uint32_t> cell_offsets;
+		std::vector<const IIntersectable *> cell_objects;
+		// Spheres of cell_objects, tested a batch at a time
+		SphereArray spheres;
+		double build_time_ms = 0.0;
+
+		size_t CellIndex(const uint32_t cell[3]) const
+		{
+			return (static_cast<size_t>(cell[2]) * resolution[1] + cell[1]) * resolution[0] + cell[0];
+		}
+
+		uint32_t CellCoordinate(float position, int axis) const;
+
+		// Calls visit_cell(cell_index, exit_depth) for the cells along the ray in order, until it returns
+		// false. exit_depth is where the ray leaves the cell, direction must be normalized.
+		template <class CellVisitor>
+		void WalkCells(const Ray &incoming_ray, const float direction[3], CellVisitor &&visit_cell) const;
+	};
+}
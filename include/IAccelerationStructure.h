@@ -0,0 +1,46 @@
+#pragma once
+
+#include "IIntersectable.h"
+#include "Intersection.h"
+#include "Ray.h"
+#include "RayPacket.h"
+
+namespace RayTracer
+{
+	enum class AccelerationStructureType
+	{
+		// Picks the grid for dense arrays of similar objects and the BVH for everything else
+		Automatic,
+		BVH,
+		Grid
+	};
+
+	class IAccelerationStructure
+	{
+	public:
+		virtual ~IAccelerationStructure() = default;
+
+		// Finds the closest intersection along the ray no farther than its MaxDepth() and the object it
+		// belongs to. While the objects are tested their ray's MaxDepth() is lowered to the closest hit so
+		// far, it is restored before returning.
+		virtual bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info, const IIntersectable *&out_object) const = 0;
+
+		// Any-hit query for shadow rays: true when some object is hit closer than max_depth. Stops at the
+		// first hit found and never builds an intersection.
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const = 0;
+
+		// Closest intersection of every ray of the packet, out_objects[i] stays null for rays that miss.
+		// Structures without packet traversal trace the rays one at a time.
+		virtual void IntersectsPacket(const RayPacket &packet, Intersection out_intersections[], const IIntersectable *out_objects[]) const
+		{
+			for (size_t i = 0; i < packet.Size(); i++)
+			{
+				out_objects[i] = nullptr;
+				if (!IntersectsRay(packet[i], out_intersections[i], out_objects[i]))
+				{
+					out_objects[i] = nullptr;
+				}
+			}
+		}
+	};
+}
@@ -5,13 +5,30 @@
 #include "Ray.h"
 #include "Intersection.h"
 #include "IMaterial.h"
+#include "BoundingBox.h"
 
 namespace RayTracer
 {
 	class IIntersectable
 	{
 	public:
+		// Closest hit no farther than incoming_ray.MaxDepth()
 		virtual bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info) const = 0;
+
+		// Any-hit visibility query: true when the ray hits the object closer than max_depth, measured
+		// along the normalized direction like Intersection::Depth(). Objects override it to skip building
+		// the intersection and stop at the first hit instead of looking for the closest one.
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const
+		{
+			// A copy, so the query leaves the caller's depth interval alone
+			Ray limited_ray(incoming_ray);
+			limited_ray.SetMaxDepth(max_depth);
+
+			Intersection intersection;
+			return IntersectsRay(limited_ray, intersection) && intersection.Depth() < max_depth;
+		}
+
 		virtual const std::shared_ptr<const IMaterial> Material() const = 0;
+		virtual BoundingBox Bounds() const = 0;
 	};
 }
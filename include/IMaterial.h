@@ -4,6 +4,7 @@
 #include "Color.h"
 #include "Intersection.h"
 #include "Ray.h"
+#include "Random.h"
 
 namespace RayTracer
 {
@@ -12,6 +13,7 @@ namespace RayTracer
 	public:
 		virtual const Color SurfaceColor() const = 0; // TODO: This should be part of GetResultantRay
 		virtual float Roughness() const = 0; // TODO: This is not applicable to all materials
-		virtual void GetResultantRay(const Intersection &intersection, const Ray &incoming_ray, Ray &outgoing_ray) const = 0;
+		// random is the generator of the path's current bounce
+		virtual void GetResultantRay(const Intersection &intersection, const Ray &incoming_ray, Ray &outgoing_ray, PCG32 &random) const = 0;
 	};
 }
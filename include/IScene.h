@@ -12,5 +12,20 @@ namespace RayTracer
 	public:
 		virtual const std::vector<const IIntersectable*> &Objects() const = 0;
 		virtual const IWorld *World() const = 0;
+
+		// True when any object is hit closer than max_depth. Every object is tested, renderers ask their
+		// acceleration structure instead.
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const
+		{
+			for (const auto &object : Objects())
+			{
+				if (object->Occluded(incoming_ray, max_depth))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "Intersection.h"
+#include "Ray.h"
+#include "Vector3.h"
+#include "TraversalHierarchy.h"
+#include "TriangleArray.h"
+
+#include <cmath>
+#include <vector>
+
+namespace RayTracer
+{
+	// Triangle data and its bottom-level BVH, shared between every Mesh or MeshInstance that uses it
+	class MeshGeometry
+	{
+	public:
+		MeshGeometry(const std::vector<Vector3<float>> &vertices, const std::vector<Vector3<size_t>> &face_vertex_indices,
+			const BVHBuildOptions &options = BVHBuildOptions())
+			: VertexIndices(face_vertex_indices), vertex_data(vertices), build_options(options)
+		{
+			ValidateFaces();
+
+			// The pool is only borrowed for the build
+			build_options.Pool = nullptr;
+			Build(options);
+		}
+
+		// Adopts a BVH that was built over these faces with the same options earlier, e.g. one loaded
+		// from an AccelerationStructureCache, instead of building it again
+		MeshGeometry(const std::vector<Vector3<float>> &vertices, const std::vector<Vector3<size_t>> &face_vertex_indices,
+			BVH &&hierarchy, const BVHBuildOptions &options = BVHBuildOptions())
+			: VertexIndices(face_vertex_indices), vertex_data(vertices), build_options(options)
+		{
+			ValidateFaces();
+			build_options.Pool = nullptr;
+
+			for (const auto &index : hierarchy.PrimitiveIndices())
+			{
+				if (index >= VertexIndices.size())
+				{
+					throw std::exception("BVH references a face that does not exist");
+				}
+			}
+
+			// Only the bounds are needed, the BVH already exists
+			CreateFaces();
+			bvh = TraversalHierarchy(std::move(hierarchy), options);
+			StoreFaces();
+		}
+
+		// Moves the vertices of a deformed mesh with unchanged topology. The BVH is refit to the new
+		// triangles and only rebuilt once the refit tree has degraded past the options' RefitRebuildThreshold.
+		// Returns true when the BVH was rebuilt. Instances using this geometry pick up the new bounds the
+		// next time their top-level hierarchy is updated.
+		bool UpdateVertices(const std::vector<Vector3<float>> &vertices, ThreadPool *pool = nullptr)
+		{
+			if (vertices.size() != vertex_data.size())
+			{
+				throw std::exception("Updated vertices must match the existing vertex count");
+			}
+
+			vertex_data = vertices;
+
+			std::vector<BoundingBox> slot_bounds;
+			slot_bounds.reserve(triangles.Size());
+			bounds = BoundingBox();
+			for (size_t slot = 0; slot < triangles.Size(); slot++)
+			{
+				const Vector3<size_t> &indicies = VertexIndices[bvh.PrimitiveIndices()[slot]];
+				triangles.Set(slot, vertex_data[indicies.X], vertex_data[indicies.Y], vertex_data[indicies.Z]);
+				slot_bounds.emplace_back(MeshTriangleFace(vertex_data[indicies.X], vertex_data[indicies.Y], vertex_data[indicies.Z]).Bounds());
+				bounds.Expand(slot_bounds.back());
+			}
+
+			bvh.Refit(slot_bounds, pool);
+			if (!bvh.NeedsRebuild(build_options.RefitRebuildThreshold))
+			{
+				return false;
+			}
+
+			BVHBuildOptions options = build_options;
+			options.Pool = pool;
+			Build(options);
+			return true;
+		}
+
+		// The ray is in the geometry's own (object) space. Faces beyond the ray's MaxDepth() are skipped,
+		// see IIntersectable::IntersectsRay.
+		bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info) const
+		{
+			// The triangle test rejects hits at max_depth, a hit at the ray's MaxDepth() still counts
+			float max_depth = std::nextafter(incoming_ray.MaxDepth(), std::numeric_limits<float>::infinity());
+
+			const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+			const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+			const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+			uint32_t closest_slot = 0;
+			bool intersection_found = IntersectTriangles(incoming_ray, origin, direction, false, max_depth, closest_slot);
+
+			// Only the closest hit pays for building the intersection
+			if (intersection_found)
+			{
+				out_intersection_info = Intersection(max_depth, triangles.Normal(closest_slot), incoming_ray.Origin() + direction_vector * max_depth);
+			}
+
+			return intersection_found;
+		}
+
+		// Any-hit version of IntersectsRay, the traversal ends at the first leaf with a hit closer than max_depth
+		bool Occluded(const Ray &incoming_ray, float max_depth) const
+		{
+			const Vector3<float> &direction_vector = incoming_ray.NormalizedDirection();
+			const float origin[3] = { incoming_ray.Origin().X, incoming_ray.Origin().Y, incoming_ray.Origin().Z };
+			const float direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+			uint32_t hit_slot = 0;
+			return IntersectTriangles(incoming_ray, origin, direction, true, max_depth, hit_slot);
+		}
+
+		BoundingBox Bounds() const
+		{
+			return bounds;
+		}
+
+		const BVH &Hierarchy() const
+		{
+			return bvh.Binary();
+		}
+
+		// Size of the nodes rays traverse, see TraversalHierarchy::MemoryBytes
+		size_t HierarchyMemoryBytes() const
+		{
+			return bvh.MemoryBytes();
+		}
+
+		const std::vector<Vector3<float>> &VertexData() const
+		{
+			return vertex_data;
+		}
+
+		const std::vector<Vector3<size_t>> VertexIndices;
+
+	private:
+		MeshGeometry(const MeshGeometry &) = delete;
+
+		class MeshTriangleFace;
+
+		void ValidateFaces() const
+		{
+			for (const auto &indicies : VertexIndices)
+			{
+				if (indicies.X >= vertex_data.size() || indicies.Y >= vertex_data.size() || indicies.Z >= vertex_data.size())
+				{
+					throw std::exception("Face vertex indices are out-of-bounds of provided vertices");
+				}
+			}
+		}
+
+		// Faces in VertexIndices order, also recomputes the geometry bounds
+		std::vector<MeshTriangleFace> CreateFaces()
+		{
+			std::vector<MeshTriangleFace> unordered_faces;
+			unordered_faces.reserve(VertexIndices.size());
+			bounds = BoundingBox();
+
+			for (const auto &indicies : VertexIndices)
+			{
+				unordered_faces.emplace_back(MeshTriangleFace(vertex_data[indicies.X], vertex_data[indicies.Y], vertex_data[indicies.Z]));
+				bounds.Expand(unordered_faces.back().Bounds());
+			}
+
+			return unordered_faces;
+		}
+
+		// Store the faces in the order the BVH leaves reference them, faces split by the SBVH are stored once per slot
+		void StoreFaces()
+		{
+			triangles = TriangleArray(bvh.PrimitiveIndices().size(), build_options.WatertightTriangles);
+			for (size_t slot = 0; slot < triangles.Size(); slot++)
+			{
+				const Vector3<size_t> &indicies = VertexIndices[bvh.PrimitiveIndices()[slot]];
+				triangles.Set(slot, vertex_data[indicies.X], vertex_data[indicies.Y], vertex_data[indicies.Z]);
+			}
+		}
+
+		// Closest hit closer than max_depth, or with any_hit the first one found. The triangle test the mesh
+		// was built for is picked once per ray rather than once per leaf.
+		bool IntersectTriangles(const Ray &incoming_ray, const float origin[3], const float direction[3], bool any_hit, float &max_depth, uint32_t &out_slot) const
+		{
+			if (triangles.Watertight())
+			{
+				const TriangleArray::WatertightRay watertight_ray(origin, direction, incoming_ray.DominantAxis());
+				return TraverseTriangles(incoming_ray, any_hit, max_depth, [&](uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+					{
+						return triangles.IntersectsRayWatertight(watertight_ray, first_slot, slot_count, current_max_depth, out_slot);
+					});
+			}
+
+			return TraverseTriangles(incoming_ray, any_hit, max_depth, [&](uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+				{
+					return triangles.IntersectsRay(origin, direction, first_slot, slot_count, current_max_depth, out_slot);
+				});
+		}
+
+		// Every leaf is tested as one batch of triangles
+		template <class LeafTest>
+		bool TraverseTriangles(const Ray &incoming_ray, bool any_hit, float &max_depth, LeafTest &&leaf_test) const
+		{
+			auto intersect_leaf = [&](uint32_t first_slot, uint32_t slot_count, float &current_max_depth)
+			{
+				if (!leaf_test(first_slot, slot_count, current_max_depth))
+				{
+					return false;
+				}
+
+				if (any_hit)
+				{
+					current_max_depth = BVH::StopTraversal;
+				}
+				return true;
+			};
+
+			// Meshes that fit in a single batch are cheaper to test whole than through the BVH
+			return triangles.Size() <= TriangleArray::BatchWidth ?
+				intersect_leaf(0, static_cast<uint32_t>(triangles.Size()), max_depth) :
+				bvh.Traverse(incoming_ray, max_depth, intersect_leaf);
+		}
+
+		void Build(const BVHBuildOptions &options)
+		{
+			std::vector<MeshTriangleFace> unordered_faces = CreateFaces();
+			std::vector<BoundingBox> face_bounds;
+			face_bounds.reserve(unordered_faces.size());
+			for (const auto &face : unordered_faces)
+			{
+				face_bounds.emplace_back(face.Bounds());
+			}
+
+			bvh = TraversalHierarchy(face_bounds, options, [&unordered_faces](uint32_t index, const BoundingBox &clip_bounds)
+				{
+					return unordered_faces[index].ClippedBounds(clip_bounds);
+				});
+			StoreFaces();
+		}
+
+		std::vector<Vector3<float>> vertex_data;
+		BVHBuildOptions build_options;
+
+		BoundingBox bounds;
+
+		// Build time view of a face, rays are tested against the TriangleArray instead
+		class MeshTriangleFace
+		{
+		public:
+			MeshTriangleFace(const Vector3<float> &vertex_1, const Vector3<float> &vertex_2, const Vector3<float> &vertex_3)
+			{
+				const Vector3<float> *face_vertices[3] = { &vertex_1, &vertex_2, &vertex_3 };
+				for (size_t i = 0; i < 3; i++)
+				{
+					vertices[i][0] = face_vertices[i]->X;
+					vertices[i][1] = face_vertices[i]->Y;
+					vertices[i][2] = face_vertices[i]->Z;
+				}
+			}
+
+			BoundingBox Bounds() const
+			{
+				BoundingBox face_bounds;
+				for (size_t i = 0; i < 3; i++)
+				{
+					face_bounds.Expand(Vector3<float>(vertices[i][0], vertices[i][1], vertices[i][2]));
+				}
+
+				return face_bounds;
+			}
+
+			// Bounds of the part of the triangle inside clip_bounds. The triangle is clipped as a polygon
+			// against both planes of each slab, which adds at most one vertex per plane.
+			BoundingBox ClippedBounds(const BoundingBox &clip_bounds) const
+			{
+				float polygon[9][3];
+				float clipped[9][3];
+				size_t vertex_count = 3;
+				std::copy(&vertices[0][0], &vertices[0][0] + 9, &polygon[0][0]);
+
+				for (int plane = 0; plane < 6 && vertex_count > 0; plane++)
+				{
+					const int axis = plane % 3;
+					const bool keep_above = plane < 3;
+					const float position = keep_above ? clip_bounds.min[axis] : clip_bounds.max[axis];
+					auto inside = [&](const float *point) { return keep_above ? point[axis] >= position : point[axis] <= position; };
+
+					size_t clipped_count = 0;
+					for (size_t i = 0; i < vertex_count; i++)
+					{
+						const float *current = polygon[i];
+						const float *next = polygon[(i + 1) % vertex_count];
+						if (inside(current))
+						{
+							std::copy(current, current + 3, clipped[clipped_count++]);
+						}
+
+						if (inside(current) != inside(next))
+						{
+							const float t = (position - current[axis]) / (next[axis] - current[axis]);
+							float *crossing = clipped[clipped_count++];
+							for (int component = 0; component < 3; component++)
+							{
+								crossing[component] = current[component] + (next[component] - current[component]) * t;
+							}
+
+							crossing[axis] = position;
+						}
+					}
+
+					vertex_count = clipped_count;
+					std::copy(&clipped[0][0], &clipped[0][0] + 3 * clipped_count, &polygon[0][0]);
+				}
+
+				BoundingBox clipped_bounds;
+				for (size_t i = 0; i < vertex_count; i++)
+				{
+					clipped_bounds.Expand(Vector3<float>(polygon[i][0], polygon[i][1], polygon[i][2]));
+				}
+
+				return clipped_bounds.Overlap(clip_bounds);
+			}
+
+		private:
+			float vertices[3][3];
+		};
+
+		TriangleArray triangles;
+		TraversalHierarchy bvh;
+	};
+}
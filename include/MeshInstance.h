@@ -0,0 +1,92 @@
+#pragma once
+
+#include "IIntersectable.h"
+#include "MeshGeometry.h"
+#include "Transform.h"
+
+namespace RayTracer
+{
+	// A placement of shared MeshGeometry in the scene. Only the transform and material are stored
+	// per instance, the triangles and their BVH live once in the geometry.
+	class MeshInstance : public IIntersectable
+	{
+	public:
+		MeshInstance(std::shared_ptr<const IMaterial> material, std::shared_ptr<const MeshGeometry> geometry, const Transform &object_to_world)
+			: material(material), geometry(geometry)
+		{
+			SetTransform(object_to_world);
+		}
+
+		virtual bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info) const override
+		{
+			// Intersect in object space so the geometry's BVH can be reused as-is
+			const Vector3<float> object_direction = world_to_object.TransformVector(incoming_ray.NormalizedDirection());
+			Ray object_ray(world_to_object.TransformPoint(incoming_ray.Origin()), object_direction, incoming_ray.RayColor());
+
+			// The depth limit scales like the direction. It is padded for the rounding of the transform,
+			// the world space depth below is checked exactly.
+			object_ray.SetMaxDepth(incoming_ray.MaxDepth() * sqrt(object_direction.MagnitudeSquared()) * (1.0f + 1e-5f));
+
+			Intersection object_intersection;
+			if (!geometry->IntersectsRay(object_ray, object_intersection))
+			{
+				return false;
+			}
+
+			Vector3<float> location = object_to_world.TransformPoint(object_intersection.Location());
+			Vector3<float> normal = world_to_object.TransformNormalWithInverse(object_intersection.Normal());
+			float depth = sqrt((location - incoming_ray.Origin()).MagnitudeSquared());
+			if (depth > incoming_ray.MaxDepth())
+			{
+				return false;
+			}
+
+			out_intersection_info = Intersection(depth, normal, location);
+			return true;
+		}
+
+		virtual bool Occluded(const Ray &incoming_ray, float max_depth) const override
+		{
+			// Depths are measured along the normalized direction, so max_depth is scaled by the length
+			// the transform gives a unit world direction
+			const Vector3<float> object_direction = world_to_object.TransformVector(incoming_ray.NormalizedDirection());
+			Ray object_ray(world_to_object.TransformPoint(incoming_ray.Origin()), object_direction, incoming_ray.RayColor());
+
+			return geometry->Occluded(object_ray, max_depth * sqrt(object_direction.MagnitudeSquared()));
+		}
+
+		virtual const std::shared_ptr<const IMaterial> Material() const override
+		{
+			return material;
+		}
+
+		// Computed on demand so moved instances and deformed geometry are both reflected
+		virtual BoundingBox Bounds() const override
+		{
+			return object_to_world.TransformBounds(geometry->Bounds());
+		}
+
+		// Moving an instance only changes its bounds, the top-level BVH has to be refit or rebuilt afterwards
+		void SetTransform(const Transform &object_to_world)
+		{
+			this->object_to_world = object_to_world;
+			world_to_object = object_to_world.Inverse();
+		}
+
+		const Transform &ObjectToWorld() const
+		{
+			return object_to_world;
+		}
+
+		const MeshGeometry &Geometry() const
+		{
+			return *geometry;
+		}
+
+	private:
+		std::shared_ptr<const IMaterial> material;
+		std::shared_ptr<const MeshGeometry> geometry;
+		Transform object_to_world;
+		Transform world_to_object;
+	};
+}
@@ -49,6 +49,19 @@ namespace RayTracer::PerformanceTracking
 			stream.close();
 		}
 
+		// Records a set of named values as a counter event, e.g. build statistics
+		void AddCounterEntry(const std::string &name, const std::vector<std::pair<std::string, double>> &values)
+		{
+			long long now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+			std::string args;
+			for (const auto &value : values)
+			{
+				args += (args.empty() ? "\"" : ", \"") + value.first + "\": " + std::to_string(value.second);
+			}
+
+			AddPerformanceEntry(std::move("{\"name\": \"" + name + "\", \"cat\": \"PERF\", \"ph\": \"C\", \"pid\" : 0, \"ts\": " + std::to_string(now) + ", \"args\": {" + args + "}}"));
+		}
+
 	private:
 		void AddPerformanceEntry(std::string &&message)
 		{
@@ -89,4 +102,5 @@ namespace RayTracer::PerformanceTracking
 
 #define TRACE_SCOPE(performance_session_unique_ptr, name) RayTracer::PerformanceTracking::PerformanceSection perf_section_ ## name(performance_session, # name)
 #define TRACE_FUNCTION(performance_session_unique_ptr) RayTracer::PerformanceTracking::PerformanceSection perf_function(performance_session, __FUNCTION__)
+#define TRACE_COUNTERS(performance_session_unique_ptr, name, ...) do { if (performance_session_unique_ptr) { performance_session_unique_ptr->AddCounterEntry(name, __VA_ARGS__); } } while(0)
 
@@ -4,6 +4,7 @@
 #include "Vector3.h"
 #include "IIntersectable.h"
 #include "Ray.h"
+#include "Random.h"
 #include <vector>
 
 namespace RayTracer
@@ -78,11 +79,11 @@ namespace RayTracer
 			return centralRayDirection;
 		}
 
-		Ray GetNextRay()
+		Ray GetNextRay(PCG32 &random)
 		{
-			//Get 2 random floats -0.5 <= float <= 0.5
-			float random1 = (float)(rand() - (RAND_MAX / 2)) / RAND_MAX;
-			float random2 = (float)(rand() - (RAND_MAX / 2)) / RAND_MAX;
+			//Get 2 random floats -0.5 <= float < 0.5
+			float random1 = random.NextFloat() - 0.5f;
+			float random2 = random.NextFloat() - 0.5f;
 
 			Vector3<float> jitteredRayDirection = centralRayDirection + (rightVector * random1 * widthM) + (upVector * random2 * heightM);
 
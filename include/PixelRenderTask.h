@@ -1,23 +1,40 @@
 #pragma once
 
 #include "ThreadPool.h"
-#include "Pixel.h"
+#include "Camera.h"
 #include "Scene.h"
 #include "Ray.h"
-#include "IImage.h"
+#include "FrameBuffer.h"
+#include "IAccelerationStructure.h"
 
 namespace RayTracer
 {
 	class PixelRenderTask : public ThreadPool::IThreadPoolTask
 	{
 	public:
-		PixelRenderTask(Pixel &pixel, unsigned int samples, 
-			const IScene &scene, std::shared_ptr<IImage> out_image);
+		PixelRenderTask(const Camera &camera, size_t x, size_t y, unsigned int samples, const IScene &scene,
+			const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer);
 		void Execute() override;
+
+		// Bounces after which a path stops and takes the world's ambient color
+		static constexpr unsigned int MaxBounces = 10;
+
+		// Follows a path from the first surface its ray hit (closest_object is null for a miss) until it
+		// leaves the scene or runs out of bounces, accumulating the color into the ray. The materials draw
+		// from the generators of the sample of the pixel at pixel_index.
+		static void TracePath(Ray &ray, Intersection closest_intersection, const IIntersectable *closest_object,
+			uint32_t pixel_index, unsigned int sample, const IScene &scene, const IAccelerationStructure &acceleration_structure);
+
+		// Intersects a camera ray on its own and follows its path, rays without a direction keep their color
+		static void TraceRay(Ray &ray, uint32_t pixel_index, unsigned int sample, const IScene &scene,
+			const IAccelerationStructure &acceleration_structure);
 	private:
-		Pixel &pixel;
+		const Camera &camera;
+		size_t x;
+		size_t y;
 		unsigned int samples;
 		const IScene &scene;
-		std::shared_ptr<IImage> out_image;
+		const IAccelerationStructure &acceleration_structure;
+		FrameBuffer &frame_buffer;
 	};
 }
\ No newline at end of file
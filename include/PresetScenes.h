@@ -8,6 +8,7 @@
 #include "DiffuseBSDF.h"
 #include "Sphere.h"
 #include "Mesh.h"
+#include "MeshInstance.h"
 
 namespace RayTracer
 {
@@ -83,13 +84,11 @@ namespace RayTracer
         out_scene = scene;
 	}
 
-    static void CreatePresetSceneCube(IScene *&out_scene, Camera *&out_camera, ImageResolution resolution)
+    static std::shared_ptr<const MeshGeometry> CreateCubeGeometry()
     {
-        out_camera = new Camera(resolution, Vector3<float>(-1, 1, 1), Vector3<float>(1, -1, -1), 50, 18);
-        Scene *scene = new Scene();
-
         // This is a cube
-        scene->AddObject(new Mesh(std::make_shared<const DiffuseBSDF>(Color(1.0f, 0, 0, 1), 0.1f),
+        return std::make_shared<const MeshGeometry>(
+            std::vector<Vector3<float>>
             {
                 Vector3<float>(-0.25f, -0.25f, 0.25f), //  [0] : bottom-left front
                 Vector3<float>(0.25f, -0.25f, 0.25f), //   [1] : bottom-right front
@@ -100,6 +99,7 @@ namespace RayTracer
                 Vector3<float>(-0.25f, 0.25f, -0.25f), //  [6] : top-left back
                 Vector3<float>(0.25f, 0.25f, -0.25f), //   [7] : top-right back
             },
+            std::vector<Vector3<size_t>>
             {
                 Vector3<size_t>(0, 1, 2), // bottom-front
                 Vector3<size_t>(2, 1, 3), // top-front
@@ -113,7 +113,15 @@ namespace RayTracer
                 Vector3<size_t>(3, 7, 6), // back-top
                 Vector3<size_t>(1, 0, 4), // front-bottom
                 Vector3<size_t>(4, 5, 1), // back-bottom
-            }));
+            });
+    }
+
+    static void CreatePresetSceneCube(IScene *&out_scene, Camera *&out_camera, ImageResolution resolution)
+    {
+        out_camera = new Camera(resolution, Vector3<float>(-1, 1, 1), Vector3<float>(1, -1, -1), 50, 18);
+        Scene *scene = new Scene();
+
+        scene->AddObject(new Mesh(std::make_shared<const DiffuseBSDF>(Color(1.0f, 0, 0, 1), 0.1f), CreateCubeGeometry()));
         // Add a sphere inside the cube (that won't be seen)
         scene->AddObject(new Sphere(Vector3<float>(), 0.2f, std::make_shared<const EmissiveBSDF>(RandomColor(), 10.0f)));
         // Add a sphere behind the cube
@@ -123,4 +131,29 @@ namespace RayTracer
 
         out_scene = scene;
     }
+
+    static void CreatePresetSceneInstancedCubes(IScene *&out_scene, Camera *&out_camera, ImageResolution resolution)
+    {
+        const int cube_array_count = 20;
+
+        out_camera = new Camera(resolution, Vector3<float>(-4, 6, cube_array_count / 2.0f), Vector3<float>(1, -0.5f, 0), 50, 18);
+        Scene *scene = new Scene();
+
+        // Every cube shares one geometry and its BVH, each instance only adds a transform and a material
+        std::shared_ptr<const MeshGeometry> cube = CreateCubeGeometry();
+        for (int i = 0; i < cube_array_count; i++)
+        {
+            for (int j = 0; j < cube_array_count; j++)
+            {
+                Transform transform = Transform::Translation(Vector3<float>((float)i, 0, (float)j)) *
+                    Transform::Rotation(1, (float)(i * cube_array_count + j)) *
+                    Transform::Scale(Vector3<float>(1.0f, 1.0f + (float)((i + j) % 4), 1.0f));
+                scene->AddObject(new MeshInstance(std::make_shared<const DiffuseBSDF>(RandomColor(), RandomRoughness(0.1f, 0.9f)), cube, transform));
+            }
+        }
+
+        scene->AddObject(new Sphere(Vector3<float>(cube_array_count / 2.0f, 8, cube_array_count / 2.0f), 2.0f, std::make_shared<const EmissiveBSDF>(Color(1.0f, 1.0f, 1.0f, 1.0f), 10.0f)));
+
+        out_scene = scene;
+    }
 }
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "BVH.h"
+#include "WideBVH.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace RayTracer
+{
+	// Memory-compact 4 wide BVH for scenes whose hierarchy no longer fits in cache. Every node is
+	// one 64-byte cache line: the node box is stored at full precision and the child boxes as 8-bit
+	// offsets inside it, in steps of a power of two per axis. Child boxes are rounded outwards so
+	// they stay conservative. Collapsed from a binary BVH like WideBVH and traversed the same way.
+	class QuantizedBVH
+	{
+	public:
+		static constexpr size_t Width = 4;
+		static constexpr uint32_t EmptyChild = WideBVH<Width>::EmptyChild;
+
+		struct alignas(64) Node
+		{
+			// Minimum corner of the node box, the origin of the quantized child boxes
+			float origin[3];
+			// Interior children: index of the child node. Leaf children: first primitive slot. Unused: EmptyChild
+			uint32_t child[Width];
+			// Rows are min x, min y, min z, max x, max y, max z, columns are children
+			uint8_t quantized_bounds[6][Width];
+			// One quantization step along each axis is 2^scale_exponent
+			int8_t scale_exponent[3];
+			// Zero for interior children
+			uint8_t primitive_count[Width];
+		};
+
+		static_assert(sizeof(Node) == 64, "Quantized nodes must fill exactly one cache line");
+
+		QuantizedBVH() = default;
+		explicit QuantizedBVH(const BVH &binary);
+
+		// Requantizes the child boxes from a refit binary BVH, which must be the one this tree was built from
+		void Refit(const BVH &binary);
+
+		const std::vector<Node> &Nodes() const
+		{
+			return nodes;
+		}
+
+		bool Empty() const
+		{
+			return nodes.empty();
+		}
+
+		size_t MemoryBytes() const
+		{
+			return nodes.size() * sizeof(Node);
+		}
+
+		// Decoded box of one child, for validation
+		BoundingBox ChildBounds(const Node &node, size_t child_index) const;
+
+		// Same contract as BVH::Traverse
+		template <class PrimitiveIntersector>
+		bool Traverse(const Ray &ray, float &max_depth, PrimitiveIntersector &&intersect_primitive) const
+		{
+			if (nodes.empty())
+			{
+				return false;
+			}
+
+			const float origin[3] = { ray.Origin().X, ray.Origin().Y, ray.Origin().Z };
+			const float *inverse_direction = ray.InverseDirection();
+
+			struct StackEntry
+			{
+				uint32_t child;
+				uint32_t primitive_count;
+				float entry_depth;
+			};
+
+			StackEntry stack[(Width - 1) * BVH::MaxDepth + 1];
+			size_t stack_size = 0;
+			stack[stack_size++] = { 0, 0, 0.0f };
+			bool intersection_found = false;
+
+			while (stack_size > 0)
+			{
+				const StackEntry entry = stack[--stack_size];
+				if (entry.entry_depth > max_depth)
+				{
+					continue;
+				}
+
+				if (entry.primitive_count > 0)
+				{
+					if (BVH::IntersectLeaf(intersect_primitive, entry.child, entry.primitive_count, max_depth))
+					{
+						intersection_found = true;
+					}
+
+					continue;
+				}
+
+				const Node &node = nodes[entry.child];
+				float entry_depths[Width];
+				uint32_t hit_mask = IntersectChildren(node, origin, inverse_direction, max_depth, entry_depths);
+
+				// Push the hit children farthest first so the nearest one is popped next
+				const size_t first_pushed = stack_size;
+				while (0 != hit_mask)
+				{
+					const int child_index = std::countr_zero(hit_mask);
+					hit_mask &= hit_mask - 1;
+					if (EmptyChild == node.child[child_index])
+					{
+						continue;
+					}
+
+					StackEntry child_entry = { node.child[child_index], node.primitive_count[child_index], entry_depths[child_index] };
+					size_t position = stack_size++;
+					while (position > first_pushed && stack[position - 1].entry_depth < child_entry.entry_depth)
+					{
+						stack[position] = stack[position - 1];
+						position--;
+					}
+
+					stack[position] = child_entry;
+				}
+			}
+
+			return intersection_found;
+		}
+
+	private:
+		// 2^exponent built directly from the float bits, exponents are kept in the normal range
+		static float ScaleFromExponent(int8_t exponent)
+		{
+			uint32_t bits = static_cast<uint32_t>(exponent + 127) << 23;
+			float scale;
+			std::memcpy(&scale, &bits, sizeof(scale));
+			return scale;
+		}
+
+		// Dequantizing is folded into the slab test: t = (origin - ray origin) / d + q * (step / d)
+		static uint32_t IntersectChildren(const Node &node, const float origin[3], const float inverse_direction[3], float max_depth, float out_entry_depths[Width])
+		{
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+			const __m128i zero = _mm_setzero_si128();
+			__m128 near_depth = _mm_setzero_ps();
+			__m128 far_depth = _mm_set1_ps(max_depth);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int32_t packed_min;
+				int32_t packed_max;
+				std::memcpy(&packed_min, node.quantized_bounds[axis], sizeof(packed_min));
+				std::memcpy(&packed_max, node.quantized_bounds[axis + 3], sizeof(packed_max));
+				const __m128 quantized_min = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed_min), zero), zero));
+				const __m128 quantized_max = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed_max), zero), zero));
+
+				const __m128 base = _mm_set1_ps((node.origin[axis] - origin[axis]) * inverse_direction[axis]);
+				const __m128 step = _mm_set1_ps(ScaleFromExponent(node.scale_exponent[axis]) * inverse_direction[axis]);
+				const __m128 t0 = _mm_add_ps(base, _mm_mul_ps(quantized_min, step));
+				const __m128 t1 = _mm_add_ps(base, _mm_mul_ps(quantized_max, step));
+				// Operand order makes NaNs (origin on a slab with a zero direction) leave the depths alone
+				near_depth = _mm_max_ps(_mm_min_ps(t1, t0), near_depth);
+				far_depth = _mm_min_ps(_mm_mul_ps(_mm_max_ps(t1, t0), _mm_set1_ps(BoundingBox::RobustExitScale)), far_depth);
+			}
+
+			_mm_storeu_ps(out_entry_depths, near_depth);
+			return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(near_depth, far_depth)));
+#else
+			uint32_t hit_mask = 0;
+			for (size_t child_index = 0; child_index < Width; child_index++)
+			{
+				float near_depth = 0.0f;
+				float far_depth = max_depth;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float base = (node.origin[axis] - origin[axis]) * inverse_direction[axis];
+					float step = ScaleFromExponent(node.scale_exponent[axis]) * inverse_direction[axis];
+					float t0 = base + node.quantized_bounds[axis][child_index] * step;
+					float t1 = base + node.quantized_bounds[axis + 3][child_index] * step;
+					if (t0 > t1)
+					{
+						std::swap(t0, t1);
+					}
+
+					t1 *= BoundingBox::RobustExitScale;
+					near_depth = t0 > near_depth ? t0 : near_depth;
+					far_depth = t1 < far_depth ? t1 : far_depth;
+				}
+
+				out_entry_depths[child_index] = near_depth;
+				hit_mask |= near_depth <= far_depth ? (1u << child_index) : 0u;
+			}
+
+			return hit_mask;
+#endif
+		}
+
+		void QuantizeNode(Node &node, const BoundingBox child_bounds[Width]);
+
+		std::vector<Node> nodes;
+		// Binary node each child was collapsed from, Width entries per node, EmptyChild for unused children
+		std::vector<uint32_t> source_nodes;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace RayTracer
+{
+	// PCG32 generator (64 bit linear congruential state, permuted 32 bit output), see https://www.pcg-random.org.
+	// Its whole state is two integers, so every path can seed its own instead of sharing the global rand() state.
+	class PCG32
+	{
+	public:
+		// sequence picks one of 2^63 independent streams, seed the starting point on it
+		PCG32(uint64_t seed, uint64_t sequence = 0) : state(0), increment((sequence << 1) | 1)
+		{
+			NextUInt();
+			state += seed;
+			NextUInt();
+		}
+
+		// Generator of the draws made at one vertex of a sample's path, bounce 0 is the camera ray. The draws
+		// only depend on the pixel, the sample and the bounce, not on the thread tracing the path, the order of
+		// the paths or the number of draws made at the other vertices.
+		static PCG32 ForPath(uint32_t pixel_index, uint32_t sample, uint32_t bounce)
+		{
+			// The first outputs only depend on the high bits of the seed, so the pixel and sample are mixed
+			// over all of them with the SplitMix64 finalizer
+			uint64_t seed = ((static_cast<uint64_t>(pixel_index) << 32) | sample) + 0x9e3779b97f4a7c15ULL;
+			seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+			seed ^= seed >> 31;
+
+			return PCG32(seed, bounce);
+		}
+
+		uint32_t NextUInt()
+		{
+			const uint64_t previous_state = state;
+			state = previous_state * 6364136223846793005ULL + increment;
+
+			const uint32_t xor_shifted = static_cast<uint32_t>(((previous_state >> 18) ^ previous_state) >> 27);
+			const uint32_t rotation = static_cast<uint32_t>(previous_state >> 59);
+			return (xor_shifted >> rotation) | (xor_shifted << ((32 - rotation) & 31));
+		}
+
+		// 0 <= float < 1, from the top 24 bits so every value is exactly representable
+		float NextFloat()
+		{
+			return static_cast<float>(NextUInt() >> 8) / static_cast<float>(1 << 24);
+		}
+	private:
+		uint64_t state;
+		uint64_t increment;
+	};
+}
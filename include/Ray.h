@@ -3,6 +3,10 @@
 #include "Vector3.h"
 #include "Color.h"
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
 namespace RayTracer
 {
 	class Ray
@@ -11,12 +15,44 @@ namespace RayTracer
 		Vector3<float> origin;
 		Vector3<float> direction;
 		Color ray_color;
+		mutable float max_depth;
+
+		// Derived from the direction whenever it is set, so intersection and traversal code reads them
+		// instead of recomputing them for every object and node
+		Vector3<float> normalized_direction;
+		float inverse_direction[3];
+		uint32_t octant;
+		uint32_t dominant_axis;
+
+		void PrepareDirection()
+		{
+			normalized_direction = direction.Normalize();
+			const float components[3] = { normalized_direction.X, normalized_direction.Y, normalized_direction.Z };
+
+			octant = 0;
+			dominant_axis = 0;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				inverse_direction[axis] = 1.0f / components[axis];
+				octant |= std::signbit(components[axis]) ? 1u << axis : 0u;
+				if (std::fabs(components[axis]) > std::fabs(components[dominant_axis]))
+				{
+					dominant_axis = axis;
+				}
+			}
+		}
 
 	public:
 		Ray(const Vector3<float> &origin, const Vector3<float> &direction, const Color &color) : 
-			origin(origin), direction(direction), ray_color(color) {}
-		Ray() :origin(), direction(), ray_color() {}
-		Ray(const Ray &ray) : origin(ray.origin), direction(ray.direction) {}
+			origin(origin), direction(direction), ray_color(color), max_depth(std::numeric_limits<float>::infinity())
+		{
+			PrepareDirection();
+		}
+		Ray() :origin(), direction(), ray_color(), max_depth(std::numeric_limits<float>::infinity())
+		{
+			PrepareDirection();
+		}
+		Ray(const Ray &) = default;
 
 		const Vector3<float> &Origin() const
 		{
@@ -28,6 +64,30 @@ namespace RayTracer
 			return direction;
 		}
 
+		// Depths along the ray are measured in units of this direction
+		const Vector3<float> &NormalizedDirection() const
+		{
+			return normalized_direction;
+		}
+
+		// Reciprocal of the normalized direction, for slab tests
+		const float *InverseDirection() const
+		{
+			return inverse_direction;
+		}
+
+		// Bit i is set when component i of the direction is negative
+		uint32_t Octant() const
+		{
+			return octant;
+		}
+
+		// Axis of the largest direction component, the first one on ties
+		uint32_t DominantAxis() const
+		{
+			return dominant_axis;
+		}
+
 		const Color &RayColor() const
 		{
 			return ray_color;
@@ -36,11 +96,26 @@ namespace RayTracer
 		void SetDirection(const Vector3<float> &direction)
 		{
 			this->direction = direction;
+			PrepareDirection();
 		}
 
 		void SetColor(const Color &color)
 		{
 			ray_color = color;
 		}
+
+		// Farthest depth, along the normalized direction, at which IntersectsRay still reports a hit. The
+		// acceleration structures lower it to the closest hit so far while they test objects, so those can
+		// reject anything farther early on. Mutable because the intersection interfaces take the ray by const
+		// reference.
+		float MaxDepth() const
+		{
+			return max_depth;
+		}
+
+		void SetMaxDepth(float depth) const
+		{
+			max_depth = depth;
+		}
 	};
 }
\ No newline at end of file
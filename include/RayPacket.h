@@ -0,0 +1,150 @@
+#pragma once
+
+#include "BoundingBox.h"
+#include "Ray.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace RayTracer
+{
+	// Rays traced through a BVH together, e.g. the camera rays of a tile of pixels. Besides the rays it
+	// keeps the interval every origin and inverse direction component falls in, so one conservative slab
+	// test with interval arithmetic tells whether any ray of the packet can reach a box.
+	class RayPacket
+	{
+	public:
+		// An 8x8 tile of pixels
+		static constexpr size_t MaxSize = 64;
+
+		RayPacket()
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				origin_min[axis] = inverse_direction_min[axis] = std::numeric_limits<float>::infinity();
+				origin_max[axis] = inverse_direction_max[axis] = -std::numeric_limits<float>::infinity();
+			}
+		}
+
+		void Add(const Ray &ray)
+		{
+			if (size == MaxSize)
+			{
+				throw std::exception("Ray packet is full");
+			}
+
+			const Vector3<float> &direction_vector = ray.NormalizedDirection();
+			const float ray_origin[3] = { ray.Origin().X, ray.Origin().Y, ray.Origin().Z };
+			const float ray_direction[3] = { direction_vector.X, direction_vector.Y, direction_vector.Z };
+
+			// The interval slab test needs every ray to cross the slabs of an axis in the same order
+			coherent = coherent && (0 == size || ray.Octant() == rays[0].Octant());
+
+			rays[size] = ray;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				origins[size][axis] = ray_origin[axis];
+				directions[size][axis] = ray_direction[axis];
+				inverse_directions[size][axis] = ray.InverseDirection()[axis];
+				coherent = coherent && std::isfinite(inverse_directions[size][axis]);
+
+				origin_min[axis] = std::min(origin_min[axis], ray_origin[axis]);
+				origin_max[axis] = std::max(origin_max[axis], ray_origin[axis]);
+				inverse_direction_min[axis] = std::min(inverse_direction_min[axis], inverse_directions[size][axis]);
+				inverse_direction_max[axis] = std::max(inverse_direction_max[axis], inverse_directions[size][axis]);
+			}
+
+			size++;
+		}
+
+		size_t Size() const
+		{
+			return size;
+		}
+
+		const Ray &operator[](size_t index) const
+		{
+			return rays[index];
+		}
+
+		const float *Origin(size_t index) const
+		{
+			return origins[index];
+		}
+
+		// Normalized
+		const float *Direction(size_t index) const
+		{
+			return directions[index];
+		}
+
+		const float *InverseDirection(size_t index) const
+		{
+			return inverse_directions[index];
+		}
+
+		// True when every ray has the same direction sign along each axis and no zero component. Only
+		// coherent packets can be culled as a whole, others have to be traced one ray at a time.
+		bool Coherent() const
+		{
+			return coherent && size > 0;
+		}
+
+		// Conservative slab test of the whole packet: false only when no ray of the packet can hit the
+		// box closer than max_depth. out_entry_depth is a lower bound of the rays' entry depths.
+		// The packet must be Coherent().
+		bool IntersectsBox(const BoundingBox &box, float max_depth, float &out_entry_depth) const
+		{
+			float near_depth = 0.0f;
+			float far_depth = max_depth;
+			const uint32_t octant = rays[0].Octant();
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const bool negative = 0 != (octant & (1u << axis));
+				const float entry_plane = negative ? box.max[axis] : box.min[axis];
+				const float exit_plane = negative ? box.min[axis] : box.max[axis];
+
+				float entry_min;
+				float entry_max;
+				float exit_min;
+				float exit_max;
+				IntervalProduct(entry_plane - origin_max[axis], entry_plane - origin_min[axis], inverse_direction_min[axis], inverse_direction_max[axis], entry_min, entry_max);
+				IntervalProduct(exit_plane - origin_max[axis], exit_plane - origin_min[axis], inverse_direction_min[axis], inverse_direction_max[axis], exit_min, exit_max);
+
+				near_depth = std::max(near_depth, entry_min);
+				far_depth = std::min(far_depth, exit_max * BoundingBox::RobustExitScale);
+			}
+
+			out_entry_depth = near_depth;
+			return near_depth <= far_depth;
+		}
+
+		// Slab test of a single ray of the packet
+		bool RayIntersectsBox(size_t index, const BoundingBox &box, float max_depth, float &out_entry_depth) const
+		{
+			return box.IntersectsRay(rays[index].Origin(), inverse_directions[index], max_depth, out_entry_depth);
+		}
+
+	private:
+		// Range of a * b for a in [a_min, a_max] and b in [b_min, b_max]
+		static void IntervalProduct(float a_min, float a_max, float b_min, float b_max, float &out_min, float &out_max)
+		{
+			const float products[4] = { a_min * b_min, a_min * b_max, a_max * b_min, a_max * b_max };
+			out_min = *std::min_element(products, products + 4);
+			out_max = *std::max_element(products, products + 4);
+		}
+
+		Ray rays[MaxSize];
+		float origins[MaxSize][3];
+		float directions[MaxSize][3];
+		float inverse_directions[MaxSize][3];
+		size_t size = 0;
+		bool coherent = true;
+
+		float origin_min[3];
+		float origin_max[3];
+		float inverse_direction_min[3];
+		float inverse_direction_max[3];
+	};
+}
@@ -24,6 +24,12 @@ namespace RayTracer
 			return position;
 		}
 
+		// Moving a sphere changes its bounds, refit or rebuild any hierarchy containing it afterwards
+		void SetPosition(const Vector3<float> &new_position)
+		{
+			position = new_position;
+		}
+
 		float Radius() const
 		{
 			return radius;
@@ -34,10 +40,40 @@ namespace RayTracer
 			return material;
 		}
 
+		BoundingBox Bounds() const override
+		{
+			Vector3<float> extent(radius, radius, radius);
+			return BoundingBox(position - extent, position + extent);
+		}
+
 		bool IntersectsRay(const Ray &incoming_ray, Intersection &out_intersection_info) const override
 		{
-			Vector3<float> line_origin_to_sphere_center_O_minus_C(position - incoming_ray.Origin());
-			float u_dot = line_origin_to_sphere_center_O_minus_C.Dot(incoming_ray.Direction().Normalize());
+			const Vector3<float> &ray_direction_normalized = incoming_ray.NormalizedDirection();
+			float depth = 0.0f;
+			if (!IntersectionDepth(incoming_ray.Origin(), ray_direction_normalized, depth) || depth > incoming_ray.MaxDepth())
+			{
+				return false;
+			}
+
+			Vector3<float> intersection_location = incoming_ray.Origin() + ray_direction_normalized * depth;
+			Vector3<float> intersection_normal = (intersection_location - position).Normalize();
+
+			out_intersection_info = Intersection(depth, intersection_normal, intersection_location);
+
+			return true;
+		}
+
+		bool Occluded(const Ray &incoming_ray, float max_depth) const override
+		{
+			float depth = 0.0f;
+			return IntersectionDepth(incoming_ray.Origin(), incoming_ray.NormalizedDirection(), depth) && depth < max_depth;
+		}
+
+	private:
+		bool IntersectionDepth(const Vector3<float> &origin, const Vector3<float> &ray_direction_normalized, float &out_depth) const
+		{
+			Vector3<float> line_origin_to_sphere_center_O_minus_C(position - origin);
+			float u_dot = line_origin_to_sphere_center_O_minus_C.Dot(ray_direction_normalized);
 
 			float dot_squared = u_dot * u_dot;
 			float magnitude_squared = line_origin_to_sphere_center_O_minus_C.MagnitudeSquared();
@@ -51,20 +87,10 @@ namespace RayTracer
 			}
 
 			// The closest depth has to be the "minus" term of the "plus or minus" square-root since delta is always positive
-			float depth = u_dot - sqrt(delta);
+			out_depth = u_dot - sqrt(delta);
 
 			// If the depth is negative either only the backwards ray intersects, or it is a backface from starting in the sphere
-			if (depth < 0)
-			{
-				return false;
-			}
-
-			Vector3<float> intersection_location = incoming_ray.Origin() + incoming_ray.Direction().Normalize() * depth;
-			Vector3<float> intersection_normal = (intersection_location - position).Normalize();
-
-			out_intersection_info = Intersection(depth, intersection_normal, intersection_location);
-
-			return true;
+			return out_depth >= 0;
 		}
 	};
 }
\ No newline at end of file
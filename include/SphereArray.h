@@ -0,0 +1,49 @@
+#pragma once
+
+#include "IIntersectable.h"
+#include "Intersection.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+	// The spheres among a list of objects packed as structure-of-arrays: center x, y, z and squared
+	// radius rows, one entry per object. A ray is tested against BatchWidth consecutive entries at
+	// once with AVX instead of a virtual Sphere::IntersectsRay per object. Entries of objects that are
+	// not spheres can never be hit, acceleration structures test those through IIntersectable.
+	class SphereArray
+	{
+	public:
+		static constexpr uint32_t BatchWidth = 8;
+
+		SphereArray() = default;
+		explicit SphereArray(const std::vector<const IIntersectable *> &objects);
+
+		size_t SphereCount() const
+		{
+			return sphere_count;
+		}
+
+		bool IsSphere(size_t index) const
+		{
+			return 0 != is_sphere[index];
+		}
+
+		// Same results as Sphere::IntersectsRay for the entries first_index up to first_index + count. The
+		// direction must be normalized. Returns true when a sphere is hit closer than max_depth, which is
+		// then lowered to that hit and out_index set to its entry.
+		bool IntersectsRay(const float origin[3], const float direction[3], uint32_t first_index, uint32_t count,
+			float &max_depth, uint32_t &out_index) const;
+
+		// Location and normal of a hit found by IntersectsRay, only computed for the closest one
+		Intersection SurfaceIntersection(size_t index, const Vector3<float> &origin, const Vector3<float> &direction, float depth) const;
+
+	private:
+		size_t entry_count = 0;
+		size_t sphere_count = 0;
+		// Rows are center x, y, z and radius squared, padded with a batch of misses like TriangleArray
+		std::vector<float> components[4];
+		std::vector<uint8_t> is_sphere;
+	};
+}
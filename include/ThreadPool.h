@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <semaphore>
 #include <vector>
@@ -9,6 +11,10 @@
 
 namespace RayTracer
 {
+	// Work-stealing pool. Every worker owns a deque of tasks: it pushes and pops at the bottom while idle
+	// workers steal from the top. Tasks enqueued from outside the pool go through a shared queue that
+	// workers drain in batches into their own deques. Workers without work park on an atomic wait
+	// instead of polling, and BlockUntilComplete waits for the count of unfinished tasks to reach zero.
 	class ThreadPool
 	{
 	public:
@@ -23,24 +29,46 @@ namespace RayTracer
 			IThreadPoolTask(IThreadPoolTask &&) = delete;
 		};
 
+		// At most queue_size tasks wait to be started at any time, EnqueueTask blocks while that many are queued
 		ThreadPool(size_t thread_count, size_t queue_size);
 		~ThreadPool();
+		// Called from a task of this pool, the task goes to the calling worker's own deque. It never blocks
+		// there: while queue_size tasks are waiting, the worker runs the task before returning instead.
 		void EnqueueTask(const std::shared_ptr<IThreadPoolTask> &task);
+		// Returns once every enqueued task has finished. Must not be called from a task of this pool.
 		void BlockUntilComplete();
+
+		size_t ThreadCount() const
+		{
+			return threads.size();
+		}
 	private:
+		class WorkQueue;
+		using TaskHandle = std::shared_ptr<IThreadPoolTask>;
+
 		ThreadPool() = delete;
 		ThreadPool(ThreadPool &) = delete;
 		ThreadPool(ThreadPool &&) = delete;
-		void thread_loop();
+		void thread_loop(size_t worker_index);
+		TaskHandle *FindTask(size_t worker_index);
+		void RunTask(TaskHandle *task);
+		void WakeWorker();
 
-		std::atomic<size_t> enqueued_tasks_count;
-		std::atomic<size_t> completed_tasks_count;
+		// Enqueued tasks that have not finished yet
+		std::atomic<size_t> unfinished_tasks;
 
-		std::mutex enqueued_tasks_lock;
 		std::counting_semaphore<> queue_counter;
 
-		std::deque<std::shared_ptr<IThreadPoolTask>> enqueued_tasks;
+		// Tasks enqueued from outside the pool
+		std::mutex injected_tasks_lock;
+		std::deque<TaskHandle *> injected_tasks;
+
+		std::vector<std::unique_ptr<WorkQueue>> work_queues;
+		// Bumped whenever work is added or the pool stops, parked workers wait for it to change
+		std::atomic<uint32_t> work_epoch;
+		std::atomic<uint32_t> parked_workers;
+
 		std::vector<std::thread> threads;
-		bool stop_requested;
+		std::atomic<bool> stop_requested;
 	};
-}
\ No newline at end of file
+}
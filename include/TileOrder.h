@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace RayTracer
+{
+	enum class TileOrder
+	{
+		// Rows of tiles from the top left
+		Scanline,
+		// Outward from the center tile, the middle of the image finishes first
+		Spiral,
+		// Along a Hilbert curve, consecutive tiles are neighbors so they share more of the scene
+		Hilbert
+	};
+
+	// Block of pixels rendered by one task, the tiles at the right and bottom edges can be partial
+	struct ImageTile
+	{
+		size_t x;
+		size_t y;
+		size_t width;
+		size_t height;
+	};
+
+	// Covers a resolution_x by resolution_y image with tile_size tiles, listed in the given order
+	std::vector<ImageTile> OrderTiles(size_t resolution_x, size_t resolution_y, size_t tile_size, TileOrder order);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Ray.h"
+#include "FrameBuffer.h"
+#include "IAccelerationStructure.h"
+#include "TileOrder.h"
+
+#include <algorithm>
+
+namespace RayTracer
+{
+	// Renders a tile of pixels in blocks of PacketTileSize by PacketTileSize pixels. With packet tracing the
+	// camera rays of each sample of a block are coherent and are traced as one packet; the bounces after the
+	// first hit diverge and are traced one ray at a time. The samples are accumulated in a buffer of the
+	// worker thread, the frame buffer only receives their statistics once the tile is done.
+	class TileRenderTask : public ThreadPool::IThreadPoolTask
+	{
+	public:
+		// Width and height of the blocks whose camera rays fill one RayPacket
+		static constexpr size_t PacketTileSize = 8;
+
+		TileRenderTask(const Camera &camera, const ImageTile &tile, unsigned int samples, const IScene &scene,
+			const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer, bool packet_tracing = true);
+		void Execute() override;
+
+		// Calls visit(x, y) for the pixels of a tile block by block, so the camera rays of consecutive pixels still make packets
+		template <typename Visitor>
+		static void ForEachPixel(const ImageTile &tile, Visitor visit)
+		{
+			for (size_t block_y = tile.y; block_y < tile.y + tile.height; block_y += PacketTileSize)
+			{
+				for (size_t block_x = tile.x; block_x < tile.x + tile.width; block_x += PacketTileSize)
+				{
+					for (size_t y = block_y; y < std::min(block_y + PacketTileSize, tile.y + tile.height); y++)
+					{
+						for (size_t x = block_x; x < std::min(block_x + PacketTileSize, tile.x + tile.width); x++)
+						{
+							visit(x, y);
+						}
+					}
+				}
+			}
+		}
+	private:
+		const Camera &camera;
+		ImageTile tile;
+		unsigned int samples;
+		const IScene &scene;
+		const IAccelerationStructure &acceleration_structure;
+		FrameBuffer &frame_buffer;
+		bool packet_tracing;
+	};
+}
@@ -4,10 +4,14 @@
 #include "Image.h"
 #include "Camera.h"
 #include "IScene.h"
+#include "BVH.h"
 #include <string>
 
 namespace RayTracer
 {
-	bool CreateSceneFromOBJFile(const std::string &file_path, ImageResolution resolution, Camera *&out_camera, IScene *&out_scene);
+	// When cache_path is given the meshes and their BVHs are loaded from that AccelerationStructureCache
+	// file if it was made from the same OBJ contents and options, and written to it otherwise
+	bool CreateSceneFromOBJFile(const std::string &file_path, ImageResolution resolution, Camera *&out_camera, IScene *&out_scene,
+		const BVHBuildOptions &bvh_build_options = BVHBuildOptions(), const std::string &cache_path = "");
 }
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Vector3.h"
+#include "BoundingBox.h"
+
+#include <math.h>
+
+namespace RayTracer
+{
+	// Affine transform stored as the top three rows of a 4x4 row-major matrix
+	class Transform
+	{
+	public:
+		Transform()
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					m[row][column] = row == column ? 1.0f : 0.0f;
+				}
+			}
+		}
+
+		static Transform Translation(const Vector3<float> &translation)
+		{
+			Transform transform;
+			transform.m[0][3] = translation.X;
+			transform.m[1][3] = translation.Y;
+			transform.m[2][3] = translation.Z;
+			return transform;
+		}
+
+		static Transform Scale(const Vector3<float> &scale)
+		{
+			Transform transform;
+			transform.m[0][0] = scale.X;
+			transform.m[1][1] = scale.Y;
+			transform.m[2][2] = scale.Z;
+			return transform;
+		}
+
+		// Right-handed rotation about a principal axis (0 = X, 1 = Y, 2 = Z)
+		static Transform Rotation(int axis, float radians)
+		{
+			Transform transform;
+			int a = (axis + 1) % 3;
+			int b = (axis + 2) % 3;
+			float cosine = cosf(radians);
+			float sine = sinf(radians);
+			transform.m[a][a] = cosine;
+			transform.m[a][b] = -sine;
+			transform.m[b][a] = sine;
+			transform.m[b][b] = cosine;
+			return transform;
+		}
+
+		// Applies "other" first, then this transform
+		Transform operator*(const Transform &other) const
+		{
+			Transform result;
+			for (int row = 0; row < 3; row++)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					float value = 0.0f;
+					for (int k = 0; k < 3; k++)
+					{
+						value += m[row][k] * other.m[k][column];
+					}
+
+					if (column == 3)
+					{
+						value += m[row][3];
+					}
+
+					result.m[row][column] = value;
+				}
+			}
+
+			return result;
+		}
+
+		Transform Inverse() const
+		{
+			// Inverse of the linear part through the adjugate, then undo the translation
+			float a00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+			float a01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+			float a02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+			float a10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+			float a11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+			float a12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+			float a20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+			float a21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+			float a22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+			float determinant = m[0][0] * a00 + m[0][1] * a10 + m[0][2] * a20;
+			if (0.0f == determinant)
+			{
+				throw std::exception("Transform is not invertible");
+			}
+
+			float inverse_determinant = 1.0f / determinant;
+
+			Transform inverse;
+			inverse.m[0][0] = a00 * inverse_determinant;
+			inverse.m[0][1] = a01 * inverse_determinant;
+			inverse.m[0][2] = a02 * inverse_determinant;
+			inverse.m[1][0] = a10 * inverse_determinant;
+			inverse.m[1][1] = a11 * inverse_determinant;
+			inverse.m[1][2] = a12 * inverse_determinant;
+			inverse.m[2][0] = a20 * inverse_determinant;
+			inverse.m[2][1] = a21 * inverse_determinant;
+			inverse.m[2][2] = a22 * inverse_determinant;
+
+			for (int row = 0; row < 3; row++)
+			{
+				inverse.m[row][3] = -(inverse.m[row][0] * m[0][3] + inverse.m[row][1] * m[1][3] + inverse.m[row][2] * m[2][3]);
+			}
+
+			return inverse;
+		}
+
+		Vector3<float> TransformPoint(const Vector3<float> &point) const
+		{
+			return Vector3<float>(
+				m[0][0] * point.X + m[0][1] * point.Y + m[0][2] * point.Z + m[0][3],
+				m[1][0] * point.X + m[1][1] * point.Y + m[1][2] * point.Z + m[1][3],
+				m[2][0] * point.X + m[2][1] * point.Y + m[2][2] * point.Z + m[2][3]);
+		}
+
+		Vector3<float> TransformVector(const Vector3<float> &vector) const
+		{
+			return Vector3<float>(
+				m[0][0] * vector.X + m[0][1] * vector.Y + m[0][2] * vector.Z,
+				m[1][0] * vector.X + m[1][1] * vector.Y + m[1][2] * vector.Z,
+				m[2][0] * vector.X + m[2][1] * vector.Y + m[2][2] * vector.Z);
+		}
+
+		// Normals transform with the inverse transpose, so this must be called on the inverse transform
+		Vector3<float> TransformNormalWithInverse(const Vector3<float> &normal) const
+		{
+			return Vector3<float>(
+				m[0][0] * normal.X + m[1][0] * normal.Y + m[2][0] * normal.Z,
+				m[0][1] * normal.X + m[1][1] * normal.Y + m[2][1] * normal.Z,
+				m[0][2] * normal.X + m[1][2] * normal.Y + m[2][2] * normal.Z);
+		}
+
+		BoundingBox TransformBounds(const BoundingBox &bounds) const
+		{
+			BoundingBox transformed_bounds;
+			if (bounds.IsEmpty())
+			{
+				return transformed_bounds;
+			}
+
+			for (int corner = 0; corner < 8; corner++)
+			{
+				Vector3<float> point(
+					(corner & 1) ? bounds.max[0] : bounds.min[0],
+					(corner & 2) ? bounds.max[1] : bounds.min[1],
+					(corner & 4) ? bounds.max[2] : bounds.min[2]);
+				transformed_bounds.Expand(TransformPoint(point));
+			}
+
+			return transformed_bounds;
+		}
+
+		float m[3][4];
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "BVH.h"
+#include "WideBVH.h"
+#include "QuantizedBVH.h"
+
+namespace RayTracer
+{
+	// A binary BVH together with the layout it is traversed in. The binary tree is what gets built,
+	// refit and measured; BVHBuildOptions::Width and QuantizedNodes select whether rays walk it
+	// directly or a wide tree collapsed from it. Primitive slots are shared by every layout.
+	class TraversalHierarchy
+	{
+	public:
+		TraversalHierarchy() = default;
+		TraversalHierarchy(const std::vector<BoundingBox> &primitive_bounds, const BVHBuildOptions &options = BVHBuildOptions(),
+			const BVH::PrimitiveClipper &clip_primitive = nullptr);
+		// Traverses a binary BVH that was already built, see BVH's adopting constructor
+		TraversalHierarchy(BVH &&binary, const BVHBuildOptions &options = BVHBuildOptions());
+
+		const BVH &Binary() const
+		{
+			return bvh;
+		}
+
+		const std::vector<uint32_t> &PrimitiveIndices() const
+		{
+			return bvh.PrimitiveIndices();
+		}
+
+		BoundingBox Bounds() const
+		{
+			return bvh.Bounds();
+		}
+
+		uint32_t Width() const
+		{
+			return width;
+		}
+
+		bool Quantized() const
+		{
+			return quantized;
+		}
+
+		// Size of the nodes rays traverse
+		size_t MemoryBytes() const;
+
+		// See BVH::Refit, the wide layouts follow the refit binary tree
+		float Refit(const std::vector<BoundingBox> &slot_bounds, ThreadPool *pool = nullptr);
+
+		bool NeedsRebuild(float threshold) const
+		{
+			return bvh.NeedsRebuild(threshold);
+		}
+
+		// Same contract as BVH::Traverse
+		template <class PrimitiveIntersector>
+		bool Traverse(const Ray &ray, float &max_depth, PrimitiveIntersector &&intersect_primitive) const
+		{
+			if (quantized)
+			{
+				return quantized_4.Traverse(ray, max_depth, intersect_primitive);
+			}
+
+			switch (width)
+			{
+			case 8:
+				return wide_8.Traverse(ray, max_depth, intersect_primitive);
+			case 4:
+				return wide_4.Traverse(ray, max_depth, intersect_primitive);
+			default:
+				return bvh.Traverse(ray, max_depth, intersect_primitive);
+			}
+		}
+
+	private:
+		void BuildLayout(const BVHBuildOptions &options);
+
+		BVH bvh;
+		uint32_t width = 2;
+		bool quantized = false;
+		WideBVH<4> wide_4;
+		WideBVH<8> wide_8;
+		QuantizedBVH quantized_4;
+	};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Vector3.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+	// Triangles stored as structure-of-arrays: one float array per component of the base vertex and
+	// of both edges, or of all three vertices for the watertight test. A ray is tested against BatchWidth
+	// consecutive triangles at once with AVX, which is how MeshGeometry intersects the slots of a BVH leaf.
+	class TriangleArray
+	{
+	public:
+		static constexpr uint32_t BatchWidth = 8;
+
+		// Per ray setup of the watertight test: the axis the direction is largest along becomes z, and
+		// the shear that turns the direction into that axis
+		struct WatertightRay
+		{
+			WatertightRay(const float origin[3], const float direction[3]);
+			// For rays whose largest direction component is already known, see Ray::DominantAxis
+			WatertightRay(const float origin[3], const float direction[3], uint32_t z_axis);
+
+			float origin[3];
+			// Source axes of the permuted x, y and z, x and y are swapped for negative directions to keep the winding
+			uint32_t axes[3];
+			// x and y are sheared by z times the first two, z is scaled by the third
+			float shear[3];
+		};
+
+		TriangleArray() = default;
+		// Watertight arrays can only be tested with IntersectsRayWatertight, others only with IntersectsRay
+		explicit TriangleArray(size_t triangle_count, bool watertight = false);
+
+		void Set(size_t index, const Vector3<float> &vertex_1, const Vector3<float> &vertex_2, const Vector3<float> &vertex_3);
+
+		size_t Size() const
+		{
+			return triangle_count;
+		}
+
+		bool Watertight() const
+		{
+			return watertight;
+		}
+
+		// Geometric normal of a triangle, edge_1 x edge_2 left unnormalized
+		Vector3<float> Normal(size_t index) const
+		{
+			return Vector3<float>(normals[3 * index], normals[3 * index + 1], normals[3 * index + 2]);
+		}
+
+		// Moller-Trumbore against the triangles first_index up to first_index + count. The direction must be
+		// normalized so that depths are distances along the ray. Returns true when a triangle is hit closer
+		// than max_depth, which is then lowered to that hit and out_index set to its triangle.
+		bool IntersectsRay(const float origin[3], const float direction[3], uint32_t first_index, uint32_t count,
+			float &max_depth, uint32_t &out_index) const;
+
+		// Same as IntersectsRay, with the watertight test of Woop, Benthin and Wald, "Watertight Ray/Triangle
+		// Intersection" (JCGT 2013). The triangles are transformed into a space where the ray runs along
+		// +z from the origin, so a ray through an edge shared by two triangles computes the same edge
+		// function for both of them and cannot slip through between the two.
+		bool IntersectsRayWatertight(const WatertightRay &ray, uint32_t first_index, uint32_t count,
+			float &max_depth, uint32_t &out_index) const;
+
+	private:
+		// The watertight test of one triangle, redone in double precision when an edge function is zero
+		bool WatertightDepth(const WatertightRay &ray, size_t index, float &out_depth) const;
+
+		size_t triangle_count = 0;
+		bool watertight = false;
+		// Rows are base x, y, z, edge_1 x, y, z, edge_2 x, y, z. The watertight test needs the vertices
+		// themselves so that triangles sharing an edge share its exact coordinates, its rows are vertex_1,
+		// vertex_2 and vertex_3 instead. Each row is padded with a zero triangle batch so a batch load
+		// starting at any triangle stays inside the row.
+		std::vector<float> components[9];
+		// Three floats per triangle, only read for the closest hit
+		std::vector<float> normals;
+	};
+}
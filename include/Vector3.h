@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utilities.h"
+#include "Random.h"
 
 #include <math.h>
 
@@ -113,13 +114,13 @@ namespace RayTracer
 		}
 
 		// Based on https://raytracing.github.io/books/RayTracingInOneWeekend.html#diffusematerials/asimplediffusematerial
-		static Vector3<T> RandomInUnitSphere()
+		static Vector3<T> RandomInUnitSphere(PCG32 &random)
 		{
 			while (true)
 			{
-				T x = (T)rand() / RAND_MAX * 2 - 1;
-				T y = (T)rand() / RAND_MAX * 2 - 1;
-				T z = (T)rand() / RAND_MAX * 2 - 1;
+				T x = (T)random.NextFloat() * 2 - 1;
+				T y = (T)random.NextFloat() * 2 - 1;
+				T z = (T)random.NextFloat() * 2 - 1;
 				Vector3<T> vec(x, y, z);
 				if (vec.MagnitudeSquared() < 1)
 				{
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Ray.h"
+#include "FrameBuffer.h"
+#include "IAccelerationStructure.h"
+#include "IMaterial.h"
+#include "TileOrder.h"
+
+namespace RayTracer
+{
+	// Renders a batch of tiles breadth-first, in the stages of the GPU renderer: the rays of one sample
+	// of every pixel are initialized together, then each bounce intersects all the rays still active
+	// before any of them is shaded, and the finished colors are accumulated per pixel. The ray state is
+	// kept as structure-of-arrays with one entry per pixel. Rays are intersected sorted by direction
+	// octant and shaded sorted by material, so consecutive rays visit the same nodes and material code.
+	class WavefrontRenderTask : public ThreadPool::IThreadPoolTask
+	{
+	public:
+		WavefrontRenderTask(const Camera &camera, const std::vector<ImageTile> &tiles, unsigned int samples, const IScene &scene,
+			const IAccelerationStructure &acceleration_structure, FrameBuffer &frame_buffer);
+		void Execute() override;
+	private:
+		void InitializeRays(unsigned int sample);
+		void IntersectRays(bool camera_rays);
+		void CalculateMaterials(unsigned int sample, unsigned int bounce);
+		void AccumulateSamples();
+
+		Ray ActiveRay(uint32_t index) const;
+		void SetRay(uint32_t index, const Ray &ray);
+
+		const Camera &camera;
+		std::vector<ImageTile> tiles;
+		unsigned int samples;
+		const IScene &scene;
+		const IAccelerationStructure &acceleration_structure;
+		FrameBuffer &frame_buffer;
+
+		// Coordinates of the pixels of the tiles, block by block like TileRenderTask traces them
+		std::vector<uint32_t> pixel_x;
+		std::vector<uint32_t> pixel_y;
+		// Rays of the current sample, entry i belongs to pixel i
+		std::vector<float> origins[3];
+		std::vector<float> directions[3];
+		std::vector<Color> colors;
+		// Closest hit of each active ray, the object is null for a miss
+		std::vector<Intersection> intersections;
+		std::vector<const IIntersectable *> objects;
+		// Indices of the rays that are still bouncing
+		std::vector<uint32_t> active_rays;
+		std::vector<uint32_t> sorted_rays;
+		// Materials hit so far, a ray's slot is the index of its material in that list
+		std::vector<const IMaterial *> materials;
+		std::vector<uint32_t> material_slots;
+		// Statistics of the finished samples of each pixel
+		std::vector<SampleStatistics> pixel_statistics;
+	};
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "BVH.h"
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#endif
+
+namespace RayTracer
+{
+	// BVH with Width children per node, collapsed from a binary BVH. The child boxes are stored as
+	// structure-of-arrays so one SIMD slab test covers every child of a node. Leaves keep the
+	// primitive slots of the binary BVH, so primitives stay in its PrimitiveIndices() order.
+	template <size_t Width>
+	class WideBVH
+	{
+		static_assert(Width == 4 || Width == 8, "Wide BVH nodes have 4 or 8 children");
+
+	public:
+		// Marks a child slot that is not in use
+		static constexpr uint32_t EmptyChild = 0xffffffff;
+
+		struct alignas(32) Node
+		{
+			// Rows are min x, min y, min z, max x, max y, max z, columns are children
+			float bounds[6][Width];
+			// Interior children: index of the child node. Leaf children: first primitive slot. Unused: EmptyChild
+			uint32_t child[Width];
+			// Zero for interior children
+			uint32_t primitive_count[Width];
+		};
+
+		WideBVH() = default;
+		explicit WideBVH(const BVH &binary);
+
+		// Copies the bounds of a refit binary BVH, which must be the one this tree was collapsed from
+		void Refit(const BVH &binary);
+
+		const std::vector<Node> &Nodes() const
+		{
+			return nodes;
+		}
+
+		bool Empty() const
+		{
+			return nodes.empty();
+		}
+
+		// Binary node each child was collapsed from, Width entries per node, EmptyChild for unused children
+		const std::vector<uint32_t> &SourceNodes() const
+		{
+			return source_nodes;
+		}
+
+		size_t MemoryBytes() const
+		{
+			return nodes.size() * sizeof(Node);
+		}
+
+		// Same contract as BVH::Traverse
+		template <class PrimitiveIntersector>
+		bool Traverse(const Ray &ray, float &max_depth, PrimitiveIntersector &&intersect_primitive) const
+		{
+			if (nodes.empty())
+			{
+				return false;
+			}
+
+			const float origin[3] = { ray.Origin().X, ray.Origin().Y, ray.Origin().Z };
+			const float *inverse_direction = ray.InverseDirection();
+
+			struct StackEntry
+			{
+				uint32_t child;
+				uint32_t primitive_count;
+				float entry_depth;
+			};
+
+			// Every level can leave all but one of its children on the stack
+			StackEntry stack[(Width - 1) * BVH::MaxDepth + 1];
+			size_t stack_size = 0;
+			stack[stack_size++] = { 0, 0, 0.0f };
+			bool intersection_found = false;
+
+			while (stack_size > 0)
+			{
+				const StackEntry entry = stack[--stack_size];
+				if (entry.entry_depth > max_depth)
+				{
+					continue;
+				}
+
+				if (entry.primitive_count > 0)
+				{
+					if (BVH::IntersectLeaf(intersect_primitive, entry.child, entry.primitive_count, max_depth))
+					{
+						intersection_found = true;
+					}
+
+					continue;
+				}
+
+				const Node &node = nodes[entry.child];
+				float entry_depths[Width];
+				uint32_t hit_mask = IntersectChildren(node, origin, inverse_direction, max_depth, entry_depths);
+
+				// Push the hit children farthest first so the nearest one is popped next
+				const size_t first_pushed = stack_size;
+				while (0 != hit_mask)
+				{
+					const int child_index = std::countr_zero(hit_mask);
+					hit_mask &= hit_mask - 1;
+					if (EmptyChild == node.child[child_index])
+					{
+						continue;
+					}
+
+					StackEntry child_entry = { node.child[child_index], node.primitive_count[child_index], entry_depths[child_index] };
+					size_t position = stack_size++;
+					while (position > first_pushed && stack[position - 1].entry_depth < child_entry.entry_depth)
+					{
+						stack[position] = stack[position - 1];
+						position--;
+					}
+
+					stack[position] = child_entry;
+				}
+			}
+
+			return intersection_found;
+		}
+
+	private:
+		// Slab test of the ray against every child box, returns a bit mask of the children it hits
+		static uint32_t IntersectChildren(const Node &node, const float origin[3], const float inverse_direction[3], float max_depth, float out_entry_depths[Width])
+		{
+#if defined(__AVX__)
+			if constexpr (Width == 8)
+			{
+				__m256 near_depth = _mm256_setzero_ps();
+				__m256 far_depth = _mm256_set1_ps(max_depth);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const __m256 ray_origin = _mm256_set1_ps(origin[axis]);
+					const __m256 ray_inverse_direction = _mm256_set1_ps(inverse_direction[axis]);
+					const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[axis]), ray_origin), ray_inverse_direction);
+					const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[axis + 3]), ray_origin), ray_inverse_direction);
+					// Operand order makes NaNs (origin on a slab with a zero direction) leave the depths alone
+					near_depth = _mm256_max_ps(_mm256_min_ps(t1, t0), near_depth);
+					far_depth = _mm256_min_ps(_mm256_mul_ps(_mm256_max_ps(t1, t0), _mm256_set1_ps(BoundingBox::RobustExitScale)), far_depth);
+				}
+
+				_mm256_storeu_ps(out_entry_depths, near_depth);
+				return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(near_depth, far_depth, _CMP_LE_OQ)));
+			}
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+			if constexpr (Width == 4)
+			{
+				__m128 near_depth = _mm_setzero_ps();
+				__m128 far_depth = _mm_set1_ps(max_depth);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const __m128 ray_origin = _mm_set1_ps(origin[axis]);
+					const __m128 ray_inverse_direction = _mm_set1_ps(inverse_direction[axis]);
+					const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[axis]), ray_origin), ray_inverse_direction);
+					const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[axis + 3]), ray_origin), ray_inverse_direction);
+					near_depth = _mm_max_ps(_mm_min_ps(t1, t0), near_depth);
+					far_depth = _mm_min_ps(_mm_mul_ps(_mm_max_ps(t1, t0), _mm_set1_ps(BoundingBox::RobustExitScale)), far_depth);
+				}
+
+				_mm_storeu_ps(out_entry_depths, near_depth);
+				return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(near_depth, far_depth)));
+			}
+#endif
+			uint32_t hit_mask = 0;
+			for (size_t child_index = 0; child_index < Width; child_index++)
+			{
+				float near_depth = 0.0f;
+				float far_depth = max_depth;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float t0 = (node.bounds[axis][child_index] - origin[axis]) * inverse_direction[axis];
+					float t1 = (node.bounds[axis + 3][child_index] - origin[axis]) * inverse_direction[axis];
+					if (t0 > t1)
+					{
+						std::swap(t0, t1);
+					}
+
+					t1 *= BoundingBox::RobustExitScale;
+					near_depth = t0 > near_depth ? t0 : near_depth;
+					far_depth = t1 < far_depth ? t1 : far_depth;
+				}
+
+				out_entry_depths[child_index] = near_depth;
+				hit_mask |= near_depth <= far_depth ? (1u << child_index) : 0u;
+			}
+
+			return hit_mask;
+		}
+
+		uint32_t Collapse(const BVH &binary, uint32_t binary_index);
+		void SetChild(uint32_t node_index, size_t child_index, const BVH::Node &binary_node, uint32_t binary_index);
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> source_nodes;
+	};
+
+	extern template class WideBVH<4>;
+	extern template class WideBVH<8>;
+}